@@ -0,0 +1,1168 @@
+/**
+ *
+ *	Benchmark of __dtsharedmemory_search() and __dtsharedmemory_insert() with paths
+ *	that look like the ones darwintrace sees, unlike the random strings of
+ *	test_dtsharedmemory.c.
+ *
+ * ## WORKING ##
+ *
+ *	A corpus of paths is generated from a seed, so every run with the same seed
+ *	uses exactly the same paths: MacPorts-like prefixes (/opt/local/..., build
+ *	directories, system frameworks), port names, nested directories and files.
+ *	Paths are accessed with a Zipf distribution, a few of them very often
+ *	and most of them rarely, like real builds do.
+ *
+ *	For every workload and every combination of processes and threads, a child
+ *	process sets up a new pair of files, inserts every other path of the corpus
+ *	(so that searches both hit and miss) and forks the worker processes, each of which
+ *	creates its threads. All the workers start together and do the given number of
+ *	operations each. Every operation is timed to get the percentiles.
+ *
+ *	Workloads:
+ *		search-only   100% searches
+ *		search-heavy  95% searches, 5% insertions
+ *		mixed         50% searches, 50% insertions
+ *		insert-heavy  10% searches, 90% insertions
+ *		insert-only   100% insertions
+ *
+ *	Stores, every workload is run against each of them:
+ *		ctrie         this library
+ *		hash-private  a hash set in the memory of every process, behind a mutex shared
+ *		              by its threads, like a per-process std::unordered_map would be.
+ *		              Processes don't see the insertions of each other.
+ *		hash-shared   a hash set in memory shared by all the processes, behind a
+ *		              single process-shared mutex
+ *
+ *	Both hash sets are sized for the whole corpus up front, so they never grow.
+ *	The ctrie built with DISABLE_DUMPING_AND_RECYCLING is a separate binary,
+ *	Benchmark_NoRecycling.out, whose ctrie store is called ctrie-no-recycling.
+ *
+ *	Results are printed as CSV on stdout, one line per run. Comparing the runs
+ *	with the same number of workers (`cores`) tells how well the ctrie scales
+ *	across processes compared to threads of a single process.
+ *	`relative_throughput` is the throughput of a run divided by the one of the ctrie
+ *	with the same workload, processes and threads. `bytes_per_path` is the memory
+ *	a store took (one copy of it for hash-private) divided by the corpus paths it holds
+ *	at the end of the run.
+ *
+ *	Usage: ./Benchmark.out [-n corpus paths] [-o operations per thread]
+ *		[-t max threads per process] [-p max processes] [-s seed]
+ *		[-w workload,...] [-b store,...] [-r reference CSV] [-a] [-e]
+ *
+ *	Threads and processes go 1, 2, 4, ... up to the maximum.
+ *
+ *	-a pins every worker to its own core with sched_setaffinity(2) (Linux only),
+ *	   wrapping around when there are more workers than cores.
+ *	-e starts with empty files instead of inserting half of the corpus, so that
+ *	   the shared memory file is expanded while the workers run. `expansions`
+ *	   counts them (see __dtsharedmemory_get_stats()) and `insert_max_ns`
+ *	   shows what they cost.
+ *	-r takes the throughput of the ctrie from the CSV of an earlier run instead,
+ *	   which is how Benchmark_NoRecycling.out is compared with the ctrie.
+ *
+ **/
+
+
+#define CORPUS_PATHS          100000
+#define OPERATIONS_PER_THREAD 200000
+#define MAX_THREADS           4
+#define MAX_PROCESSES         4
+#define SEED                  1
+
+#define ZIPF_EXPONENT 0.99
+
+//Slots of the hash sets per corpus path, i.e., they are never more than half full
+#define HASH_SLOTS_PER_PATH 2
+
+
+
+//For sched_setaffinity(2)
+#ifdef __linux__
+#	define _GNU_SOURCE
+#	include <sched.h>
+#endif
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/param.h>
+
+#include "dtsharedmemory.h"
+
+
+
+struct Workload
+{
+	const char *name;
+	int         searchPercentage;
+};
+
+static const struct Workload workloads[] =
+{
+	{"search-only",  100},
+	{"search-heavy", 95},
+	{"mixed",        50},
+	{"insert-heavy", 10},
+	{"insert-only",  0}
+};
+
+#define NUMBER_OF_WORKLOADS (sizeof(workloads) / sizeof(workloads[0]))
+
+
+//What a workload runs against, set up by the process of a run before forking the workers
+struct Store
+{
+	const char *name;
+	void      (*setUp)(void);
+	void      (*tearDown)(void);
+	bool      (*search)(const char *path, uint8_t *flags);
+	bool      (*insert)(const char *path, uint8_t flags);
+	size_t    (*usedBytes)(void);
+	size_t    (*expansions)(void);
+};
+
+void ctrieSetUp(void);
+void ctrieTearDown(void);
+bool ctrieSearch(const char *path, uint8_t *flags);
+bool ctrieInsert(const char *path, uint8_t flags);
+size_t ctrieUsedBytes(void);
+size_t ctrieExpansions(void);
+
+void hashPrivateSetUp(void);
+void hashSharedSetUp(void);
+void hashTearDown(void);
+bool hashSearch(const char *path, uint8_t *flags);
+bool hashInsert(const char *path, uint8_t flags);
+size_t hashUsedBytes(void);
+size_t hashExpansions(void);
+
+static const struct Store stores[] =
+{
+#if DISABLE_DUMPING_AND_RECYCLING
+	{"ctrie-no-recycling", ctrieSetUp, ctrieTearDown, ctrieSearch, ctrieInsert, ctrieUsedBytes, ctrieExpansions},
+#else
+	{"ctrie",              ctrieSetUp, ctrieTearDown, ctrieSearch, ctrieInsert, ctrieUsedBytes, ctrieExpansions},
+#endif
+	{"hash-private",       hashPrivateSetUp, hashTearDown, hashSearch, hashInsert, hashUsedBytes, hashExpansions},
+	{"hash-shared",        hashSharedSetUp,  hashTearDown, hashSearch, hashInsert, hashUsedBytes, hashExpansions}
+};
+
+#define NUMBER_OF_STORES (sizeof(stores) / sizeof(stores[0]))
+
+
+/*
+ *	Open addressing with linear probing. The paths are copied one after the other
+ *	into `keys`, which follows `slots` in the same mapping. A slot with `key` 0 is empty.
+ */
+struct HashSlot
+{
+	uint64_t hash;
+	size_t   key; //offset into `keys`, from 1
+	uint8_t  flags;
+};
+
+struct HashSet
+{
+	pthread_mutex_t lock;
+	size_t          size;     //of the whole mapping
+	size_t          numberOfSlots;
+	size_t          usedKeyBytes;
+	char           *keys;
+	
+	struct HashSlot slots [];
+};
+
+
+//Same log-linear buckets as LATENCY_SAMPLING uses in the library
+#define HISTOGRAM_BUCKETS 320
+
+enum
+{
+	SEARCH,
+	INSERT,
+	NUMBER_OF_OPERATIONS
+};
+
+
+//Written by every worker thread into memory shared with the process which prints results
+struct WorkerResult
+{
+	size_t operations [NUMBER_OF_OPERATIONS];
+	size_t hits;
+	size_t failures;
+	size_t histogram [NUMBER_OF_OPERATIONS][HISTOGRAM_BUCKETS];
+};
+
+
+//Shared between all the processes of a run
+struct Run
+{
+	volatile int readyWorkers;
+	volatile int isStarted;
+	
+	double throughput;
+	
+	struct WorkerResult results [];
+};
+
+
+//Argument to a worker thread
+struct Worker
+{
+	struct Run             *run;
+	const struct Store     *store;
+	const struct Workload  *workload;
+	struct WorkerResult    *result;
+	uint64_t                random;
+	int                     core; //-1 if not pinned
+};
+
+
+//Corpus, generated before anything is forked
+char    **paths;
+uint8_t  *flagsOfPaths;
+double   *zipfDistribution;
+
+size_t corpusPaths         = CORPUS_PATHS;
+size_t operationsPerThread = OPERATIONS_PER_THREAD;
+
+bool isPinning;
+bool isStartingEmpty;
+
+//Throughput of the ctrie for every workload, processes and threads, from a run or -r
+struct Reference
+{
+	char   workload [32];
+	int    processes;
+	int    threads;
+	double throughput;
+};
+
+struct Reference *references;
+size_t numberOfReferences;
+
+//Of the current run
+char dtsm_file [MAXPATHLEN];
+struct HashSet *hashSet;
+
+
+
+int nextCount(int count, int maxCount);
+bool isSelected(const char *name, const char *selectedNames);
+uint64_t nextRandom(uint64_t *state);
+void generateCorpus(uint64_t seed);
+size_t pickPath(uint64_t *random);
+
+bool readReferences(const char *file);
+void addReference(const char *workload, int processes, int threads, double throughput);
+double findReference(const char *workload, int processes, int threads);
+
+double runWorkload(const struct Store *store, const struct Workload *workload, int processes, int threads, uint64_t seed);
+void *worker(void *arg);
+bool pinToCore(int core);
+
+void hashSetUp(bool isShared);
+struct HashSlot *hashFind(const char *path, uint64_t hash);
+uint64_t hashOf(const char *path);
+
+size_t elapsedNanoseconds(const struct timespec *start, const struct timespec *end);
+size_t latencyToBucket(size_t nanoseconds);
+size_t bucketToLatency(size_t bucket);
+size_t percentile(const size_t *histogram, size_t samples, double percent);
+
+
+
+int main(int argc, char *argv[])
+{
+	
+	int maxThreads   = MAX_THREADS;
+	int maxProcesses = MAX_PROCESSES;
+	uint64_t seed    = SEED;
+	
+	const char *selectedWorkloads = NULL;
+	const char *selectedStores    = NULL;
+	const char *referenceFile     = NULL;
+	
+	int option, processes, threads;
+	size_t i, j;
+	double throughput;
+	
+	while ((option = getopt(argc, argv, "n:o:t:p:s:w:b:r:ae")) != -1)
+	{
+		switch (option)
+		{
+			case 'n': corpusPaths         = strtoul(optarg, NULL, 10); break;
+			case 'o': operationsPerThread = strtoul(optarg, NULL, 10); break;
+			case 't': maxThreads          = atoi(optarg);              break;
+			case 'p': maxProcesses        = atoi(optarg);              break;
+			case 's': seed                = strtoull(optarg, NULL, 10); break;
+			case 'w': selectedWorkloads   = optarg;                    break;
+			case 'b': selectedStores      = optarg;                    break;
+			case 'r': referenceFile       = optarg;                    break;
+			case 'a': isPinning           = true;                      break;
+			case 'e': isStartingEmpty     = true;                      break;
+			default:
+				fprintf(stderr, "Usage: %s [-n corpus paths] [-o operations per thread] "
+						"[-t max threads] [-p max processes] [-s seed] [-w workload,...] [-b store,...] "
+						"[-r reference CSV] [-a] [-e]\n", argv[0]);
+				return 1;
+		}
+	}
+	
+	if (corpusPaths == 0 || maxThreads < 1 || maxProcesses < 1)
+	{
+		fprintf(stderr, "%s: invalid arguments\n", argv[0]);
+		return 1;
+	}
+	
+	if (referenceFile != NULL && !readReferences(referenceFile))
+		return 1;
+	
+	generateCorpus(seed);
+	
+#ifndef __linux__
+	if (isPinning)
+	{
+		fprintf(stderr, "%s: -a is only supported on Linux, workers won't be pinned\n", argv[0]);
+		isPinning = false;
+	}
+#endif
+	
+	printf("store,workload,processes,threads,cores,pinned,operations,seconds,operations_per_second,"
+		   "relative_throughput,bytes_per_path,search_hit_ratio,search_p50_ns,search_p99_ns,search_max_ns,"
+		   "insert_p50_ns,insert_p99_ns,insert_max_ns,expansions,failures\n");
+	
+	//Otherwise every forked process would print it again
+	fflush(stdout);
+	
+	for (i = 0 ; i < NUMBER_OF_WORKLOADS ; ++i)
+	{
+		if (selectedWorkloads != NULL && !isSelected(workloads[i].name, selectedWorkloads))
+			continue;
+		
+		for (processes = 1 ; processes <= maxProcesses ; processes = nextCount(processes, maxProcesses))
+		{
+			for (threads = 1 ; threads <= maxThreads ; threads = nextCount(threads, maxThreads))
+			{
+				//The ctrie comes first, so the others are compared with it
+				for (j = 0 ; j < NUMBER_OF_STORES ; ++j)
+				{
+					if (selectedStores != NULL && !isSelected(stores[j].name, selectedStores))
+						continue;
+					
+					throughput = runWorkload(&stores[j], &workloads[i], processes, threads, seed);
+					
+					if (strcmp(stores[j].name, "ctrie") == 0 && referenceFile == NULL)
+						addReference(workloads[i].name, processes, threads, throughput);
+				}
+			}
+		}
+	}
+	
+	return 0;
+}
+
+
+
+//1, 2, 4, ... and `maxCount` even if it isn't a power of 2
+int nextCount(int count, int maxCount)
+{
+	
+	if (count == maxCount)
+		return maxCount + 1;
+	
+	return (count * 2 > maxCount ? maxCount : count * 2);
+}
+
+
+
+//`selectedNames` is a comma separated list of workloads or stores
+bool isSelected(const char *name, const char *selectedNames)
+{
+	
+	size_t length = strlen(name);
+	const char *found = selectedNames;
+	
+	while ((found = strstr(found, name)) != NULL)
+	{
+		if ((found == selectedNames || *(found - 1) == ',') &&
+			(found[length] == '\0' || found[length] == ','))
+			return true;
+		
+		found += length;
+	}
+	
+	return false;
+}
+
+
+
+uint64_t nextRandom(uint64_t *state)
+{
+	//xorshift64*
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	
+	return *state * 0x2545F4914F6CDD1DULL;
+}
+
+
+
+void generateCorpus(uint64_t seed)
+{
+	
+	//Weighted by repeating them
+	static const char *prefixes[] =
+	{
+		"/opt/local/bin/", "/opt/local/lib/", "/opt/local/lib/", "/opt/local/lib/",
+		"/opt/local/include/", "/opt/local/include/", "/opt/local/share/", "/opt/local/share/",
+		"/opt/local/libexec/", "/opt/local/etc/",
+		"/opt/local/var/macports/build/", "/opt/local/var/macports/build/",
+		"/opt/local/var/macports/software/", "/opt/local/var/macports/sources/",
+		"/usr/lib/", "/usr/bin/", "/usr/share/",
+		"/System/Library/Frameworks/", "/Library/Developer/CommandLineTools/usr/"
+	};
+	
+	static const char *syllables[] =
+	{
+		"ar", "bo", "cu", "da", "el", "fo", "gi", "ha", "ix", "jo", "ka", "lu",
+		"me", "no", "py", "qu", "ri", "su", "ta", "ve", "wo", "xy", "ze", "gtk", "ssl", "png"
+	};
+	
+	static const char *directories[] =
+	{
+		"include", "lib", "share", "doc", "man", "man1", "man3", "pkgconfig", "cmake",
+		"python3.11", "site-packages", "locale", "en.lproj", "Resources", "Headers",
+		"Versions", "A", "src", "bin", "etc", "work", "destroot", ".libs", "tests"
+	};
+	
+	static const char *extensions[] =
+	{
+		".h", ".h", ".h", ".c", ".o", ".dylib", ".a", ".pc", ".1", ".3", ".py",
+		".pyc", ".mo", ".txt", ".plist", ".la", ".cmake", ""
+	};
+	
+#define COUNT_OF(array) (sizeof(array) / sizeof(array[0]))
+#define PORTS 500
+	
+	char ports[PORTS][32];
+	char path[MAXPATHLEN];
+	uint64_t random = seed * 0x9E3779B97F4A7C15ULL + 1;
+	size_t i, length;
+	int j, k, depth;
+	double sum;
+	
+	for (i = 0 ; i < PORTS ; ++i)
+	{
+		length = sprintf(ports[i], "%s", (nextRandom(&random) % 4 == 0) ? "lib" : "");
+		
+		for (k = 2 + nextRandom(&random) % 2 ; k > 0 ; --k)
+			length += sprintf(ports[i] + length, "%s", syllables[nextRandom(&random) % COUNT_OF(syllables)]);
+		
+		if (nextRandom(&random) % 3 == 0)
+			sprintf(ports[i] + length, "%d", (int)(nextRandom(&random) % 10));
+	}
+	
+	paths            = (char **)malloc(sizeof(char *) * corpusPaths);
+	flagsOfPaths     = (uint8_t *)malloc(sizeof(uint8_t) * corpusPaths);
+	zipfDistribution = (double *)malloc(sizeof(double) * corpusPaths);
+	
+	if (paths == NULL || flagsOfPaths == NULL || zipfDistribution == NULL)
+	{
+		perror("malloc");
+		exit(1);
+	}
+	
+	for (i = 0 ; i < corpusPaths ; ++i)
+	{
+		length = sprintf(path, "%s%s/", prefixes[nextRandom(&random) % COUNT_OF(prefixes)],
+						 ports[nextRandom(&random) % PORTS]);
+		
+		for (depth = nextRandom(&random) % 4 ; depth > 0 ; --depth)
+			length += sprintf(path + length, "%s/", directories[nextRandom(&random) % COUNT_OF(directories)]);
+		
+		for (j = 1 + nextRandom(&random) % 3 ; j > 0 ; --j)
+			length += sprintf(path + length, "%s", syllables[nextRandom(&random) % COUNT_OF(syllables)]);
+		
+		sprintf(path + length, "%s", extensions[nextRandom(&random) % COUNT_OF(extensions)]);
+		
+		paths[i]        = strdup(path);
+		flagsOfPaths[i] = (nextRandom(&random) % 8 == 0) ? DENY_PATH : ALLOW_PATH;
+	}
+	
+	//Cumulative distribution, path `i` is accessed in proportion to 1/(i+1)^ZIPF_EXPONENT
+	for (sum = 0, i = 0 ; i < corpusPaths ; ++i)
+	{
+		sum += 1.0 / pow(i + 1, ZIPF_EXPONENT);
+		zipfDistribution[i] = sum;
+	}
+	
+	for (i = 0 ; i < corpusPaths ; ++i)
+	{
+		zipfDistribution[i] /= sum;
+	}
+	
+#undef COUNT_OF
+#undef PORTS
+}
+
+
+
+size_t pickPath(uint64_t *random)
+{
+	
+	double value = (nextRandom(random) >> 11) * (1.0 / 9007199254740992.0);
+	size_t low = 0, high = corpusPaths - 1, middle;
+	
+	while (low < high)
+	{
+		middle = (low + high) / 2;
+		
+		if (zipfDistribution[middle] < value)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	
+	return low;
+}
+
+
+
+bool readReferences(const char *file)
+{
+	
+	char line[1024], store[32], workload[32];
+	int processes, threads;
+	double throughput;
+	FILE *csv;
+	
+	csv = fopen(file, "r");
+	
+	if (csv == NULL)
+	{
+		perror(file);
+		return false;
+	}
+	
+	//The header and the rows of other stores are skipped
+	while (fgets(line, sizeof(line), csv) != NULL)
+	{
+		if (sscanf(line, "%31[^,],%31[^,],%d,%d,%*[^,],%*[^,],%*[^,],%*[^,],%lf",
+				   store, workload, &processes, &threads, &throughput) == 5 &&
+			strcmp(store, "ctrie") == 0)
+			addReference(workload, processes, threads, throughput);
+	}
+	
+	fclose(csv);
+	
+	if (numberOfReferences == 0)
+		fprintf(stderr, "%s: no results of the ctrie, relative_throughput will be empty\n", file);
+	
+	return true;
+}
+
+
+
+void addReference(const char *workload, int processes, int threads, double throughput)
+{
+	
+	references = (struct Reference *)realloc(references, sizeof(struct Reference) * (numberOfReferences + 1));
+	
+	if (references == NULL)
+	{
+		perror("realloc");
+		exit(1);
+	}
+	
+	snprintf(references[numberOfReferences].workload, sizeof(references[0].workload), "%s", workload);
+	
+	references[numberOfReferences].processes  = processes;
+	references[numberOfReferences].threads    = threads;
+	references[numberOfReferences].throughput = throughput;
+	
+	++numberOfReferences;
+}
+
+
+
+//0 if there is none
+double findReference(const char *workload, int processes, int threads)
+{
+	
+	size_t i;
+	
+	for (i = 0 ; i < numberOfReferences ; ++i)
+	{
+		if (strcmp(references[i].workload, workload) == 0 &&
+			references[i].processes == processes && references[i].threads == threads)
+			return references[i].throughput;
+	}
+	
+	return 0;
+}
+
+
+
+//Returns the operations per second of the run
+double runWorkload(const struct Store *store, const struct Workload *workload, int processes, int threads, uint64_t seed)
+{
+	
+	struct Run *run;
+	size_t runSize;
+	pid_t runner;
+	int status;
+	double throughput;
+	
+	runSize = sizeof(struct Run) + sizeof(struct WorkerResult) * processes * threads;
+	run = mmap(NULL, runSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	
+	if (run == MAP_FAILED)
+	{
+		perror("mmap");
+		exit(1);
+	}
+	
+	//Every run gets its own store, e.g., the ctrie its own files, so it is done in a child
+	runner = fork();
+	
+	if (runner == -1)
+	{
+		perror("fork");
+		exit(1);
+	}
+	
+	if (runner != 0)
+	{
+		waitpid(runner, &status, 0);
+		
+		throughput = run->throughput;
+		munmap(run, runSize);
+		
+		return throughput;
+	}
+	
+//________________________________________________________________________________
+//SET UP THE STORE AND INSERT EVERY OTHER PATH, UNLESS STARTING EMPTY
+//________________________________________________________________________________
+	
+	size_t expansionsBefore, expansionsAfter, storedPaths, i;
+	int p, t, cores;
+	uint8_t flags;
+	
+	store->setUp();
+	
+	for (i = 0 ; i < corpusPaths && !isStartingEmpty ; i += 2)
+	{
+		store->insert(paths[i], flagsOfPaths[i]);
+	}
+	
+	cores = sysconf(_SC_NPROCESSORS_ONLN);
+	
+//________________________________________________________________________________
+//FORK WORKER PROCESSES, EACH RUNNING `threads` WORKER THREADS
+//________________________________________________________________________________
+	
+	for (p = 0 ; p < processes ; ++p)
+	{
+		if (fork() != 0)
+			continue;
+		
+		pthread_t tids[threads];
+		struct Worker workers[threads];
+		
+		for (t = 0 ; t < threads ; ++t)
+		{
+			workers[t].run      = run;
+			workers[t].store    = store;
+			workers[t].workload = workload;
+			workers[t].result   = &run->results[p * threads + t];
+			workers[t].random   = (seed + 1) * 0x9E3779B97F4A7C15ULL + p * threads + t + 1;
+			workers[t].core     = isPinning ? (p * threads + t) % cores : -1;
+			
+			pthread_create(&tids[t], NULL, worker, &workers[t]);
+		}
+		
+		for (t = 0 ; t < threads ; ++t)
+		{
+			pthread_join(tids[t], NULL);
+		}
+		
+		exit(0);
+	}
+	
+//________________________________________________________________________________
+//START ALL THE WORKERS TOGETHER AND WAIT FOR THEM
+//________________________________________________________________________________
+	
+	struct timespec start, end;
+	
+	while (__atomic_load_n(&run->readyWorkers, __ATOMIC_ACQUIRE) != processes * threads)
+		usleep(100);
+	
+	expansionsBefore = store->expansions();
+	
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	
+	__atomic_store_n(&run->isStarted, 1, __ATOMIC_RELEASE);
+	
+	while (wait(NULL) > 0)
+		;
+	
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	
+	expansionsAfter = store->expansions();
+	
+	//For hash-private, only the paths inserted before forking are in this copy
+	for (storedPaths = 0, i = 0 ; i < corpusPaths ; ++i)
+	{
+		storedPaths += store->search(paths[i], &flags);
+	}
+	
+//________________________________________________________________________________
+//PRINT RESULTS
+//________________________________________________________________________________
+	
+	struct WorkerResult total;
+	char relativeThroughput[32] = "";
+	double seconds, reference;
+	int operation;
+	size_t bucket;
+	
+	memset(&total, 0, sizeof(total));
+	
+	for (i = 0 ; i < (size_t)(processes * threads) ; ++i)
+	{
+		for (operation = 0 ; operation < NUMBER_OF_OPERATIONS ; ++operation)
+		{
+			total.operations[operation] += run->results[i].operations[operation];
+			
+			for (bucket = 0 ; bucket < HISTOGRAM_BUCKETS ; ++bucket)
+				total.histogram[operation][bucket] += run->results[i].histogram[operation][bucket];
+		}
+		
+		total.hits     += run->results[i].hits;
+		total.failures += run->results[i].failures;
+	}
+	
+	seconds = elapsedNanoseconds(&start, &end) / 1e9;
+	
+	run->throughput = (total.operations[SEARCH] + total.operations[INSERT]) / seconds;
+	
+	reference = findReference(workload->name, processes, threads);
+	
+	if (reference != 0)
+		snprintf(relativeThroughput, sizeof(relativeThroughput), "%.3f", run->throughput / reference);
+	else if (strcmp(store->name, "ctrie") == 0)
+		snprintf(relativeThroughput, sizeof(relativeThroughput), "%.3f", 1.0);
+	
+	printf("%s,%s,%d,%d,%d,%d,%zu,%.3f,%.0f,%s,%.1f,%.3f,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu\n",
+		   store->name, workload->name, processes, threads,
+		   processes * threads < cores ? processes * threads : cores, isPinning,
+		   total.operations[SEARCH] + total.operations[INSERT], seconds,
+		   run->throughput, relativeThroughput,
+		   storedPaths ? (double)store->usedBytes() / storedPaths : 0.0,
+		   total.operations[SEARCH] ? (double)total.hits / total.operations[SEARCH] : 0.0,
+		   percentile(total.histogram[SEARCH], total.operations[SEARCH], 50),
+		   percentile(total.histogram[SEARCH], total.operations[SEARCH], 99),
+		   percentile(total.histogram[SEARCH], total.operations[SEARCH], 100),
+		   percentile(total.histogram[INSERT], total.operations[INSERT], 50),
+		   percentile(total.histogram[INSERT], total.operations[INSERT], 99),
+		   percentile(total.histogram[INSERT], total.operations[INSERT], 100),
+		   expansionsAfter - expansionsBefore,
+		   total.failures);
+	
+	fflush(stdout);
+	
+	store->tearDown();
+	
+	exit(0);
+}
+
+
+
+void *worker(void *arg)
+{
+	
+	struct Worker *worker = (struct Worker *)arg;
+	struct WorkerResult *result = worker->result;
+	
+	struct timespec start, end;
+	size_t i, pathIndex, nanoseconds;
+	int operation;
+	uint8_t flags;
+	bool isDone;
+	
+	if (worker->core != -1 && !pinToCore(worker->core))
+		fprintf(stderr, "Couldn't pin a worker to core %d\n", worker->core);
+	
+	__atomic_add_fetch(&worker->run->readyWorkers, 1, __ATOMIC_ACQ_REL);
+	
+	while (!__atomic_load_n(&worker->run->isStarted, __ATOMIC_ACQUIRE))
+		;
+	
+	for (i = 0 ; i < operationsPerThread ; ++i)
+	{
+		pathIndex = pickPath(&worker->random);
+		operation = (int)(nextRandom(&worker->random) % 100) < worker->workload->searchPercentage ? SEARCH : INSERT;
+		
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		
+		if (operation == SEARCH)
+			isDone = worker->store->search(paths[pathIndex], &flags);
+		else
+			isDone = worker->store->insert(paths[pathIndex], flagsOfPaths[pathIndex]);
+		
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		
+		nanoseconds = elapsedNanoseconds(&start, &end);
+		
+		++result->operations[operation];
+		++result->histogram[operation][latencyToBucket(nanoseconds)];
+		
+		if (operation == SEARCH)
+			result->hits += isDone;
+		else
+			result->failures += !isDone;
+	}
+	
+	return NULL;
+}
+
+
+
+//________________________________________________________________________________
+//STORES
+//________________________________________________________________________________
+
+
+
+void ctrieSetUp(void)
+{
+	
+	strcpy(dtsm_file, "macports-dtsm-XXXXXX");
+	
+	if (mktemp(dtsm_file)[0] == '\0' || !__dtsharedmemory_set_manager(dtsm_file))
+	{
+		fprintf(stderr, "__dtsharedmemory_set_manager() failed\n");
+		exit(1);
+	}
+}
+
+
+
+void ctrieTearDown(void)
+{
+	unlink(dtsm_file);
+}
+
+
+
+bool ctrieSearch(const char *path, uint8_t *flags)
+{
+	return __dtsharedmemory_search(path, flags);
+}
+
+
+
+bool ctrieInsert(const char *path, uint8_t flags)
+{
+	return __dtsharedmemory_insert(path, flags);
+}
+
+
+
+size_t ctrieUsedBytes(void)
+{
+	
+	struct SharedMemoryStats stats;
+	
+	__dtsharedmemory_get_stats(&stats);
+	
+	return stats.usedBytes;
+}
+
+
+
+size_t ctrieExpansions(void)
+{
+	
+	struct SharedMemoryStats stats;
+	
+	__dtsharedmemory_get_stats(&stats);
+	
+	return stats.expansions;
+}
+
+
+
+void hashSetUp(bool isShared)
+{
+	
+	pthread_mutexattr_t attributes;
+	size_t numberOfSlots = 1, keyBytes = 1, size, i;
+	
+	while (numberOfSlots < corpusPaths * HASH_SLOTS_PER_PATH)
+		numberOfSlots *= 2;
+	
+	for (i = 0 ; i < corpusPaths ; ++i)
+	{
+		keyBytes += strlen(paths[i]) + 1;
+	}
+	
+	size = sizeof(struct HashSet) + sizeof(struct HashSlot) * numberOfSlots + keyBytes;
+	
+	//A private mapping is copied on write by every worker process forked after this
+	hashSet = mmap(NULL, size, PROT_READ | PROT_WRITE,
+				   (isShared ? MAP_SHARED : MAP_PRIVATE) | MAP_ANONYMOUS, -1, 0);
+	
+	if (hashSet == MAP_FAILED)
+	{
+		perror("mmap");
+		exit(1);
+	}
+	
+	pthread_mutexattr_init(&attributes);
+	
+	if (isShared && (errno = pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED)) != 0)
+	{
+		perror("pthread_mutexattr_setpshared");
+		exit(1);
+	}
+	
+	pthread_mutex_init(&hashSet->lock, &attributes);
+	pthread_mutexattr_destroy(&attributes);
+	
+	hashSet->size          = size;
+	hashSet->numberOfSlots = numberOfSlots;
+	hashSet->keys          = (char *)&hashSet->slots[numberOfSlots];
+	
+	//So that 0 is never an offset to a key
+	hashSet->usedKeyBytes  = 1;
+}
+
+
+
+void hashPrivateSetUp(void)
+{
+	hashSetUp(false);
+}
+
+
+
+void hashSharedSetUp(void)
+{
+	hashSetUp(true);
+}
+
+
+
+void hashTearDown(void)
+{
+	munmap(hashSet, hashSet->size);
+}
+
+
+
+//Returns the slot of `path`, or the empty slot where it would go. Needs `lock`.
+struct HashSlot *hashFind(const char *path, uint64_t hash)
+{
+	
+	size_t mask = hashSet->numberOfSlots - 1;
+	size_t slot = hash & mask;
+	
+	//Never full, so an empty slot is always found
+	while (hashSet->slots[slot].key != 0)
+	{
+		if (hashSet->slots[slot].hash == hash && strcmp(hashSet->keys + hashSet->slots[slot].key, path) == 0)
+			break;
+		
+		slot = (slot + 1) & mask;
+	}
+	
+	return &hashSet->slots[slot];
+}
+
+
+
+uint64_t hashOf(const char *path)
+{
+	
+	//FNV-1a
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	
+	for ( ; *path != '\0' ; ++path)
+	{
+		hash ^= (uint8_t)*path;
+		hash *= 0x100000001B3ULL;
+	}
+	
+	return hash;
+}
+
+
+
+bool hashSearch(const char *path, uint8_t *flags)
+{
+	
+	uint64_t hash = hashOf(path);
+	struct HashSlot *slot;
+	bool isFound;
+	
+	pthread_mutex_lock(&hashSet->lock);
+	
+	slot    = hashFind(path, hash);
+	isFound = (slot->key != 0);
+	
+	if (isFound)
+		*flags = slot->flags;
+	
+	pthread_mutex_unlock(&hashSet->lock);
+	
+	return isFound;
+}
+
+
+
+bool hashInsert(const char *path, uint8_t flags)
+{
+	
+	uint64_t hash = hashOf(path);
+	struct HashSlot *slot;
+	size_t length;
+	
+	pthread_mutex_lock(&hashSet->lock);
+	
+	slot = hashFind(path, hash);
+	
+	//Only corpus paths are inserted and `keys` has room for all of them
+	if (slot->key == 0)
+	{
+		length = strlen(path) + 1;
+		
+		memcpy(hashSet->keys + hashSet->usedKeyBytes, path, length);
+		
+		slot->hash = hash;
+		slot->key  = hashSet->usedKeyBytes;
+		
+		hashSet->usedKeyBytes += length;
+	}
+	
+	slot->flags = flags;
+	
+	pthread_mutex_unlock(&hashSet->lock);
+	
+	return true;
+}
+
+
+
+size_t hashUsedBytes(void)
+{
+	return sizeof(struct HashSet) + sizeof(struct HashSlot) * hashSet->numberOfSlots + hashSet->usedKeyBytes;
+}
+
+
+
+size_t hashExpansions(void)
+{
+	return 0;
+}
+
+
+
+//________________________________________________________________________________
+//HELPERS
+//________________________________________________________________________________
+
+
+
+bool pinToCore(int core)
+{
+	
+#ifdef __linux__
+	
+	cpu_set_t cpus;
+	
+	CPU_ZERO(&cpus);
+	CPU_SET(core, &cpus);
+	
+	//0 is the calling thread
+	return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+	
+#else
+	
+	return false;
+	
+#endif
+	
+}
+
+
+
+size_t elapsedNanoseconds(const struct timespec *start, const struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * (size_t)1000000000 + end->tv_nsec - start->tv_nsec;
+}
+
+
+
+size_t latencyToBucket(size_t nanoseconds)
+{
+	
+	size_t bucket;
+	int leadingBit;
+	
+	if (nanoseconds < 8)
+		return nanoseconds;
+	
+	leadingBit = sizeof(size_t) * 8 - 1 - __builtin_clzl(nanoseconds);
+	
+	bucket = (leadingBit - 2) * 8 + ((nanoseconds >> (leadingBit - 3)) & 7);
+	
+	return (bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1);
+}
+
+
+
+size_t bucketToLatency(size_t bucket)
+{
+	
+	size_t leadingBit;
+	
+	if (bucket < 8)
+		return bucket;
+	
+	leadingBit = bucket / 8 + 2;
+	
+	return ((8 + bucket % 8 + 1) << (leadingBit - 3)) - 1;
+}
+
+
+
+size_t percentile(const size_t *histogram, size_t samples, double percent)
+{
+	
+	size_t bucket, counted = 0;
+	
+	if (samples == 0)
+		return 0;
+	
+	for (bucket = 0 ; bucket < HISTOGRAM_BUCKETS ; ++bucket)
+	{
+		counted += histogram[bucket];
+		
+		if (counted != 0 && counted >= percent / 100 * samples)
+			return bucketToLatency(bucket);
+	}
+	
+	return bucketToLatency(HISTOGRAM_BUCKETS - 1);
+}
@@ -37,6 +37,10 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <string.h>
+#include <signal.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
 
 
 #include "dtsharedmemory.h"
@@ -51,6 +55,47 @@
 #endif
 
 
+/**
+ *	Static tracepoints for DTrace, bpftrace, perf and the like, e.g.,
+ *		bpftrace -e 'usdt:./libdtsharedmemory.so:dtsharedmemory:insert__retry { @[pid, str(arg0)] = count(); }'
+ *	They are a NOP until something attaches to them. Without HAVE_SYS_SDT_H they are left out.
+ *	Probes:
+ *		search__entry(path)                  search__return(path, found, flags)
+ *		insert__entry(path, flags)           insert__return(path, result)
+ *		insert__retry(path)                  A CAS was lost or a removed node was found
+ *		expand__entry(offset, mappingSize)   expand__return(offset, mappingSize)
+ *		dump(wastedOffset, parentINode)
+ *		recycle(reusableOffset, parentINode) recycle__miss(parentINode)
+ **/
+#ifdef HAVE_SYS_SDT_H
+#	include <sys/sdt.h>
+#	define PROBE1(name, a)       DTRACE_PROBE1(dtsharedmemory, name, a)
+#	define PROBE2(name, a, b)    DTRACE_PROBE2(dtsharedmemory, name, a, b)
+#	define PROBE3(name, a, b, c) DTRACE_PROBE3(dtsharedmemory, name, a, b, c)
+#else
+#	define PROBE1(name, a)       do {} while (0)
+#	define PROBE2(name, a, b)    do {} while (0)
+#	define PROBE3(name, a, b, c) do {} while (0)
+#endif
+
+
+/**
+ *
+ *	Offsets to CNodes freed by __dtsharedmemory_remove() are kept in a stack
+ *	in the status header. The upper bits of the top of the stack contain a tag which is
+ *	incremented with every push and pop, so that a stale top can't be CAS'd (ABA problem).
+ *	The tag needs bits that an offset never uses, hence only on 64 bit machines.
+ *
+ **/
+#if !(DISABLE_DUMPING_AND_RECYCLING) && defined(__LP64__)
+#	define FREED_CNODES_STACK_AVAILABLE 1
+#	define FREED_CNODES_TAG_SHIFT 48
+#	define FREED_CNODES_OFFSET_MASK (((size_t)1 << FREED_CNODES_TAG_SHIFT) - 1)
+#else
+#	define FREED_CNODES_STACK_AVAILABLE 0
+#endif
+
+
 #ifdef HAVE_STDATOMIC_H
 static _Atomic(struct SharedMemoryManager *) manager = NULL;
 #else
@@ -59,7 +104,198 @@ static         struct SharedMemoryManager *  manager = NULL;
 
 
 
-#define FILE_PERMISSIONS 0600 //Permissions for status file and shared memory file
+/**
+ *	`manager` points to `managerStorage` once __dtsharedmemory_set_manager() has set it up.
+ *	If many threads call it together, `isManagerClaimed` picks the one that does.
+ **/
+static struct SharedMemoryManager managerStorage;
+
+
+
+/**
+ *	Every mapping of shared memory file made by this process, the largest of which is
+ *	`currentMapping`. The first `mappingsUsed` of them have been taken.
+ *	`mapping` is the copy of the calling thread, which GOTO_OFFSET uses without touching
+ *	any of the above until an offset is beyond it. Mappings are never unmapped,
+ *	so an old copy is still good for the offsets it covers.
+ **/
+static struct SharedMemoryMapping mappings [MAX_MAPPINGS];
+static __thread struct SharedMemoryMapping mapping;
+
+#ifdef HAVE_STDATOMIC_H
+static _Atomic(struct SharedMemoryMapping *) currentMapping = NULL;
+static _Atomic(size_t) mappingsUsed;
+static _Atomic(size_t) isManagerClaimed;
+#else
+static         struct SharedMemoryMapping *  currentMapping = NULL;
+static         size_t  mappingsUsed;
+static         size_t  isManagerClaimed;
+#endif
+
+
+
+/**
+ *	Name of shared memory file given to __dtsharedmemory_set_manager_lazily(),
+ *	which attachDeferred() attaches to when Global(manager) is first needed.
+ *	`deferredAttach` is one of DEFERRED_* below.
+ **/
+#define DEFERRED_NONE    0 //__dtsharedmemory_set_manager_lazily() not called
+#define DEFERRED_SETTING 1 //`deferredFileName` is being written
+#define DEFERRED_PENDING 2 //Not attached yet
+#define DEFERRED_FAILED  3 //Attaching failed, it isn't tried again
+
+static char deferredFileName [PATH_MAX];
+
+//Set while this thread attaches, so that the library called meanwhile (e.g., by the error sink) doesn't attach again
+static __thread bool isAttaching;
+
+
+
+/**
+ *	Set by __dtsharedmemory_set_mapping_advice(), used by adviseMapping()
+ **/
+static size_t prefaultSize = PREFAULT_SIZE;
+static bool   isTailRandom = ADVISE_RANDOM_TAIL;
+
+/**
+ *	Set by __dtsharedmemory_set_manager_ex(), then replaced by setUpHeader()
+ *	with the options recorded in the header of shared memory file.
+ **/
+static struct SharedMemoryOptions options;
+
+#ifdef HAVE_STDATOMIC_H
+static _Atomic(size_t) deferredAttach;
+#else
+static         size_t  deferredAttach;
+#endif
+
+
+
+/**
+ *	Namespace of this thread set by __dtsharedmemory_set_namespace(), prepended
+ *	to every path by keyForPath(). `namespaceLength` is 0 for the default namespace.
+ **/
+static __thread char   namespaceName [NAMESPACE_SIZE];
+static __thread size_t namespaceLength;
+
+
+
+/**
+ *	Where keyForPath() writes a path prepended with NAMESPACE_SEPARATOR and the namespace.
+ **/
+static __thread char namespacedPath [1 + NAMESPACE_SIZE + PATH_MAX];
+
+
+
+/**
+ *	Space of a tail that never got linked into the ctrie and couldn't be given back
+ *	by releaseReservedSpace(). Instead of wasting it, it is filled with '\0' and kept
+ *	for the next tail created by the same thread. See keepSpareTailSpace().
+ *	`pid` is recorded because a child created by fork(2) inherits it, while the
+ *	space still belongs to the parent. `compactions` is recorded because the space may be
+ *	in the region __dtsharedmemory_compact() has since given up, see isSpareUsable().
+ **/
+static __thread struct
+{
+	size_t offset;
+	size_t size;
+	pid_t  pid;
+	size_t compactions;
+} spareTailSpace;
+
+
+
+#if FREED_CNODES_STACK_AVAILABLE
+/**
+ *	INodes are only recycled with SHARED_MEMORY_CAP (see recycledINodes),
+ *	so once all the CNodes of a tail are reused, reserving space just for its INodes
+ *	would still make the shared memory grow. Instead, a freed CNode is turned into
+ *	INODES_IN_CNODE INodes for the tails created by this thread, see takeSpareINodes().
+ *	`pid` and `compactions` are recorded for the same reasons as in spareTailSpace.
+ **/
+static __thread struct
+{
+	size_t offset;
+	size_t count;
+	pid_t  pid;
+	size_t compactions;
+} spareINodes;
+#endif
+
+
+
+#if SHARED_MEMORY_CAP
+/**
+ *	INodes taken out of the ctrie by this thread are collected in the freed CNode at
+ *	`filling` until there are INODES_IN_BUNDLE of them, which are then pushed together
+ *	on `freedINodes` stack in the status header. Tails created by this thread take their INodes
+ *	from the bundle at `taking`, of which `taken` have been used. See freeINode().
+ *	`pid` is recorded for the same reason as in spareTailSpace.
+ **/
+static __thread struct
+{
+	size_t filling;
+	size_t taking;
+	size_t taken;
+	pid_t  pid;
+} recycledINodes;
+
+
+
+/**
+ *	Set while this thread evicts paths. Removing a path may need a CNode for a copy
+ *	and the eviction would be stuck if that failed because of the cap itself,
+ *	so reserveSpaceInSharedMemory() ignores SHARED_MEMORY_CAP for this thread meanwhile.
+ **/
+static __thread bool isEvicting;
+#endif
+
+
+
+#if !(DISABLE_STATISTICS)
+/**
+ *	1 + the shard of `stats` in the status header this thread counts into, 0 until countStat()
+ *	chooses one. A child created by fork(2) keeps using the shard of the thread
+ *	that forked, which only costs some sharing of a cache line.
+ *	`threadsCounting` spreads the threads of a process over the shards.
+ **/
+static __thread size_t statsShard;
+
+#	ifdef HAVE_STDATOMIC_H
+static _Atomic(size_t) threadsCounting;
+#	else
+static         size_t  threadsCounting;
+#	endif
+#endif
+
+
+
+#if LATENCY_SAMPLING
+/**
+ *	Calls of each operation this thread makes before the next one is timed,
+ *	see startLatencySample(). Counted separately, otherwise a thread which searches
+ *	every path it inserts would only ever time one of the two.
+ **/
+static __thread size_t callsBeforeLatencySample [NUMBER_OF_LATENCIES];
+#endif
+
+
+
+/**
+ *	Latest failures of this thread, recorded by recordError(). The latest one is at
+ *	`errorsRecorded - 1`, modulo ERROR_RING_SIZE.
+ *	`errorSink` is set by __dtsharedmemory_set_error_sink().
+ **/
+static __thread struct SharedMemoryError errorRing [ERROR_RING_SIZE];
+static __thread size_t errorsRecorded;
+
+static void (*errorSink)(const struct SharedMemoryError *error);
+
+bool __dtsharedmemory_are_debug_messages_on;
+
+
+
+#define FILE_PERMISSIONS 0600 //Permissions for shared memory file
 
 /*Empty comments are placed all over to avoid crazy indentation caused by auto-indent on macro definitions*/
 
@@ -71,6 +307,9 @@ static         struct SharedMemoryManager *  manager = NULL;
 #	define CAS_size_t(old, new, mem) \
 /**/		atomic_compare_exchange_strong_explicit(mem, old, new, memory_order_relaxed, memory_order_relaxed)
 
+#	define ADD_size_t(value, mem) \
+/**/		atomic_fetch_add_explicit(mem, value, memory_order_relaxed)
+
 
 #elif \
 defined(HAVE_OSATOMICCOMPAREANDSWAPPTR) && \
@@ -86,9 +325,13 @@ defined(HAVE_OSATOMICCOMPAREANDSWAPPTR) && \
 #	ifdef __LP64__
 #		define CAS_size_t(old, new, mem) \
 /**/			OSAtomicCompareAndSwap64((int64_t) (*old), (int64_t) (new), (volatile int64_t *) (mem))
+#		define ADD_size_t(value, mem) \
+/**/			OSAtomicAdd64((int64_t) (value), (volatile int64_t *) (mem))
 #	else
 #		define CAS_size_t(old, new, mem) \
 /**/			OSAtomicCompareAndSwap32((int32_t) (*old), (int32_t) (new), (volatile int32_t *) (mem))
+#		define ADD_size_t(value, mem) \
+/**/			OSAtomicAdd32((int32_t) (value), (volatile int32_t *) (mem))
 #	endif
 
 #else
@@ -140,11 +383,255 @@ defined(HAVE_OSATOMICCOMPAREANDSWAPPTR) && \
 
 
 
+/**
+ *
+ *	Rounds `bytes` up to a multiple of sizeof(size_t).
+ *	Every reservation is rounded this way so that reserved offsets stay aligned.
+ *	INodes are written at reserved offsets and an atomic operation on an INode
+ *	that lies across two cache lines is extremely slow (it needs a bus lock).
+ *
+ **/
+#define ALIGNED_SIZE(bytes) (((bytes) + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1))
+
+
+
+/**
+ *
+ *	Space taken by a CNode when many of them are written in a single reservation,
+ *	as in createPrivateTail(). PADDING_BYTES are kept after each CNode so that
+ *	it can be dumped and recycled like any other. It is rounded like reservations
+ *	so that the CNodes stay aligned, which matters when one of them is reused for INodes.
+ *
+ **/
+#define CNODE_BLOCK_SIZE ALIGNED_SIZE(sizeof(CNode) + PADDING_BYTES)
+
+
+
+/**
+ *
+ *	Space taken by a node, an INode followed by its CNode, in the region
+ *	__dtsharedmemory_compact() copies the ctrie to. The CNode is a CNode block,
+ *	so that it can be freed like any other once it is replaced.
+ *
+ **/
+#define COMPACTED_NODE_SIZE (ALIGNED_SIZE(sizeof(INode)) + CNODE_BLOCK_SIZE)
+
+
+
+/**
+ *
+ *	Number of INodes that fit in the space of a CNode, after aligning its offset.
+ *	See spareINodes.
+ *
+ **/
+#define INODES_IN_CNODE ((sizeof(CNode) - sizeof(size_t) + 1) / sizeof(INode))
+
+
+
+/**
+ *
+ *	Number of offsets to INodes a freed CNode holds when it is used as a bundle
+ *	of recycled INodes. The first 2 places are for the offset to the next bundle
+ *	and the number of INodes in it. See recycledINodes.
+ *
+ **/
+#define INODES_IN_BUNDLE (INODES_IN_CNODE - 2)
+
+
+
+/**
+ *
+ *	Tomb CNode is an empty CNode which is never written to. It lies right after the
+ *	root CNode (and its PADDING_BYTES) and nothing else is ever written there.
+ *	An INode pointing to it is dead and its `mainNode` is never changed again,
+ *	except when it is recycled after being taken out of the ctrie (see freeINode()).
+ *	As the tomb CNode is empty, __dtsharedmemory_search() needs no special handling
+ *	for it, but writers must never replace it. See __dtsharedmemory_remove().
+ *
+ **/
+#define TOMB_CNODE_OFFSET (ROOT_SIZE + PADDING_BYTES)
+
+
+
+#if SHARED_MEMORY_CAP && !(FREED_CNODES_STACK_AVAILABLE)
+#	error SHARED_MEMORY_CAP needs the stack of freed CNodes to reuse evicted memory.
+#endif
+
+#if HOT_LEVELS && !(FREED_CNODES_STACK_AVAILABLE)
+#	error HOT_LEVELS needs the stack of freed CNodes to reuse CNodes of the hot region.
+#endif
+
+
+
+/**
+ *
+ *	With SHARED_MEMORY_CAP, CNodes and INodes are reused over and over (see dumpWastedMemory()
+ *	and freeINode()), so a CNode can come back to an INode while a slow thread still holds
+ *	it as the old value of a CAS. So, like the top of `freedCNodes`, `mainNode` of an INode
+ *	carries a version in its upper bits, which every CAS of it increments, and a stale
+ *	CAS fails even if the offset is the same again.
+ *	MAIN_NODE() is the offset in `mainNode` and NEXT_MAIN_NODE() the value to CAS in place of
+ *	`oldMainNode` to make it point to `offset`. Without SHARED_MEMORY_CAP both are only the offset.
+ *	REFERENCED_MAIN_NODE is the bit of `mainNode` evictColdPaths() looks at, see markAsReferenced().
+ *	Keeping it in `mainNode` rather than in the CNode means setting it is a CAS of the same
+ *	versioned value, which fails once the INode or its CNode has been reused.
+ *
+ **/
+#if SHARED_MEMORY_CAP
+#	define REFERENCED_MAIN_NODE ((size_t)1 << (FREED_CNODES_TAG_SHIFT - 1))
+#	define MAIN_NODE(mainNode) ((mainNode) & FREED_CNODES_OFFSET_MASK & ~REFERENCED_MAIN_NODE)
+#	define NEXT_MAIN_NODE(oldMainNode, offset) \
+/**/		((offset) | ((((oldMainNode) >> FREED_CNODES_TAG_SHIFT) + 1) << FREED_CNODES_TAG_SHIFT))
+#else
+#	define REFERENCED_MAIN_NODE 0
+#	define MAIN_NODE(mainNode) (mainNode)
+#	define NEXT_MAIN_NODE(oldMainNode, offset) (offset)
+#endif
+
+/**
+ *
+ *	__dtsharedmemory_compact() hands the old region out again through the stack of freed CNodes.
+ *	Under SHARED_MEMORY_CAP, there is no room for a copy of the ctrie anyway.
+ *
+ **/
+#if FREED_CNODES_STACK_AVAILABLE && !(SHARED_MEMORY_CAP)
+#	define COMPACTION_AVAILABLE 1
+#else
+#	define COMPACTION_AVAILABLE 0
+#endif
+
+#if COMPACTION_AVAILABLE
+/**
+ *	Slot of `readers` in the status header claimed by this process, see getReaderSlot().
+ *	`readerSlot` is one of READER_SLOT_* below, or READER_SLOT_FIRST plus the slot.
+ *	A child created by fork(2) claims its own, see forgetReaderSlot().
+ **/
+#	define READER_SLOT_NONE     0 //Not claimed yet
+#	define READER_SLOT_CLAIMING 1 //Being claimed by a thread of this process
+#	define READER_SLOT_FIRST    2
+
+#	ifdef HAVE_STDATOMIC_H
+static _Atomic(size_t) readerSlot;
+#	else
+static         size_t  readerSlot;
+#	endif
+
+static bool isForkHandlerSet;
+#endif
+
+//Returned by startReading() when nothing was counted
+#define NOT_READING SIZE_MAX
+
+#if FREED_CNODES_STACK_AVAILABLE
+//`freedCNodes` or `freedHotCNodes` in the status header
+#	ifdef HAVE_STDATOMIC_H
+typedef _Atomic(size_t) FreedCNodesTop;
+#	else
+typedef size_t          FreedCNodesTop;
+#	endif
+#endif
+
+
+
+/**
+ *
+ *	The hot region (see HOT_LEVELS) starts right after the root and the tomb CNode.
+ *	reserveSpaceInSharedMemory() hands out space from FIRST_WRITE_OFFSET.
+ *
+ **/
+#define HOT_REGION_OFFSET ALIGNED_SIZE(TOMB_CNODE_OFFSET + sizeof(CNode))
+
+#if HOT_LEVELS
+#	define FIRST_WRITE_OFFSET (HOT_REGION_OFFSET + ALIGNED_SIZE(HOT_REGION_SIZE))
+#else
+#	define FIRST_WRITE_OFFSET HOT_REGION_OFFSET
+#endif
+
+
+
+/**
+ *
+ *	evictColdPaths() stops once it has evicted this many nodes.
+ *
+ **/
+#define EVICTION_BATCH_SIZE 1024
+
+
+
+/**
+ *
+ *	Every insertion and compaction tombs at most about this many INodes of the subtrees
+ *	detached by __dtsharedmemory_remove_prefix() and __dtsharedmemory_reset(),
+ *	see reclaimDetachedSubtrees().
+ *
+ **/
+#define RECLAIM_BATCH_SIZE 32
+
+
+
+/**
+ *
+ *	A thread which needs memory while another one is evicting, waits for it in steps of
+ *	EVICTION_WAIT_INTERVAL microseconds, at most EVICTION_WAIT_LIMIT times.
+ *
+ **/
+#define EVICTION_WAIT_INTERVAL 100
+#define EVICTION_WAIT_LIMIT    100
+
+
+
+/**
+ *
+ *	A thread which needs shared memory file to grow while another one is growing it,
+ *	waits for it in steps of GROWTH_WAIT_INTERVAL microseconds, at most GROWTH_WAIT_LIMIT times.
+ *
+ **/
+#define GROWTH_WAIT_INTERVAL 100
+#define GROWTH_WAIT_LIMIT    10000
+
+
+
+/**
+ *
+ *	Insertions and removals made while __dtsharedmemory_compact() copies the ctrie
+ *	wait for it in steps of COMPACTION_WAIT_INTERVAL microseconds.
+ *	The region for the copy has room for COMPACTION_SLACK more nodes than were counted,
+ *	plus 1 in 8, for the nodes added by insertions which had started before.
+ *
+ **/
+#define COMPACTION_WAIT_INTERVAL 100
+#define COMPACTION_SLACK         64
+
+
+
+/**
+ *
+ *	Under SHARED_MEMORY_CAP, a tail has at most TAIL_PIECE_NODES nodes. Once the cap is
+ *	reached, its INodes can only be taken from a single bundle of recycled INodes or
+ *	a single freed CNode (see createPrivateTail()), so a longer missing suffix is linked
+ *	a piece at a time, each below the one before, by __dtsharedmemory_insert().
+ *
+ **/
+#define TAIL_PIECE_NODES INODES_IN_BUNDLE
+
+
+
+/**
+ *
+ *	Number of times createPrivateTail() and getSpaceForCNode() call evictColdPaths() before giving up,
+ *	as long as evictColdPaths() says trying again is worth it.
+ *
+ **/
+#define EVICTION_ATTEMPTS 16
+
+
+
 /**
  *	In its simplest form, its equivalent to:-
- *		`manager->sharedMemoryFile_mmap_base + offset`
- *		and check if offset is not out of range of current mapped memory
- *		and if offset is out of range, call expandSharedMemory().
+ *		`mapping.base + offset`
+ *		and check if offset is not out of range of the mapping of this thread
+ *		and if offset is out of range, call expandSharedMemory(), which also
+ *		catches up with mappings made by other threads.
  *
  *	The inner set of ternary operators check if for accessing
  *	specified offset, expansion of mapped region is required or no and the outer set of ternary
@@ -156,7 +643,7 @@ defined(HAVE_OSATOMICCOMPAREANDSWAPPTR) && \
  *	and __dtsharedmemory_search(),
  *	and is majorly useful when offsets `traverser` and `currentINode->mainNode` need to be
  *	calculated. When traverser's value is fetched, obviously, the next step would be:
- *	`currentINode = manager->baseAddressOfSharedMemory + traverser`
+ *	`currentINode = mapping.base + traverser`
  *	After which `currentINode->mainNode` will be accessed.
  *	When value of traverser is fetched, it only ensures that upto traverser,
  *	memory is within range and expansion is not needed. There can be a case
@@ -167,10 +654,19 @@ defined(HAVE_OSATOMICCOMPAREANDSWAPPTR) && \
  *	upto `currentINode->mainNode + sizeof(CNode)`.
  *	Hence, to make things simple we always check upto `sizeof(CNode) + sizeof(INode)`.
  **/
+#if RESERVED_MAPPING_GB
+
+//The whole range is mapped by `mappings[0]` and offsets are never beyond the file, see
+//RESERVED_MAPPING_GB in dtsharedmemory.h. `mappings[0]` is used instead of `mapping`
+//as it is set before `manager`, whereas `mapping` of a new thread is still empty.
+#define GOTO_OFFSET(offset) (mappings[0].base + (offset))
+
+#else
+
 #define GOTO_OFFSET(offset)  \
 /*Check if expansion needed; evaluates to true if offset can be accessed safely*/ \
 (\
-/*if*/   ((offset + sizeof(CNode) + sizeof(INode)) > manager->sharedMemoryFile_mapping_size ? \
+/*if*/   ((offset + sizeof(CNode) + sizeof(INode)) > mapping.size ? \
 /*then*/ expandSharedMemory((offset + sizeof(CNode) + sizeof(INode))) :\
 /*else*/ true)\
 \
@@ -179,10 +675,12 @@ defined(HAVE_OSATOMICCOMPAREANDSWAPPTR) && \
 \
 /*if (above expression evaluates to true)*/?\
 \
-/*then*/(manager->sharedMemoryFile_mmap_base + offset) :\
+/*then*/(mapping.base + offset) :\
 /*else*/NULL\
 )
 
+#endif
+
 
 
 /**
@@ -208,10 +706,10 @@ defined(HAVE_OSATOMICCOMPAREANDSWAPPTR) && \
 /**/		do\
 /**/		{\
 /**/			oldMainNode = currentINode->mainNode;\
-/**/			currentCNode = GOTO_OFFSET(oldMainNode);\
-/**/			FAIL_IF(!currentCNode, "currentCNode found NULL", false);\
+/**/			currentCNode = GOTO_OFFSET(MAIN_NODE(oldMainNode));\
+/**/			FAIL_IF(!currentCNode, ERROR_BAD_OFFSET, "currentCNode found NULL", false);\
 /**/			statement;\
-/**/		}while( oldMainNode != currentINode->mainNode );\
+/**/		}while( oldMainNode != currentINode->mainNode && countStat(STAT_GUARD_RETRIES) );\
 /**/	}
 
 
@@ -222,74 +720,105 @@ defined(HAVE_OSATOMICCOMPAREANDSWAPPTR) && \
 /**/	{\
 /**/		size_t oldMainNode;\
 /**/		oldMainNode = currentINode->mainNode;\
-/**/		currentCNode = GOTO_OFFSET(oldMainNode);\
-/**/		FAIL_IF(!currentCNode, "currentCNode found NULL", false);\
+/**/		currentCNode = GOTO_OFFSET(MAIN_NODE(oldMainNode));\
+/**/		FAIL_IF(!currentCNode, ERROR_BAD_OFFSET, "currentCNode found NULL", false);\
 /**/		statement;\
 /**/	}
 
 #endif
 
 
+
+/**
+ *
+ *	Copies the value of `cNode` to `destination`, unless it is NULL. To be used inside
+ *	GUARD_CNODE_ACCESS, so that it is read from the same CNode as the flags.
+ *
+ **/
+#if VALUE_SIZE
+#	define COPY_VALUE(destination, cNode) if ((destination) != NULL) memcpy((destination), (cNode)->value, VALUE_SIZE)
+#else
+#	define COPY_VALUE(destination, cNode)
+#endif
+
+
 //Prototypes #START#
 //if vim, press % on '{' to reach end of prototypes
 //{
 
 /**
  *
- *	This function allocates memory for a the Global(manager).
- *	It opens status file and shared memory file by calling
- *	openStatusFile() and openSharedMemoryFile().
- *	Those 2 functions set the manager's members to appropriate values.
+ *	This function sets up `managerStorage` and points Global(manager) to it.
+ *	It opens shared memory file by calling openSharedMemoryFile(),
+ *	which sets the manager's members to appropriate values.
  *	This function would return if Global(manager) is not NULL.
  *
  *	Arguments:
  *
- *	#Arg1(status_file_name):
- *		Name of the status file.
- *
- *	#Arg2(shared_memory_file_name):
+ *	#Arg1(shared_memory_file_name):
  *		Name of the shared memory file
  *
  **/
-bool __dtsharedmemory_set_manager(const char *status_file_name, const char *shared_memory_file_name);
+bool __dtsharedmemory_set_manager(const char *shared_memory_file_name);
 
 
 
 /**
  *
- *	This function opens the file `status_file_name`,
- *	and calls mmap(2) with fd of this file and it sets all status file related members in
- *	Global(manager).
+ *	This function only copies `shared_memory_file_name` to `deferredFileName`,
+ *	without any system call. The first function needing Global(manager) calls
+ *	__dtsharedmemory_set_manager() with it through MANAGER_OR_ATTACH.
  *
  *	Arguments:
  *
- *	#Arg1(new_manager):
- *		A newly allocated `struct SharedMemoryManager` object.
- *
- *	#Arg2(status_file_name):
- *		Name of the status file.
+ *	#Arg1(shared_memory_file_name):
+ *		Name of the shared memory file
  *
  **/
-bool openStatusFile(struct SharedMemoryManager *new_manager, const char *status_file_name);
+bool __dtsharedmemory_set_manager_lazily(const char *shared_memory_file_name);
+bool __dtsharedmemory_set_manager_ex(const char *shared_memory_file_name, const struct SharedMemoryOptions *options);
 
 
 
 /**
  *
  *	This function opens the file `shared_memory_file_name`,
- *	and calls mmap(2) with fd of this file and it sets all shared memory file related members in
- *	Global(manager).
+ *	and calls mmap(2) with fd of this file and it sets all members of `new_manager`.
+ *	The header of the file is set up by setUpHeader() and the status header
+ *	and the root INode are given their initial values if the file is new.
  *
  *	Arguments:
  *
  *	#Arg1(new_manager):
- *		A newly allocated `struct SharedMemoryManager` object.
+ *		A `struct SharedMemoryManager` object to be filled.
  *
  *	#Arg2(shared_memory_file_name):
  *		Name of the shared memory file.
  *
+ *	#Arg3(new_mapping):
+ *		Where the mapping of shared memory file is written.
+ *
+ **/
+bool openSharedMemoryFile(struct SharedMemoryManager *new_manager, const char *shared_memory_file_name,
+						  struct SharedMemoryMapping *new_mapping);
+
+
+
+/**
+ *
+ *	This function writes the layout of shared memory file into its `header` if nobody
+ *	has done it yet, otherwise it waits till it is written. Returns false if the layout
+ *	written isn't the one this library was built with, in which case the file
+ *	mustn't be used, or if Global(options) differ from the ones recorded.
+ *	Global(options) are then set to the recorded ones.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(header):
+ *		Header at the start of the mapping of shared memory file.
+ *
  **/
-bool openSharedMemoryFile(struct SharedMemoryManager *new_manager, const char *shared_memory_file_name);
+bool setUpHeader(struct SharedMemoryHeader *header);
 
 
 
@@ -297,8 +826,9 @@ bool openSharedMemoryFile(struct SharedMemoryManager *new_manager, const char *s
  *
  *	This function inserts a string `path` along with `flags` into the shared memory.
  *	If insertion is successful, it returns true else false.
- *	The shared memory follows a ctrie data structure. Although it doesn't implement
- *	tomb nodes due to lack of need to remove nodes.
+ *	If `path` already exists with the same `flags`, nothing is written to the
+ *	shared memory and it simply returns true.
+ *	The shared memory follows a ctrie data structure.
  *
  *	Arguments:
  *
@@ -318,8 +848,7 @@ bool __dtsharedmemory_insert(const char *path, uint8_t flags);
  *	This function searches for a string `path` in the shared memory.
  *	If found it returns true and sets the value of `flags`. Otherwise,
  *	it returns false.
- *	The shared memory follows a ctrie data structure. Although it doesn't implement
- *	tomb nodes due to lack of need to remove nodes.
+ *	The shared memory follows a ctrie data structure.
  *
  *	Arguments:
  *
@@ -335,976 +864,5683 @@ bool __dtsharedmemory_search(const char *path, uint8_t *flags);
 
 
 
+#if VALUE_SIZE
 /**
  *
- *  This function is preferred instead of atomic fetch and add because it
- *  lets us make the check if memory limit has reached or if LARGE_MEMORY_NEEDED
- *  is set to 0, it let's us check if limit for that is reached.
+ *	Same as __dtsharedmemory_insert() but `path` is given the VALUE_SIZE bytes at `value`
+ *	as its value too.
  *
- *	Arguments:
+ **/
+bool __dtsharedmemory_insert_value(const char *path, uint8_t flags, const void *value);
+
+
+
+/**
  *
- *	#Arg1(bytesToBeReserverd):
- *		As the name and function description above describes, this function
- *		shifts the `writeFromOffset` in status file with an offset `bytesToBeReserverd`.
+ *	Same as __dtsharedmemory_search() but the value of `path` is copied to `value` too.
  *
- *	#Arg2(reservedOffset):
- *		This argument is to be passed by reference by the caller function.
- *		After shifting `writeFromOffset` to a new value, the old value of
- *		`writeFromOffset` belongs to the caller function. The caller function can
- *		write from the reserved offset upto `bytesToBeReserverd`.
+ **/
+bool __dtsharedmemory_search_value(const char *path, uint8_t *flags, void *value);
+#endif
+
+
+
+/**
  *
+ *	Does the insertion for __dtsharedmemory_insert() and __dtsharedmemory_insert_value().
+ *	A NULL `value` keeps the value `path` already has, or leaves 0s for a new one.
  *
- * #### Working of the function ####
+ **/
+bool insertPath(const char *path, uint8_t flags, const void *value);
+
+
+
+/**
  *
- *		This function atomically CASs the value of `writeFromOffset` in status file to
- *		a new value which is given as (`writeFromOffset` + `bytesToBeReserverd`).
- *		Block within range from `reservedOffset` upto `bytesToBeReserved`, after this function
- *		returns, is not a critical section for the caller function and it can write to it
- *		without worrying about thread safety.
+ *	Does the search for __dtsharedmemory_search() and __dtsharedmemory_search_value(),
+ *	which only time it when LATENCY_SAMPLING is not 0. `value` may be NULL, otherwise
+ *	the value is read from the same CNode as `flags`.
  *
  **/
-bool reserveSpaceInSharedMemory(size_t bytesToBeReserverd, size_t *reservedOffset);
+bool searchPath(const char *path, uint8_t *flags, void *value);
 
 
 
 /**
  *
- *	This function is completely abstracted from main functionality and is
- *	called _only_ through GOTO_OFFSET() macro.
+ *	Makes a single attempt of inserting `path` for __dtsharedmemory_insert().
  *
  *	Arguments:
  *
- *	#Arg1(offset):
- *		The offset that triggered need for expansion.
+ *	#Arg1(path):
+ *		Path to be inserted into shared memory.
  *
- * #### Working of the function ####
+ *	#Arg2(pathLength):
+ *		Number of characters of `path` to be inserted.
  *
- *		This function updates the Global(manager) to contain updated
- *		mapping to shared memory file and the updated mapping is of new size
- *		`manager->sharedMemoryFile_mapping_size + EXPANDING_SIZE`.
+ *	#Arg3(flags):
+ *		Tell the characteristics of the path getting inserted.
+ *
+ *	#Arg4(value):
+ *		Value to be given to the path, or NULL to keep the one it has.
+ *
+ *	#Arg5(compactions):
+ *		`compactions` returned by waitForCompaction() before the attempt. Nothing is linked
+ *		once it has changed, as the tail and the copies may have been taken from the region
+ *		retired by the compaction. The attempt then returns false without setting `isRetryNeeded`.
+ *
+ *	#Arg6(isRetryNeeded):
+ *		This argument is to be passed by reference and it is set true if
+ *		the attempt reached a removed INode. In that case the removed INode has been
+ *		taken out of its parent and the insertion needs to start again from the root.
+ *		With SHARED_MEMORY_CAP, it is also set once a piece of a long suffix has been
+ *		linked, and the next attempt links the next one (see TAIL_PIECE_NODES).
  *
  **/
-bool expandSharedMemory(size_t offset);
+bool tryInsertion(const char *path, size_t pathLength, uint8_t flags, const void *value, size_t compactions, bool *isRetryNeeded);
 
 
 
 /**
  *
- *	Returns file size of file given by`name`
+ *	This function removes a string `path` from the shared memory.
+ *	It returns true if `path` existed and got removed, else false.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(path):
+ *		Path to be removed from shared memory.
  *
  **/
-static inline size_t getFileSizeForFile(const char *name)
-{
-	struct stat fileStats;
-	int result;
-	fileStats.st_size = -1;
-	result = stat(name, &fileStats);
-	
-	//(size_t)-1 will result in greatest size_t value
-	//and even if such a case is encountered in actual without error
-	//it anyways will reject any insertions afterwards, so its safe to use
-	//largest size_t value as error indicator
-	FAIL_IF(result == -1, "stat(2) failed", (size_t)-1);
-	
-	return fileStats.st_size;
-}
+bool __dtsharedmemory_remove(const char *path);
+
 
 
 /**
+ *
+ *	This function removes `prefix` along with all the paths inside it.
+ *	It returns true if anything got removed, else false.
  *
  *	Arguments:
  *
- *	#Arg1(copy):
- *		This should be an offset in the shared memory, which was obtained by
- *		reserving sizeof(CNode) bytes by reserveSpaceInSharedMemory().
+ *	#Arg1(prefix):
+ *		Prefix to be removed from shared memory. Ending '/' is ignored.
  *
- *	#Arg2(cNodeToBeCopied):
- *		This is the CNode which needs to be copied. It is passed as a (CNode)
- *		and not as (CNode *) because the data this function needs is static and not dynamic.
+ **/
+bool __dtsharedmemory_remove_prefix(const char *prefix);
+
+
+
+/**
  *
- *	#Arg3(index):
- *		This is the new entry to the array which needs to be made in the copy.
- *		This also reserves space for a new child and assigns it to
- *		`copy->possibilities[index]`.
- *		If the value of `index` is negative, "no" updation is made to
- *		`copy->possibilities[index]`.
+ *	This function makes the calling thread use the namespace `name`.
+ *	It returns false if `name` is not acceptable, else true.
  *
- *	#Arg4(updated_isEndOfString) and #Arg5(updated_flags):
- *		Function updates `copy->isEndOfString` to `updated_isEndOfString`
- *		and `copy->flags` to `updated_flags`.
+ *	Arguments:
+ *
+ *	#Arg1(name):
+ *		Name of the namespace, NULL or "" for the default one.
+ *
+ **/
+bool __dtsharedmemory_set_namespace(const char *name);
+
+
+
+/**
  *
+ *	This function removes all the paths of the current namespace and increments
+ *	`generation` in the status header. It returns true if anything got removed, else false.
  *
  * #### Working of the function ####
  *
- *		This function creates a copy of `cNodeToBeCopied` in `copy`.
- *		If it is given a valid `index` as arg, it reservers memory for a new child
- *		and places it into `copy->possibilities[index]`.
- *		It also updates the `copy->isEndOfString` to `updated_isEndOfString`
- *		and `copy->updated_flags` to `updated_flags`.
+ *	Every path of a namespace starts with its name, and every path of the default
+ *	namespace starts with '/', so the whole namespace is a single prefix. It is removed
+ *	by removePath() like __dtsharedmemory_remove_prefix() does, with a single CAS on
+ *	the INode where the namespace starts. For the default namespace that is the root itself,
+ *	whose entry for '/' is cleared. From then on nobody can reach the old paths, and the
+ *	detached INode is only put in `detachedSubtrees` of the status header. Later insertions
+ *	and compactions reclaim the old paths a few at a time by reclaimDetachedSubtrees(),
+ *	so the reset takes the same time whatever the size of the namespace.
  *
  **/
-bool createUpdatedCNodeCopy(CNode *copy, CNode cNodeToBeCopied, int index, bool updated_isEndOfString, uint8_t updated_flags);
+bool __dtsharedmemory_reset();
 
 
 
-#if !(DISABLE_DUMPING_AND_RECYCLING)
 /**
  *
- * #### Need of this function ####
- *
- *		To update a CNode to contain a new entry in bitmap,
- *		a new copy of the same CNode is created with updated bitmap entry
- *		and placed at a newly reserved offset. This new offset is assigned to
- *		the parent INode by CAS because of which the memory at which old CNode
- *		resides gets wasted. That old offset is dumped into `wastedMemoryDumpYard[]` so that
- *		when writing a new CNode, the wasted offsets can
- *		be reused to write CNode instead of using more memory.
- *
- *	Arguments:
+ *	Returns `generation` from the status header.
  *
- *	#Arg1(wastedOffset):
- *		This is the offset which was replaced with a new value. So dumping it in
- *		`wastedMemoryDumpYard[]`.
+ **/
+size_t __dtsharedmemory_get_generation();
+
+
+
+/**
  *
- *	#Arg2(parentINode):
- *		This is the offset to the parent INode of the abandoned CNode offset.
- *		This offset is recorded in order to prevent "common parent problem".
+ *	This function copies the ctrie into a new region by compactCtrie(), or once
+ *	nothing reads the region of the last copy anymore, hands it out by reuseRetiredRegion().
+ *	Only one thread does either at a time, holding `compactingProcess` in the status header.
  *
- * #### Common parent race condition problem ####
+ **/
+bool __dtsharedmemory_compact();
+
+
+
+/**
  *
- *	This is a sick race condition among sibling nodes.
- *	See `__dtsharedmemory_insert()` to get an idea of the situation.
- *	Assume 3 threads, each dealing with a different `INode` with same parent `CNode`.
- *	(1st thread)1st one prepared its old offset to child `CNode`,
- *	and is now preparing new offset to get ready for `CAS`.
- *	Meanwhile (2nd thread)2nd `INode` `CAS`'d the old offset to point to a new
- *	child `CNode` and it dumped the offset to old child `CNode`
- *	so that it can be recycled and the offset to new child `CNode`
- *	contains updated array entries.
- *	Meanwhile the (3rd thread)3rd node recycled the offset dumped by the 2nd `INode`
- *	and `CAS`'d it to be child of current parent.
- *	Array entries has got updations from 2nd and 3rd child `INode`.
- *	Now when 1st node will attempt to `CAS`, it will find the
- *	oldValue and the actual value to be equal, because 3rd node reused old offset,
- *	but the new value 1st node replaces don't
- *	contain array entries set by 2nd and 3rd node leading to data loss.
- *	For this reason an `INode` can _not_ use a recycled offsets dumped by its
- *	sibling to make upgradations.
+ *	This function fills `stats` with the counters kept in the status header.
+ *	It returns false, leaving all of them 0, if manager is NULL or
+ *	the library was built with DISABLE_STATISTICS.
  *
- *	""For this reason a node can not recycle offsets dumped by its sibling.""
+ *	Arguments:
  *
+ *	#Arg1(stats):
+ *		Where the counters are written.
  *
  * #### Working of the function ####
  *
- *		The function reserves an index in `bitmapForDumping` by CAS in order to indicate,
- *		it is using the index.
- *		It then sets the wasted memory offset at the index in `wastedMemoryDumpYard[]`.
- *		It also sets the parent at the index in `parentINodesOfDumper[]`.
- *		It the sets the `bitmapForRecycling` to indicate this node is ready to be
- *		recycled.
+ *	Every counter is summed up over all the shards. Other threads keep counting
+ *	meanwhile, so hits are read before searches to never report more hits than searches.
  *
  **/
-bool dumpWastedMemory(size_t wastedOffset, size_t parentINode);
+bool __dtsharedmemory_get_stats(struct SharedMemoryStats *stats);
 
 
 
 /**
  *
- *	Prefer reading this after understanding dumpWastedMemory().
+ *	Returns the latency in nanoseconds below which `percentile` percent of the sampled
+ *	calls of `operation` completed, 0 if nothing has been sampled.
  *
  *	Arguments:
  *
- *	#Arg1(reusableOffset):
- *		This value needs to be passed by reference and it gets assigned
- *		a reusable offset if available in `wastedMemoryDumpYard[]`.
- *
- *	#Arg2(parentINode):
- *		This is the offset to the parent INode of the CNode asking for a reusable
- *		offset. wasted offset can't be recycled if the parent is same/
- *		Check the "common parent race condition problem in comments of dumpWastedMemory()".
+ *	#Arg1(operation):
+ *		LATENCY_OF_SEARCH or LATENCY_OF_INSERT.
  *
+ *	#Arg2(percentile):
+ *		Between 0 and 100.
  *
- * #### Working of the function ####
+ **/
+size_t __dtsharedmemory_get_latency_percentile(int operation, double percentile);
+
+
+
+/**
  *
- *		The function checks `bitmapForRecycling` bitmap for any set entries.
- *		If any entry is set, it unsets that entry in the `bitmapForRecycling` and CASs the bitmap
- *		to get it updated. It retrieves that value from `wastedMemoryDumpYard[]`,
- *		and then sets the `bitmapForDumping` for that index as true so that
- *		that index becomes free for new wasted offsets to get dumped.
+ *	See `struct SharedMemoryError` in dtsharedmemory.h.
  *
  **/
-bool recycleWastedMemory(size_t *reusableOffset, size_t parentINode);
-#endif
+int __dtsharedmemory_get_last_error();
+size_t __dtsharedmemory_get_errors(struct SharedMemoryError *errors, size_t count);
+void __dtsharedmemory_clear_errors();
+const char *__dtsharedmemory_get_error_name(int error);
+void __dtsharedmemory_set_error_sink(void (*sink)(const struct SharedMemoryError *error));
+void __dtsharedmemory_set_debug_messages(bool areAllowed);
 
-//}
-//Prototypes #END#
 
 
-bool __dtsharedmemory_set_manager(const char *status_file_name, const char *shared_memory_file_name)
+#if LATENCY_SAMPLING
+/**
+ *
+ *	Returns the bucket of the latency histogram for `nanoseconds`.
+ *	Below 8 ns, every nanosecond has its own bucket. Above it, the leading bit
+ *	chooses a group of 8 buckets and the 3 bits after it the bucket in the group.
+ *
+ **/
+static inline size_t latencyToBucket(size_t nanoseconds)
 {
 	
-	//Global(manager) is already set
-	if(manager != NULL)
-		return true;
+	size_t bucket;
+	int leadingBit;
 	
+	if (nanoseconds < 8)
+		return nanoseconds;
 	
-	struct SharedMemoryManager *new_manager = (struct SharedMemoryManager *)malloc(sizeof(struct SharedMemoryManager));
+	leadingBit = NO_OF_BITS - 1 - __builtin_clzl(nanoseconds);
 	
-	FAIL_IF(new_manager == NULL, "malloc(2) failed", false);
+	bucket = (leadingBit - 2) * 8 + ((nanoseconds >> (leadingBit - 3)) & 7);
 	
-	bool result;
+	return (bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1);
+}
+
+
+
+/**
+ *
+ *	Returns the highest latency in nanoseconds that falls in `bucket`,
+ *	the opposite of latencyToBucket().
+ *
+ **/
+static inline size_t bucketToLatency(size_t bucket)
+{
 	
-	result = openStatusFile(new_manager, status_file_name);
+	size_t leadingBit;
 	
-	if (!result)
-	{
-		free(new_manager);
-		print_error("openStatusFile() failed");
-		return false;
-	}
+	if (bucket < 8)
+		return bucket;
 	
-	result = openSharedMemoryFile(new_manager, shared_memory_file_name);
+	leadingBit = bucket / 8 + 2;
 	
-	if (!result)
+	return ((8 + bucket % 8 + 1) << (leadingBit - 3)) - 1;
+}
+
+
+
+/**
+ *
+ *	Returns true once in every LATENCY_SAMPLING calls of `operation` made by a thread,
+ *	in which case the current time is written to `start` for recordLatency().
+ *
+ **/
+static inline bool startLatencySample(int operation, struct timespec *start)
+{
+	
+	if (callsBeforeLatencySample[operation] != 0)
 	{
-		free(new_manager);
-		print_error("openSharedMemoryFile() failed");
+		--callsBeforeLatencySample[operation];
 		return false;
 	}
 	
-	struct SharedMemoryManager *old_manager;
-	
-	do
-	{
-		old_manager = manager;
-
-		if(old_manager != NULL)
-		//Global(manager) was set by some other thread
-		{
-			munmap(new_manager->sharedMemoryFile_mmap_base, new_manager->sharedMemoryFile_mapping_size);
-			munmap(new_manager->statusFile_mmap_base, sizeof(struct SharedMemoryStatus));
-			free(new_manager);
-			
-			return true;
-		}
-		
-	} while ( !CAS_ptr( &old_manager, new_manager, &(manager) ) );
-	
-	return true;
+	callsBeforeLatencySample[operation] = LATENCY_SAMPLING - 1;
 	
+#	ifdef CLOCK_MONOTONIC_RAW
+	return clock_gettime(CLOCK_MONOTONIC_RAW, start) == 0;
+#	else
+	return clock_gettime(CLOCK_MONOTONIC, start) == 0;
+#	endif
 }
 
 
 
-bool openStatusFile(struct SharedMemoryManager *new_manager, const char *status_file_name)
+/**
+ *
+ *	Counts the time passed since `start` in the latency histogram of `operation`.
+ *
+ **/
+static inline void recordLatency(int operation, const struct timespec *start)
 {
 	
-	FAIL_IF(new_manager == NULL, "Arg(new_manager) is NULL", false);
-	FAIL_IF(status_file_name == NULL || *status_file_name == '\0', "Invalid name for status file", false);
-	
-	int result;
-	bool is_truncate_needed;
-	size_t stat_check;
+	struct timespec end;
+	size_t nanoseconds;
 	
-	struct{
-		
-		const char *name;
-		int fd;
-		size_t size;
-		
-	}statusFile;
+	if (manager == NULL)
+		return;
 	
-	statusFile.name	= new_manager->statusFile_name = status_file_name;
-	statusFile.size = sizeof(struct SharedMemoryStatus);
-	statusFile.fd   = open(statusFile.name, O_RDWR, FILE_PERMISSIONS);
+#	ifdef CLOCK_MONOTONIC_RAW
+	clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+#	else
+	clock_gettime(CLOCK_MONOTONIC, &end);
+#	endif
 	
+	nanoseconds = (end.tv_sec - start->tv_sec) * (size_t)1000000000 + end.tv_nsec - start->tv_nsec;
 	
-	if(statusFile.fd >= 0)
-	{
-		//Most frequent case, so kept on top
-		//Yea, it does nothing
+	ADD_size_t(1, &(manager->status->latencies[operation][latencyToBucket(nanoseconds)]));
+}
+#endif
+
+
+
+/**
+ *
+ *	Records a failure in `errorRing` of the calling thread and passes it to `errorSink`, if any.
+ *	Called by FAIL_IF, so it must stay free of allocation and I/O.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(error):
+ *		ERROR_INVALID_ARGUMENT ... ERROR_INTERNAL.
+ *
+ *	#Arg2(function):
+ *		Name of the function which failed.
+ *
+ *	#Arg3(message):
+ *		String literal describing the failure.
+ *
+ **/
+static inline void recordError(int error, const char *function, const char *message)
+{
+	
+	struct SharedMemoryError *record = &errorRing[errorsRecorded++ % ERROR_RING_SIZE];
+	void (*sink)(const struct SharedMemoryError *) = errorSink;
+	
+	record->error      = error;
+	record->savedErrno = errno;
+	record->function   = function;
+	record->message    = message;
+	
+	if (sink != NULL)
+		sink(record);
+}
+
+
+
+/**
+ *
+ *	Attaches to the shared memory file given to __dtsharedmemory_set_manager_lazily(),
+ *	if it hasn't been tried yet. Returns true if Global(manager) is set now.
+ *	Only the first failure costs system calls, later calls just return false.
+ *	Attaching isn't async-signal-safe (it reads the environment, may report errors to the
+ *	error sink and waits for another thread attaching), so it shouldn't happen in a signal handler.
+ *	Only used through MANAGER_OR_ATTACH.
+ *
+ **/
+static inline bool attachDeferred(void)
+{
+	
+	size_t state = DEFERRED_PENDING;
+	
+	if (deferredAttach != DEFERRED_PENDING || isAttaching)
+		return manager != NULL;
+	
+	isAttaching = true;
+	
+	if (__dtsharedmemory_set_manager(deferredFileName))
+	{
+		isAttaching = false;
+		return true;
+	}
+	
+	CAS_size_t(&state, DEFERRED_FAILED, &deferredAttach);
+	
+	isAttaching = false;
+	
+	return false;
+}
+
+//True if Global(manager) is set, attaching first if it was deferred
+#define MANAGER_OR_ATTACH() (manager != NULL || attachDeferred())
+
+
+
+/**
+ *
+ *	Adds 1 to the counter `stat` in the status header, see STATS_SHARDS.
+ *	It always returns true, so that it can also be put in the condition of a loop
+ *	to count its retries. Manager should not be NULL.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(stat):
+ *		Counter to be incremented, one of STAT_SEARCHES ... STAT_EXPANSIONS.
+ *
+ **/
+static inline bool countStat(int stat)
+{
+	
+#if !(DISABLE_STATISTICS)
+	
+	if (statsShard == 0)
+	{
+		statsShard = ((size_t)getpid() + ADD_size_t(1, &threadsCounting)) % STATS_SHARDS + 1;
+	}
+	
+	ADD_size_t(1, &(manager->status->stats[statsShard - 1][stat]));
+	
+#endif
+	
+	return true;
+}
+
+
+
+/**
+ *
+ *	Counts a retry of the insertion of `path` and fires insert__retry probe.
+ *	Always returns true, like countStat().
+ *
+ **/
+static inline bool countInsertRetry(const char *path)
+{
+	
+	PROBE1(insert__retry, path);
+	
+	return countStat(STAT_INSERT_RETRIES);
+}
+
+
+
+/**
+ *
+ *	If a namespace is set, `*path` is prepended with NAMESPACE_SEPARATOR and the namespace
+ *	and made to point to `namespacedPath` and `*pathLength` is updated. Otherwise nothing is changed.
+ *	It returns false if the result doesn't fit in `namespacedPath` or the path doesn't start with '/',
+ *	without which the name and the path could be told apart in more than one way.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(path):
+ *		Path given by the user, passed by address.
+ *
+ *	#Arg2(pathLength):
+ *		Number of characters of `*path` to be considered, passed by address.
+ *
+ **/
+static inline bool keyForPath(const char **path, size_t *pathLength)
+{
+	
+	if (namespaceLength == 0)
+		return true;
+	
+	FAIL_IF(*pathLength == 0 || **path != '/', ERROR_INVALID_ARGUMENT, "Paths of a namespace have to start with '/'", false);
+	FAIL_IF(1 + namespaceLength + *pathLength >= sizeof(namespacedPath), ERROR_INVALID_ARGUMENT, "Path too long for namespace", false);
+	
+	namespacedPath[0] = NAMESPACE_SEPARATOR;
+	memcpy(namespacedPath + 1, namespaceName, namespaceLength);
+	memcpy(namespacedPath + 1 + namespaceLength, *path, *pathLength);
+	namespacedPath[1 + namespaceLength + *pathLength] = '\0';
+	
+	*path        = namespacedPath;
+	*pathLength += 1 + namespaceLength;
+	
+	return true;
+}
+
+
+
+/**
+ *
+ *	Returns true if `character`, above UPPER_LIMIT, is NAMESPACE_SEPARATOR starting
+ *	a key made by keyForPath(). Anywhere else, e.g., in a path given by the user, it is rejected.
+ *
+ **/
+static inline bool isKeySeparator(const char *character)
+{
+	return character == namespacedPath && (uint8_t)*character == NAMESPACE_SEPARATOR;
+}
+
+
+
+/**
+ *
+ *	An INode visited while walking down to the node being removed.
+ *	`index` is the entry in its CNode that leads to the next INode of the walk.
+ *
+ **/
+struct RemovalTrail
+{
+	size_t  iNode;
+	uint8_t index;
+};
+
+
+
+/**
+ *
+ *	Allocates space to remember the walk for removeUsingTrail() and frees it afterwards.
+ *	The removal is made again if the ctrie got compacted meanwhile, see waitForCompaction().
+ *
+ **/
+bool removePath(const char *path, size_t pathLength, bool isPrefix);
+
+
+
+/**
+ *
+ *	Arguments:
+ *
+ *	#Arg1(path):
+ *		Path to be removed from shared memory.
+ *
+ *	#Arg2(pathLength):
+ *		Number of characters of `path` to be considered.
+ *
+ *	#Arg3(isPrefix):
+ *		If true, the entry for '/' in the ending node is removed as well, detaching
+ *		all the paths inside `path`.
+ *
+ *	#Arg4(trail):
+ *		Array with space for at least `pathLength` elements.
+ *
+ *
+ * #### Working of the function ####
+ *
+ *		This function walks down to the ending node of `path` like __dtsharedmemory_search()
+ *		does and remembers every INode it passes in `trail`.
+ *		The ending INode is CAS'd to a copy of its CNode with `isEndOfString` unset.
+ *		If the copy would be empty, i.e., has no entries and doesn't mark end of string,
+ *		the INode is CAS'd to point to the tomb CNode instead (see TOMB_CNODE_OFFSET).
+ *		A tombed INode can't be used anymore, so the entry leading to it is removed from
+ *		its parent by compressTombedChild(). If that leaves the parent empty, the parent gets
+ *		tombed in the same CAS and the same is done for its own parent using `trail`.
+ *		The root INode is never tombed.
+ *		Any other thread that comes across a tombed INode while inserting, removes it
+ *		from the parent itself and starts again, so a path is never inserted under
+ *		a tombed INode.
+ *		In the end, the INode detached by removing '/' entry is queued by queueDetachedSubtree()
+ *		to be reclaimed later. Only if all the slots are taken, it is tombed by tombSubtree() right away.
+ *
+ **/
+bool removeUsingTrail(const char *path, size_t pathLength, bool isPrefix, struct RemovalTrail *trail);
+
+
+
+/**
+ *
+ *	Removes every path of the default namespace, the ones whose keys don't start with
+ *	NAMESPACE_SEPARATOR. The CNode of the root is CAS'd to one with only the entry for
+ *	NAMESPACE_SEPARATOR, and the INodes detached are queued by queueDetachedSubtree()
+ *	like in removeUsingTrail(). Returns false if there was nothing to remove.
+ *	The removal is made again if the ctrie got compacted meanwhile, like in removePath().
+ *
+ **/
+bool removeDefaultNamespace();
+
+
+
+/**
+ *
+ *	Makes a single attempt of removeDefaultNamespace() on the root, see removeUsingTrail().
+ *
+ **/
+bool removeFromRoot();
+
+
+
+/**
+ *
+ *	Removes the entry at `index`, which points to the tombed INode `tombedINode`,
+ *	from the CNode of the INode `parentINode`. If the entry has already been removed
+ *	or the parent itself has been tombed, nothing is done.
+ *	If removing the entry leaves the parent empty, the parent is tombed instead
+ *	and `isParentTombed` is set true, otherwise it is set false.
+ *
+ **/
+bool compressTombedChild(size_t parentINode, uint8_t index, size_t tombedINode, bool *isParentTombed);
+
+
+
+/**
+ *
+ *	Removes the tombed INode `tombedINode`, reached through the first `depth` INodes
+ *	of `trail`, from its parent by compressTombedChild() and goes up the trail
+ *	as long as parents get tombed.
+ *
+ **/
+bool removeTombedINode(const struct RemovalTrail *trail, size_t depth, size_t tombedINode);
+
+
+
+/**
+ *
+ *	Tombs the INode at `offsetToINode` and every INode below it and frees their CNodes.
+ *	Only to be called for INodes that have already been detached from the ctrie
+ *	or which are removed from their parent afterwards by removeTombedINode().
+ *	Each INode is tombed before going below it, so nothing can be inserted there meanwhile.
+ *	Returns the number of INodes tombed.
+ *
+ **/
+size_t tombSubtree(size_t offsetToINode);
+
+
+
+/**
+ *
+ *	Puts the detached INode at `offsetToINode` in `detachedSubtrees` of the status header,
+ *	where reclaimDetachedSubtrees() finds it. Returns false if all the slots are taken.
+ *
+ **/
+bool queueDetachedSubtree(size_t offsetToINode);
+
+
+
+/**
+ *
+ *	Takes any INode out of `detachedSubtrees` into `offsetToINode`.
+ *	Returns false if there is none.
+ *
+ **/
+bool takeDetachedSubtree(size_t *offsetToINode);
+
+
+
+/**
+ *
+ *	Tombs INodes of the detached subtrees until `budget` of them are tombed or none is left,
+ *	and returns the number of INodes tombed.
+ *
+ * #### Working of the function ####
+ *
+ *		An INode is taken out of `detachedSubtrees` and tombed by tombDetachedINode().
+ *		Its children are put in its place, so the subtree is tombed from the top down,
+ *		like tombSubtree() does, but a few INodes at a time by any number of threads.
+ *		Subtrees detached before __dtsharedmemory_compact() retired their region are dropped,
+ *		as the whole region is handed out again.
+ *
+ **/
+size_t reclaimDetachedSubtrees(size_t budget);
+
+
+
+/**
+ *
+ *	Tombs the detached INode at `offsetToINode` and frees its CNode, after queueing
+ *	its children by queueDetachedSubtree(). Children that don't fit are tombed right away
+ *	by tombSubtree(). Returns the number of INodes tombed.
+ *
+ **/
+size_t tombDetachedINode(size_t offsetToINode);
+
+
+
+#if SHARED_MEMORY_CAP
+/**
+ *
+ *	State of a sweep made by evictColdPaths().
+ *
+ *	#Member1(path):
+ *		Path of the node being swept, only the first `depth` characters are valid.
+ *
+ *	#Member2(hand):
+ *		Copy of `clockHand` from the status header, the path at which the last sweep stopped.
+ *
+ *	#Member3(isHandPassed):
+ *		Set true once the sweep reaches the paths that come after `hand`.
+ *
+ *	#Member4(trail):
+ *		INodes from the root to the node being swept, like in removeUsingTrail().
+ *
+ *	#Member5(nodesEvicted):
+ *		Number of nodes evicted so far.
+ *
+ *	#Member6(nodesSpared):
+ *		Number of nodes given a second chance so far, which the next sweep may evict.
+ *
+ **/
+struct EvictionSweep
+{
+	char   path [CLOCK_HAND_SIZE];
+	char   hand [CLOCK_HAND_SIZE];
+	bool   isHandPassed;
+	
+	struct RemovalTrail trail [CLOCK_HAND_SIZE];
+	
+	size_t nodesEvicted;
+	size_t nodesSpared;
+};
+
+
+
+/**
+ *
+ *	Evicts subtrees that haven't been used for a while, until EVICTION_BATCH_SIZE
+ *	nodes are evicted, so that their CNodes can be reused. Called when SHARED_MEMORY_CAP is reached.
+ *	Returns true if trying again may find freed CNodes: either some other thread was
+ *	already evicting and it waited for that one to finish (see EVICTION_WAIT_LIMIT), or
+ *	the sweep evicted something, gave some node a second chance which the next sweep may
+ *	take away, or didn't start from the beginning. So it only returns false once a whole
+ *	sweep has found nothing to evict, or if it failed.
+ *
+ * #### Working of the function ####
+ *
+ *		This is the CLOCK (second chance) algorithm with the nodes of the ctrie in
+ *		lexicographic order of their paths as the clock.
+ *		__dtsharedmemory_search() sets REFERENCED_MAIN_NODE in the INode of every node it passes and
+ *		__dtsharedmemory_insert() does the same for the nodes it passes and writes.
+ *		The sweep starts after `clockHand` in the status header and goes down the ctrie.
+ *		If a node it comes across has the bit set, it is cleared, giving the node
+ *		another round, and the sweep goes on below it. Otherwise nothing below the node has
+ *		been searched for since the last round either, so the node is removed along with
+ *		its whole subtree by tombSubtree() and removeTombedINode(), without sweeping below it.
+ *		When the sweep reaches the end, it stops and the next call starts from the beginning.
+ *		It never wraps around within a call, otherwise a node whose bit was just
+ *		cleared would be evicted before anyone had a chance to search for it, and for the
+ *		nodes near the root that is the whole ctrie.
+ *		Only one thread sweeps at a time, `evictingProcess` in the status header holds its pid.
+ *		The root is never evicted and nodes with CLOCK_HAND_SIZE or more characters in
+ *		their path are only evicted along with an ancestor.
+ *
+ **/
+bool evictColdPaths();
+
+
+
+/**
+ *
+ *	Sweeps the INode at `offsetToINode`, whose path is the first `depth` characters of
+ *	`sweep->path`, and everything below it, for evictColdPaths().
+ *	Returns false when the sweep has to stop, either because EVICTION_BATCH_SIZE nodes
+ *	have been evicted, in which case `clockHand` is set to the last subtree, or on failure.
+ *
+ **/
+bool sweepForEviction(size_t offsetToINode, size_t depth, struct EvictionSweep *sweep);
+#endif
+
+
+
+#if COMPACTION_AVAILABLE
+/**
+ *
+ *	Takes `compactingProcess` in the status header for this process and returns true,
+ *	unless some other thread holds it and its process is alive.
+ *	If the process holding it died while copying the ctrie, the copy is given up,
+ *	see __dtsharedmemory_compact().
+ *
+ **/
+bool lockCompaction();
+
+
+
+/**
+ *
+ *	Copies the ctrie for __dtsharedmemory_compact() with `compactingProcess` held.
+ *
+ * #### Working of the function ####
+ *
+ *		`compactions` is made odd first, after which insertions and removals wait until
+ *		it is even again (see waitForCompaction()). The live INodes are counted and a single
+ *		region is taken for all of them (COMPACTED_NODE_SIZE each), from the hole kept by
+ *		reuseRetiredRegion() if it is big enough. copyCtrie() copies the ctrie into it and
+ *		the CAS of the root INode from the old CNode of the root to the copied one makes
+ *		every later search go through the copy.
+ *		Insertions and removals which had started before `compactions` became odd may still
+ *		change the old ctrie meanwhile. They find `compactions` changed when done and
+ *		make their change again in the copy. If such a change replaced the CNode of the root,
+ *		the CAS fails and the copy is given up.
+ *		Everything used so far other than the copy is retired, see isRetired(),
+ *		until reuseRetiredRegion().
+ *
+ **/
+bool compactCtrie();
+
+
+
+/**
+ *
+ *	Returns the number of INodes reachable from the one at `offsetToINode`, itself included,
+ *	which is `depth` characters deep. It only tells how big the copy will be, so it doesn't
+ *	care about the ctrie changing meanwhile.
+ *
+ **/
+size_t countLiveINodes(size_t offsetToINode, size_t depth);
+
+
+
+/**
+ *
+ *	Copies the ctrie breadth-first into `numberOfNodes` nodes of COMPACTED_NODE_SIZE at `toSpace`.
+ *	The first node is the CNode of the root, its INode is left unused.
+ *	The region itself is the queue: every CNode copied is scanned in turn and its children are copied
+ *	after the last node, so the nodes end up level by level, siblings next to each other.
+ *	Children which are tombed or have nothing left are dropped.
+ *	Returns false if the copy doesn't fit.
+ *
+ *	Arguments:
+ *
+ *	#Arg3(oldRootCNode):
+ *		Offset to the CNode of the root that got copied is stored here, for the CAS of the root INode.
+ *
+ *	#Arg4(nodesCopied):
+ *		Number of nodes used is stored here.
+ *
+ **/
+bool copyCtrie(size_t toSpace, size_t numberOfNodes, size_t *oldRootCNode, size_t *nodesCopied);
+
+
+
+/**
+ *
+ *	Once no operation which started before the last compaction is left (see hasEarlierReaders()),
+ *	reuses the region retired by it, after taking out the freed and dumped CNodes left in it.
+ *	The copy splits it in two parts. The bigger one is kept as the hole for the next
+ *	compaction and the other one is handed out through the stack of freed CNodes.
+ *	With HOT_LEVELS, the hot region is handed out again from its start.
+ *	Returns false if the region may still be read.
+ *
+ **/
+bool reuseRetiredRegion();
+
+
+
+/**
+ *
+ *	Returns true if a live process has an operation counted in `readers` of the status header
+ *	which started in an earlier epoch, i.e., under the other parity of `compactions` / 2.
+ *	After a copy, it may still be reading the region retired by it. Before a copy, it would be
+ *	counted along with the operations of the next epoch, as a failed copy changes epoch too.
+ *	Slots of dead processes are skipped, claimReaderSlot() takes them over.
+ *	A process which dies while using the shared last slot holds the region for good.
+ *
+ **/
+bool hasEarlierReaders();
+#endif
+
+
+
+/**
+ *
+ *	Returns `compactions` from the status header, 0 if the ctrie is never compacted.
+ *
+ **/
+static inline size_t getCompactions(void)
+{
+#if COMPACTION_AVAILABLE
+	return manager->status->compactions;
+#else
+	return 0;
+#endif
+}
+
+
+
+/**
+ *
+ *	Waits while __dtsharedmemory_compact() copies the ctrie, taking over if its process died,
+ *	and returns `compactions` in the status header. Insertions and removals
+ *	are made again if it has changed when they are done, see isCompactedSince().
+ *
+ **/
+static inline size_t waitForCompaction(void)
+{
+	
+	size_t compactions;
+	
+	while ((compactions = getCompactions()) % 2 == 1)
+	{
+#if COMPACTION_AVAILABLE
+		//Gives up the copy of a process that died
+		if (lockCompaction())
+			manager->status->compactingProcess = 0;
+		else
+			usleep(COMPACTION_WAIT_INTERVAL);
+#endif
+	}
+	
+	return compactions;
+}
+
+
+
+/**
+ *
+ *	Returns true if the ctrie got copied by __dtsharedmemory_compact() since `compactions`
+ *	was returned by waitForCompaction(), in which case the copy may not have
+ *	what was changed meanwhile.
+ *
+ **/
+static inline bool isCompactedSince(size_t compactions)
+{
+	return getCompactions() != compactions;
+}
+
+
+
+#if HOT_LEVELS
+/**
+ *
+ *	Returns true if `offset` is in the hot region.
+ *
+ **/
+static inline bool isInHotRegion(size_t offset)
+{
+	return offset >= HOT_REGION_OFFSET && offset < HOT_REGION_OFFSET + HOT_REGION_SIZE;
+}
+#endif
+
+
+
+/**
+ *
+ *	Returns true if `offset` is in the region the ctrie was in before the last compaction.
+ *	Nothing in it may be linked into the copy, so CNodes freed or dumped there are dropped,
+ *	and space taken from it before the copy was switched to is never CAS'd into an INode.
+ *
+ **/
+static inline bool isRetired(size_t offset)
+{
+#if COMPACTION_AVAILABLE
+	
+	size_t compactions, retiredEnd;
+	bool result;
+	
+	//`retiredEnd` is written after the rest, which only change while `compactions` is odd,
+	//so they go with it unless `compactions` changed meanwhile
+	do
+	{
+		compactions = manager->status->compactions;
+		retiredEnd  = manager->status->retiredEnd;
+		
+#	if HOT_LEVELS
+		if (isInHotRegion(offset))
+			result = (retiredEnd != 0);
+		else
+#	endif
+		result = offset < retiredEnd && offset >= manager->status->retiredStart &&
+				 (offset < manager->status->copyStart || offset >= manager->status->copyEnd);
+		
+	} while (compactions != manager->status->compactions);
+	
+	return result;
+	
+#else
+	return false;
+#endif
+}
+
+
+
+/**
+ *
+ *	Adds `delta` to `detachedSubtreeCount` in the status header, (size_t)-1 subtracts one.
+ *
+ **/
+static inline void addToDetachedSubtreeCount(size_t delta)
+{
+	
+	size_t oldValue;
+	
+	do
+	{
+		oldValue = manager->status->detachedSubtreeCount;
+		
+	} while ( !CAS_size_t( &oldValue, oldValue + delta, &(manager->status->detachedSubtreeCount) ) );
+	
+}
+
+
+
+/**
+ *
+ *	Returns true if the space kept in spareTailSpace or spareINodes, starting at `offset`,
+ *	can still be used by this thread, given the `pid` and `compactions` recorded with it.
+ *	Space kept before a compaction may be in the retired region, which is handed out
+ *	again later.
+ *
+ **/
+static inline bool isSpareUsable(pid_t pid, size_t compactions, size_t offset)
+{
+	return pid == getpid() && compactions == getCompactions() && !isRetired(offset);
+}
+
+
+
+#if COMPACTION_AVAILABLE
+/**
+ *
+ *	Run in the child after fork(2), which counts its operations in a slot of its own.
+ *
+ **/
+static void forgetReaderSlot(void)
+{
+	readerSlot = READER_SLOT_NONE;
+}
+
+
+
+/**
+ *
+ *	Claims a slot of `readers` in the status header for this process, one without a pid
+ *	or else one whose process died. Returns the shared last slot if there is none.
+ *
+ **/
+static inline size_t claimReaderSlot(void)
+{
+	
+	size_t slot, oldValue, pid;
+	
+	pid = (size_t)getpid();
+	
+	for (slot = 0 ; slot < READER_SLOTS - 1 ; ++slot)
+	{
+		oldValue = 0;
+		
+		if (CAS_size_t( &oldValue, pid, &(manager->status->readers[slot][READER_PID]) ))
+			return slot;
+	}
+	
+	for (slot = 0 ; slot < READER_SLOTS - 1 ; ++slot)
+	{
+		oldValue = manager->status->readers[slot][READER_PID];
+		
+		if (kill((pid_t)oldValue, 0) == 0 || errno != ESRCH)
+			continue;
+		
+		//The counts of the dead process are dropped, it isn't reading anything
+		if (CAS_size_t( &oldValue, pid, &(manager->status->readers[slot][READER_PID]) ))
+		{
+			manager->status->readers[slot][READER_ACTIVE]     = 0;
+			manager->status->readers[slot][READER_ACTIVE + 1] = 0;
+			
+			return slot;
+		}
+	}
+	
+	return READER_SLOTS - 1;
+	
+}
+
+
+
+/**
+ *
+ *	Returns the slot of `readers` in the status header which counts the operations of this process,
+ *	claiming it the first time. The shared last slot is used while another thread of the
+ *	process is claiming it.
+ *
+ **/
+static inline size_t getReaderSlot(void)
+{
+	
+	size_t state, slot;
+	
+	state = readerSlot;
+	
+	if (state >= READER_SLOT_FIRST)
+		return state - READER_SLOT_FIRST;
+	
+	if (state != READER_SLOT_NONE || !CAS_size_t( &state, READER_SLOT_CLAIMING, &readerSlot ))
+		return READER_SLOTS - 1;
+	
+	if (!isForkHandlerSet)
+		isForkHandlerSet = (pthread_atfork(NULL, NULL, forgetReaderSlot) == 0);
+	
+	slot = claimReaderSlot();
+	
+	readerSlot = READER_SLOT_FIRST + slot;
+	
+	return slot;
+	
+}
+#endif
+
+
+
+/**
+ *
+ *	Counts an operation which is going to read the ctrie in the slot of this process,
+ *	under the parity of `compactions` / 2, so that the region retired by a compaction
+ *	isn't reused while it may still be read, see hasEarlierReaders().
+ *	Returns what stopReading() needs to uncount it, NOT_READING if nothing was counted,
+ *	which is always the case if the file isn't made with `compaction` in the options.
+ *
+ **/
+static inline size_t startReading(void)
+{
+	
+#if COMPACTION_AVAILABLE
+	
+	size_t slot, epoch;
+	
+	//Not made with compaction, nothing is ever retired
+	if (!MANAGER_OR_ATTACH() || options.compaction == 0)
+		return NOT_READING;
+	
+	slot = getReaderSlot();
+	
+	//Counted under the epoch in which the root is read. If it changed before being counted,
+	//the region being read may already be reused after the next compaction.
+	while (true)
+	{
+		epoch = manager->status->compactions / 2;
+		
+		ADD_size_t(1, &(manager->status->readers[slot][READER_ACTIVE + epoch % 2]));
+		
+		if (manager->status->compactions / 2 == epoch)
+			break;
+		
+		ADD_size_t((size_t)-1, &(manager->status->readers[slot][READER_ACTIVE + epoch % 2]));
+	}
+	
+	return slot * 2 + epoch % 2;
+	
+#else
+	
+	return NOT_READING;
+	
+#endif
+	
+}
+
+
+
+/**
+ *
+ *	Uncounts the operation counted by startReading(), which returned `reading`.
+ *
+ **/
+static inline void stopReading(size_t reading)
+{
+#if COMPACTION_AVAILABLE
+	if (reading != NOT_READING)
+		ADD_size_t((size_t)-1, &(manager->status->readers[reading / 2][READER_ACTIVE + reading % 2]));
+#endif
+}
+
+
+
+/**
+ *
+ *  This function is preferred instead of atomic fetch and add because it
+ *  lets us make the check if memory limit has reached or if LARGE_MEMORY_NEEDED
+ *  is set to 0, it let's us check if limit for that is reached.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(bytesToBeReserverd):
+ *		As the name and function description above describes, this function
+ *		shifts the `writeFromOffset` in the status header with an offset `bytesToBeReserverd`.
+ *
+ *	#Arg2(reservedOffset):
+ *		This argument is to be passed by reference by the caller function.
+ *		After shifting `writeFromOffset` to a new value, the old value of
+ *		`writeFromOffset` belongs to the caller function. The caller function can
+ *		write from the reserved offset upto `bytesToBeReserverd`.
+ *
+ *
+ * #### Working of the function ####
+ *
+ *		This function atomically CASs the value of `writeFromOffset` in the status header to
+ *		a new value which is given as (`writeFromOffset` + `bytesToBeReserverd`).
+ *		Block within range from `reservedOffset` upto `bytesToBeReserved`, after this function
+ *		returns, is not a critical section for the caller function and it can write to it
+ *		without worrying about thread safety.
+ *
+ **/
+bool reserveSpaceInSharedMemory(size_t bytesToBeReserverd, size_t *reservedOffset);
+
+
+
+/**
+ *
+ *	This function is completely abstracted from main functionality and is
+ *	called _only_ through GOTO_OFFSET() macro.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(offset):
+ *		The offset that triggered need for expansion.
+ *
+ * #### Working of the function ####
+ *
+ *		If `currentMapping` already covers `offset`, the calling thread just copies it to
+ *		its `mapping`. Otherwise growSharedMemoryFile() makes the file cover `offset` and
+ *		it is mapped again in a new element of `mappings` of the size of the file, which
+ *		becomes `currentMapping` by CAS unless some other thread made a larger one meanwhile.
+ *
+ **/
+bool expandSharedMemory(size_t offset);
+
+
+
+/**
+ *
+ *	Grows shared memory file so that `status->sharedMemoryFileSize` is at least `offset`,
+ *	unless it already is. The file is grown by only one process at a time, the one holding
+ *	`status->growingProcess`, while others wait for it instead of growing it too.
+ *	It is grown by `growthPercent` of its size, at least `expandingSize`, and never beyond
+ *	`maxFileSize`, RESERVED_MAPPING_SIZE or much beyond SHARED_MEMORY_CAP (see `options`).
+ *
+ *	Arguments:
+ *
+ *	#Arg1(offset):
+ *		The offset that triggered need for expansion.
+ *
+ **/
+bool growSharedMemoryFile(size_t offset);
+
+
+
+/**
+ *
+ *	Returns file size of file opened as `fd`
+ *
+ **/
+static inline size_t getFileSizeForFd(int fd)
+{
+	struct stat fileStats;
+	int result;
+	fileStats.st_size = -1;
+	result = fstat(fd, &fileStats);
+	
+	//(size_t)-1 will result in greatest size_t value
+	//and even if such a case is encountered in actual without error
+	//it anyways will reject any insertions afterwards, so its safe to use
+	//largest size_t value as error indicator
+	FAIL_IF(result == -1, ERROR_SYSTEM_CALL, "fstat(2) failed", (size_t)-1);
+	
+	return fileStats.st_size;
+}
+
+
+
+/**
+ *
+ *	Advises a mapping of shared memory file as set by __dtsharedmemory_set_mapping_advice().
+ *	Only pages within the file are faulted in, as touching any beyond it raises SIGBUS.
+ *	Advice is only a hint, so failures are ignored.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(base):
+ *		Address returned by mmap(2), where the header starts.
+ *
+ *	#Arg2(mappedSize):
+ *		Size given to mmap(2).
+ *
+ *	#Arg3(fileSize):
+ *		Size of shared memory file, with the header.
+ *
+ **/
+static inline void adviseMapping(void *base, size_t mappedSize, size_t fileSize)
+{
+	size_t pageSize, hotSize;
+	
+	pageSize = sysconf(_SC_PAGESIZE);
+	
+	hotSize = HEADER_SIZE + prefaultSize;
+	hotSize = hotSize < fileSize   ? hotSize : fileSize;
+	hotSize = hotSize < mappedSize ? hotSize : mappedSize;
+	
+	//The tail has to start at a page
+	hotSize = (hotSize + pageSize - 1) / pageSize * pageSize;
+	
+	if (prefaultSize != 0)
+	{
+#ifdef MADV_POPULATE_READ
+		if (madvise(base, hotSize, MADV_POPULATE_READ) == -1)
+#endif
+			madvise(base, hotSize, MADV_WILLNEED);
+	}
+	
+	if (isTailRandom && mappedSize > hotSize)
+	{
+		madvise(base + hotSize, mappedSize - hotSize, MADV_RANDOM);
+	}
+}
+
+
+
+/**
+ *
+ *	Opens the file `name`, creating it if it doesn't exist.
+ *	Returns its fd or -1.
+ *
+ **/
+static inline int openOrCreateFile(const char *name)
+{
+	int fd;
+	
+	fd = open(name, O_RDWR, FILE_PERMISSIONS);
+	
+	if(fd == -1 && errno == ENOENT)
+	//File doesn't exist
+	{
+		//Create file
+		//Doesn't overwrite existing file because O_EXCL is added in flags.
+		fd = open(name, O_CREAT | O_EXCL | O_TRUNC | O_RDWR, FILE_PERMISSIONS);
+		
+		if(fd == -1 && errno == EEXIST)
+		{
+			//Some other thread or process may have entered the code and created the file
+			//before this thread could. Assuming that, attempt to open the file again.
+			
+			fd = open(name, O_RDWR, FILE_PERMISSIONS);
+		}
+	}
+	
+	FAIL_IF(fd == -1, ERROR_SYSTEM_CALL, "open(2) failed", -1);
+	
+	return fd;
+}
+
+
+
+/**
+ *
+ *	Reads the decimal number at `*string` into `number` and moves `*string` past it.
+ *	Returns false if there are no digits.
+ *
+ **/
+static inline bool parseNumber(const char **string, unsigned long long *number)
+{
+	const char *digit = *string;
+	
+	for (*number = 0 ; *digit >= '0' && *digit <= '9' ; ++digit)
+	{
+		*number = *number * 10 + (*digit - '0');
+	}
+	
+	if (digit == *string)
+		return false;
+	
+	*string = digit;
+	
+	return true;
+}
+
+
+
+/**
+ *
+ *	Returns the fd of shared memory file exported by __dtsharedmemory_export_fd() in
+ *	some ancestor process, or -1 if there is none. The fd may have been closed
+ *	or reused for some other file since then, so it is only taken if fstat(2) shows
+ *	it is still the same file. `fileSize` is then set to the size of the file.
+ *
+ **/
+static inline int getInheritedFd(size_t *fileSize)
+{
+	const char *exported;
+	unsigned long long fd, device, inode;
+	struct stat fileStats;
+	
+	exported = getenv(INHERITED_FD_VARIABLE);
+	
+	//"fd:device:inode", as written by __dtsharedmemory_export_fd()
+	if (exported == NULL ||
+		!parseNumber(&exported, &fd)     || *exported++ != ':' ||
+		!parseNumber(&exported, &device) || *exported++ != ':' ||
+		!parseNumber(&exported, &inode)  || *exported   != '\0')
+	{
+		return -1;
+	}
+	
+	if (fd > INT_MAX || fstat((int)fd, &fileStats) == -1 ||
+		(unsigned long long)fileStats.st_dev != device ||
+		(unsigned long long)fileStats.st_ino != inode)
+	{
+		return -1;
+	}
+	
+	*fileSize = fileStats.st_size;
+	
+	return (int)fd;
+}
+
+
+/**
+ *
+ *	Arguments:
+ *
+ *	#Arg1(copy):
+ *		This should be an offset in the shared memory, which was obtained by
+ *		reserving sizeof(CNode) bytes by reserveSpaceInSharedMemory().
+ *
+ *	#Arg2(cNodeToBeCopied):
+ *		This is the CNode which needs to be copied. It is passed as a (CNode)
+ *		and not as (CNode *) because the data this function needs is static and not dynamic.
+ *
+ *	#Arg3(index):
+ *		This is the new entry to the array which needs to be made in the copy.
+ *		This also reserves space for a new child and assigns it to
+ *		`copy->possibilities[index]`.
+ *		If the value of `index` is negative, "no" updation is made to
+ *		`copy->possibilities[index]`.
+ *
+ *	#Arg4(updated_isEndOfString) and #Arg5(updated_flags):
+ *		Function updates `copy->isEndOfString` to `updated_isEndOfString`
+ *		and `copy->flags` to `updated_flags`.
+ *
+ *
+ * #### Working of the function ####
+ *
+ *		This function creates a copy of `cNodeToBeCopied` in `copy`.
+ *		If it is given a valid `index` as arg, it reservers memory for a new child
+ *		and places it into `copy->possibilities[index]`.
+ *		It also updates the `copy->isEndOfString` to `updated_isEndOfString`
+ *		and `copy->updated_flags` to `updated_flags`.
+ *
+ **/
+bool createUpdatedCNodeCopy(CNode *copy, CNode cNodeToBeCopied, int index, bool updated_isEndOfString, uint8_t updated_flags);
+
+
+
+/**
+ *
+ *	Gets space for writing a new CNode, by recycling wasted memory if possible
+ *	and otherwise by reserving it with reserveSpaceInSharedMemory().
+ *
+ *	Arguments:
+ *
+ *	#Arg1(offsetToCNode):
+ *		This argument is to be passed by reference and it gets assigned the
+ *		offset at which the caller can write the new CNode.
+ *
+ *	#Arg2(parentINode):
+ *		Offset to the INode which is going to point to the new CNode.
+ *		See the "common parent race condition problem" in comments of dumpWastedMemory().
+ *
+ **/
+bool getSpaceForCNode(size_t *offsetToCNode, size_t parentINode);
+
+
+
+/**
+ *
+ *	A chain of nodes created by createPrivateTail().
+ *
+ *	#Member1(offset):
+ *		Offset to the space reserved for the tail. The INode of node `i`
+ *		of the tail is at `offset + i * sizeof(INode)`, unless `iNodes` is set.
+ *
+ *	#Member2(numberOfNodes):
+ *		Number of nodes in the tail.
+ *
+ *	#Member3(bytesReserved):
+ *		Bytes that were reserved from `offset` for the tail.
+ *		0 if nothing was reserved, i.e., all the CNodes were reused
+ *		and the INodes were taken by takeSpareINodes() or takeRecycledINodes().
+ *
+ *	#Member4(iNodes):
+ *		Only when SHARED_MEMORY_CAP is not 0.
+ *		Offset to the array holding offsets to the INodes of the tail
+ *		if they were recycled, see takeRecycledINodes(). 0 otherwise.
+ *
+ *	#Member5(hotNodes):
+ *		Only when HOT_LEVELS is not 0.
+ *		Number of nodes at the start of the tail placed in the hot region.
+ *		They aren't counted by the members above, which are about the rest of the tail.
+ *
+ *	#Member6(hotOffset):
+ *		Only when HOT_LEVELS is not 0.
+ *		Offset to the space in the hot region taken for `hotNodes` nodes,
+ *		HOT_TAIL_SIZE(hotNodes) bytes. Their INodes are followed by their CNodes.
+ *
+ **/
+struct PrivateTail
+{
+	size_t offset;
+	size_t numberOfNodes;
+	size_t bytesReserved;
+	
+#if SHARED_MEMORY_CAP
+	size_t iNodes;
+#endif
+	
+#if HOT_LEVELS
+	size_t hotNodes;
+	size_t hotOffset;
+#endif
+};
+
+#define HOT_TAIL_SIZE(nodes) (ALIGNED_SIZE((nodes) * sizeof(INode)) + (nodes) * CNODE_BLOCK_SIZE)
+
+
+
+/**
+ *
+ *	Returns the number of nodes of `tail` which aren't in the hot region.
+ *
+ **/
+static inline size_t coldTailNodes(const struct PrivateTail *tail)
+{
+#if HOT_LEVELS
+	return tail->numberOfNodes - tail->hotNodes;
+#else
+	return tail->numberOfNodes;
+#endif
+}
+
+
+
+/**
+ *
+ *	Returns the offset to the INode of node `tailNode` of `tail`.
+ *
+ **/
+static inline size_t offsetToTailINode(const struct PrivateTail *tail, size_t tailNode)
+{
+#if HOT_LEVELS
+	if (tailNode < tail->hotNodes)
+		return tail->hotOffset + tailNode * sizeof(INode);
+	
+	tailNode -= tail->hotNodes;
+#endif
+	
+#if SHARED_MEMORY_CAP
+	if (tail->iNodes != 0)
+		return *((size_t *)GOTO_OFFSET(tail->iNodes) + tailNode);
+#endif
+	
+	return tail->offset + tailNode * sizeof(INode);
+}
+
+
+
+/**
+ *
+ *	Arguments:
+ *
+ *	#Arg1(suffix):
+ *		Part of the path for which no nodes exist in the ctrie yet.
+ *
+ *	#Arg2(suffixLength):
+ *		Number of characters of `suffix` to be considered.
+ *
+ *	#Arg3(depth):
+ *		Number of characters of the path before `suffix`.
+ *
+ *	#Arg4(isEndOfString):
+ *		False if `suffix` is only a piece of the rest of the path, see TAIL_PIECE_NODES.
+ *		The last node of the tail then has no end of string, `flags` or `value`.
+ *
+ *	#Arg5(flags):
+ *		Flags to be set in the ending node of the tail.
+ *
+ *	#Arg6(value):
+ *		Value to be set in the ending node of the tail, or NULL to leave 0s.
+ *
+ *	#Arg7(tail):
+ *		This argument is to be passed by reference and it gets filled
+ *		with the details of the new tail.
+ *
+ *
+ * #### Working of the function ####
+ *
+ *		This function writes one node per character of `suffix`.
+ *		The node for character `i` contains the entry for character `i + 1`
+ *		and the last node marks end of string with `flags` and `value`.
+ *		Nodes for the first HOT_LEVELS characters of the path are placed in the hot region
+ *		if it has space left, all of them taken by a single reserveSpaceInHotRegion().
+ *		For the rest, CNodes freed by __dtsharedmemory_remove() are used first (see reuseFreedCNode()).
+ *		Space for all the INodes, followed by the CNodes that couldn't be reused,
+ *		is reserved by a single call to reserveSpaceForTail().
+ *		If every CNode could be reused, the INodes are taken by takeSpareINodes() and
+ *		nothing is reserved. This is what lets insertions go on without growing the
+ *		shared memory once SHARED_MEMORY_CAP is reached. If the reservation fails,
+ *		evictColdPaths() is given a chance to free some CNodes first.
+ *		As nobody else knows about these nodes, no CAS is needed while
+ *		writing the chain. The caller makes it visible to other threads by linking
+ *		any one of its nodes into the ctrie.
+ *		It fails without reserving anything if `suffix` has a character out of range.
+ *
+ **/
+bool createPrivateTail(const char *suffix, size_t suffixLength, size_t depth, bool isEndOfString, uint8_t flags, const void *value, struct PrivateTail *tail);
+
+
+
+/**
+ *
+ *	This function undoes a reservation made by reserveSpaceInSharedMemory() if
+ *	nothing has been reserved after it. The reserved space is filled with '\0' again
+ *	because space after `writeFromOffset` is assumed to be filled with '\0'.
+ *	Returns true if the space was given back.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(reservedOffset):
+ *		Offset that was obtained from reserveSpaceInSharedMemory().
+ *
+ *	#Arg2(bytesReserved):
+ *		Number of bytes that were passed to reserveSpaceInSharedMemory().
+ *
+ **/
+bool releaseReservedSpace(size_t reservedOffset, size_t bytesReserved);
+
+
+
+/**
+ *
+ *	Same as reserveSpaceInSharedMemory() but the space is taken from
+ *	the spare tail space of this thread if it is big enough.
+ *	Only to be used for tails created by createPrivateTail().
+ *
+ **/
+bool reserveSpaceForTail(size_t bytesToBeReserverd, size_t *reservedOffset);
+
+
+
+/**
+ *
+ *	Keeps the space reserved for a tail which never got linked into the ctrie as
+ *	spare tail space of this thread, after filling it with '\0'.
+ *	If this thread already has a bigger spare, the space is freed instead.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(offsetToTail):
+ *		Offset to the tail.
+ *
+ *	#Arg2(bytesUsed):
+ *		Size of the tail in bytes.
+ *
+ **/
+void keepSpareTailSpace(size_t offsetToTail, size_t bytesUsed);
+
+
+
+/**
+ *
+ *	Gives back everything taken by a tail that never got linked into the ctrie.
+ *	CNodes that were reused are freed again and the reserved space is given back by
+ *	releaseReservedSpace(), or if that's not possible, kept by keepSpareTailSpace().
+ *	INodes taken by takeSpareINodes() are given back by giveBackSpareINodes().
+ *
+ **/
+void discardPrivateTail(const struct PrivateTail *tail);
+
+
+
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+/**
+ *
+ *	Frees the CNodes of first `numberOfNodes` nodes of a tail made by createPrivateTail()
+ *	which never got linked into the ctrie.
+ *
+ **/
+void freeUnusedTailNodes(const struct PrivateTail *tail, size_t numberOfNodes);
+
+
+
+/**
+ *
+ *	Frees `bytes` of unused space from `offset`, by cutting it into
+ *	pieces of CNODE_BLOCK_SIZE and freeing each of them as a CNode.
+ *
+ **/
+void freeUnusedSpace(size_t offset, size_t bytes);
+
+
+
+/**
+ *
+ *	Frees the CNode at `offsetToCNode` which belonged to `iNode`, where `iNode` has
+ *	either been tombed or was never linked into the ctrie.
+ *	Nobody can CAS such an INode, so its CNode can be reused
+ *	by any INode including siblings. The CNode is pushed on `freedCNodes` stack in
+ *	the status header where it can be taken by reuseFreedCNode().
+ *	On machines where the stack isn't available (see FREED_CNODES_STACK_AVAILABLE),
+ *	it is simply dumped by dumpWastedMemory().
+ *
+ **/
+void freeCNode(size_t offsetToCNode, size_t iNode);
+#endif
+
+
+
+#if FREED_CNODES_STACK_AVAILABLE
+/**
+ *
+ *	Takes space for `numberOfINodes` INodes from spareINodes of this thread into
+ *	`offsetToINodes`. If there isn't enough, the rest of spareINodes is left unused and
+ *	a freed CNode is taken for new ones. Returns false if there are more than
+ *	INODES_IN_CNODE INodes or no freed CNode is available.
+ *
+ **/
+bool takeSpareINodes(size_t numberOfINodes, size_t *offsetToINodes);
+
+
+
+/**
+ *
+ *	Gives back the INodes taken by the last call to takeSpareINodes().
+ *
+ **/
+void giveBackSpareINodes(size_t offsetToINodes, size_t numberOfINodes);
+
+
+
+/**
+ *
+ *	Pushes the CNode at `offsetToCNode` on `freedCNodes` stack. The first bytes of the
+ *	CNode store the offset to the next one and the bytes after them store `excludedINode`,
+ *	the INode which isn't allowed to reuse it (0 if any INode can).
+ *
+ **/
+void pushFreedCNode(size_t offsetToCNode, size_t excludedINode);
+
+
+
+/**
+ *
+ *	Pops a CNode from the stack whose top is `top` into `offsetToCNode`, to be used by `iNode`.
+ *	Returns false if there is none or if the one on top can't be used by `iNode`.
+ *	`iNode` is 0 when the CNode is for an INode nobody else knows about yet.
+ *
+ **/
+bool popFreedCNode(FreedCNodesTop *top, size_t *offsetToCNode, size_t iNode);
+
+
+
+/**
+ *
+ *	Pops a CNode freed by freeCNode() into `offsetToCNode`, to be used by `iNode`.
+ *	Same as popFreedCNode() on `freedCNodes` stack.
+ *
+ **/
+bool reuseFreedCNode(size_t *offsetToCNode, size_t iNode);
+#endif
+
+
+
+#if HOT_LEVELS
+/**
+ *
+ *	Same as reserveSpaceInSharedMemory() but the space is taken from the hot region.
+ *	Returns false, without recording an error, once the region is full or while
+ *	it is retired by __dtsharedmemory_compact().
+ *
+ **/
+bool reserveSpaceInHotRegion(size_t bytesToBeReserverd, size_t *reservedOffset);
+#endif
+
+
+
+#if SHARED_MEMORY_CAP
+/**
+ *
+ *	Frees `offsetToINode`, an INode which has been tombed and taken out of the ctrie,
+ *	or was never linked into it, so that it can be reused by takeRecycledINodes().
+ *
+ * #### Working of the function ####
+ *
+ *		Without SHARED_MEMORY_CAP, INodes are never freed, as a thread may still be
+ *		using a removed one, and the memory lost that way is small. But a cache which is
+ *		always evicting would fill up with such INodes. So the INode is added to the
+ *		bundle at `recycledINodes.filling`, a freed CNode used as an array of offsets,
+ *		and once it is full it is pushed on `freedINodes` stack by pushFreedINodes().
+ *		The INode keeps pointing to the tomb CNode until it is reused, so writers
+ *		still never CAS it. A reader that reached it before it was taken out might still
+ *		read it after it has been reused for some other path, that is why readers
+ *		check isStillLinked() when SHARED_MEMORY_CAP is set.
+ *		If no freed CNode is available for a new bundle, the INode is lost as before.
+ *
+ **/
+void freeINode(size_t offsetToINode);
+
+
+
+/**
+ *
+ *	Takes `numberOfINodes` recycled INodes, and puts the offset to the array
+ *	holding their offsets into `offsetToINodes`. If the bundle at `recycledINodes.taking`
+ *	doesn't have enough left, the rest of it is freed again and a bundle is popped from
+ *	`freedINodes` stack. Returns false if there are more than INODES_IN_BUNDLE INodes
+ *	or no bundle is available.
+ *
+ **/
+bool takeRecycledINodes(size_t numberOfINodes, size_t *offsetToINodes);
+
+
+
+/**
+ *
+ *	Gives back the INodes taken by the last call to takeRecycledINodes().
+ *
+ **/
+void giveBackRecycledINodes(size_t offsetToINodes, size_t numberOfINodes);
+
+
+
+/**
+ *
+ *	Pushes the bundle of freed INodes at `offsetToBundle` on `freedINodes` stack.
+ *	Like in pushFreedCNode(), the first bytes store the offset to the next one.
+ *
+ **/
+void pushFreedINodes(size_t offsetToBundle);
+
+
+
+/**
+ *
+ *	Pops a bundle of freed INodes into `offsetToBundle`. Returns false if there is none.
+ *
+ **/
+bool popFreedINodes(size_t *offsetToBundle);
+
+
+
+/**
+ *
+ *	Returns true if `childINode`, which was read from entry `index` of `parentCNode`,
+ *	is still an entry of `parentINode`, i.e., it hasn't been taken out and maybe
+ *	recycled for some other path since (see freeINode()).
+ *	The common case, `parentINode` still pointing to `parentCNode`, costs a single read.
+ *
+ **/
+static inline bool isStillLinked(size_t parentINode, const CNode *parentCNode, int index, size_t childINode)
+{
+	size_t mainNode;
+	const CNode *cNode;
+	
+	mainNode = ((INode *)GOTO_OFFSET(parentINode))->mainNode;
+	cNode    = GOTO_OFFSET(MAIN_NODE(mainNode));
+	
+	if (cNode == parentCNode)
+		return true;
+	
+	//Tomb CNode has no entries
+	return cNode != NULL && cNode->possibilities[index] == childINode;
+}
+#endif
+
+
+
+/**
+ *
+ *	Returns true if inserting `flags` and `value` on the ending node `cNode` wouldn't change
+ *	anything, i.e., it already marks end of string with the same flags and value (unless
+ *	`value` is NULL), and if the path is a prefix, it has no entry for '/'.
+ *
+ **/
+static inline bool isInsertionRedundant(const CNode *cNode, uint8_t flags, const void *value)
+{
+	return cNode->isEndOfString && cNode->flags == flags &&
+#if VALUE_SIZE
+	(value == NULL || memcmp(cNode->value, value, VALUE_SIZE) == 0) &&
+#endif
+	(!(flags & IS_PREFIX) || cNode->possibilities['/' - LOWER_LIMIT] == 0);
+}
+
+
+
+/**
+ *
+ *	Returns true if `cNode` doesn't mark end of string and has no entries,
+ *	i.e., the INode pointing to it holds nothing.
+ *
+ **/
+static inline bool isCNodeEmpty(const CNode *cNode)
+{
+	int index;
+	
+	if (cNode->isEndOfString)
+		return false;
+	
+	for (index = 0 ; index < POSSIBLE_CHARACTERS ; ++index)
+	{
+		if (cNode->possibilities[index] != 0)
+			return false;
+	}
+	
+	return true;
+}
+
+
+
+#if SHARED_MEMORY_CAP
+/**
+ *
+ *	Sets REFERENCED_MAIN_NODE in `mainNode` of `iNode` for evictColdPaths(), if it still
+ *	points to `cNode`, the CNode the caller has just read. It is checked first so that
+ *	the INode of a path searched over and over isn't written every time.
+ *	Memory of an INode is only ever reused for INodes (see freeINode()) and `mainNode`
+ *	is versioned, so the CAS fails if `iNode` has been taken out or changed meanwhile.
+ *	Losing it only makes eviction a little less accurate.
+ *
+ **/
+static inline void markAsReferenced(INode *iNode, const CNode *cNode)
+{
+	size_t mainNode = iNode->mainNode;
+	
+	//A tombed INode is never written, see TOMB_CNODE_OFFSET
+	if (!(mainNode & REFERENCED_MAIN_NODE) && MAIN_NODE(mainNode) != TOMB_CNODE_OFFSET &&
+		GOTO_OFFSET(MAIN_NODE(mainNode)) == cNode)
+		CAS_size_t( &mainNode, mainNode | REFERENCED_MAIN_NODE, &(iNode->mainNode) );
+}
+#endif
+
+
+
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+/**
+ *
+ * #### Need of this function ####
+ *
+ *		To update a CNode to contain a new entry in bitmap,
+ *		a new copy of the same CNode is created with updated bitmap entry
+ *		and placed at a newly reserved offset. This new offset is assigned to
+ *		the parent INode by CAS because of which the memory at which old CNode
+ *		resides gets wasted. That old offset is dumped into `wastedMemoryDumpYard[]` so that
+ *		when writing a new CNode, the wasted offsets can
+ *		be reused to write CNode instead of using more memory.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(wastedOffset):
+ *		This is the offset which was replaced with a new value. So dumping it in
+ *		`wastedMemoryDumpYard[]`.
+ *
+ *	#Arg2(parentINode):
+ *		This is the offset to the parent INode of the abandoned CNode offset.
+ *		This offset is recorded in order to prevent "common parent problem".
+ *
+ * #### Common parent race condition problem ####
+ *
+ *	This is a sick race condition among sibling nodes.
+ *	See `__dtsharedmemory_insert()` to get an idea of the situation.
+ *	Assume 3 threads, each dealing with a different `INode` with same parent `CNode`.
+ *	(1st thread)1st one prepared its old offset to child `CNode`,
+ *	and is now preparing new offset to get ready for `CAS`.
+ *	Meanwhile (2nd thread)2nd `INode` `CAS`'d the old offset to point to a new
+ *	child `CNode` and it dumped the offset to old child `CNode`
+ *	so that it can be recycled and the offset to new child `CNode`
+ *	contains updated array entries.
+ *	Meanwhile the (3rd thread)3rd node recycled the offset dumped by the 2nd `INode`
+ *	and `CAS`'d it to be child of current parent.
+ *	Array entries has got updations from 2nd and 3rd child `INode`.
+ *	Now when 1st node will attempt to `CAS`, it will find the
+ *	oldValue and the actual value to be equal, because 3rd node reused old offset,
+ *	but the new value 1st node replaces don't
+ *	contain array entries set by 2nd and 3rd node leading to data loss.
+ *	For this reason an `INode` can _not_ use a recycled offsets dumped by its
+ *	sibling to make upgradations.
+ *
+ *	""For this reason a node can not recycle offsets dumped by its sibling.""
+ *
+ *
+ * #### Working of the function ####
+ *
+ *		The function reserves an index in `bitmapForDumping` by CAS in order to indicate,
+ *		it is using the index.
+ *		It then sets the wasted memory offset at the index in `wastedMemoryDumpYard[]`.
+ *		It also sets the parent at the index in `parentINodesOfDumper[]`.
+ *		It the sets the `bitmapForRecycling` to indicate this node is ready to be
+ *		recycled.
+ *		When the dump yard is full or the offset has already been recycled once,
+ *		the offset is wasted for good. With SHARED_MEMORY_CAP that would eventually
+ *		leave no memory for anything, so it is pushed on `freedCNodes` stack instead,
+ *		with `parentINode` as the INode which can't reuse it (see pushFreedCNode()).
+ *		It can still come back to the INode that dumped it after being used by another
+ *		INode and dumped again, which the odd offsets otherwise rule out, so `mainNode`
+ *		is versioned to make a stale CAS fail then (see MAIN_NODE()).
+ *		With HOT_LEVELS, offsets in the hot region are made odd as well but pushed on
+ *		`freedHotCNodes` instead of the dump yard, so they are also dropped when dumped again.
+ *
+ **/
+bool dumpWastedMemory(size_t wastedOffset, size_t parentINode);
+
+
+
+/**
+ *
+ *	Prefer reading this after understanding dumpWastedMemory().
+ *
+ *	Arguments:
+ *
+ *	#Arg1(reusableOffset):
+ *		This value needs to be passed by reference and it gets assigned
+ *		a reusable offset if available in `wastedMemoryDumpYard[]`.
+ *
+ *	#Arg2(parentINode):
+ *		This is the offset to the parent INode of the CNode asking for a reusable
+ *		offset. wasted offset can't be recycled if the parent is same/
+ *		Check the "common parent race condition problem in comments of dumpWastedMemory()".
+ *
+ *
+ * #### Working of the function ####
+ *
+ *		The function checks `bitmapForRecycling` bitmap for any set entries.
+ *		If any entry is set, it unsets that entry in the `bitmapForRecycling` and CASs the bitmap
+ *		to get it updated. It retrieves that value from `wastedMemoryDumpYard[]`,
+ *		and then sets the `bitmapForDumping` for that index as true so that
+ *		that index becomes free for new wasted offsets to get dumped.
+ *
+ **/
+bool recycleWastedMemory(size_t *reusableOffset, size_t parentINode);
+#endif
+
+//}
+//Prototypes #END#
+
+
+bool __dtsharedmemory_set_manager(const char *shared_memory_file_name)
+{
+	
+	//Global(manager) is already set
+	if(manager != NULL)
+		return true;
+	
+	
+	struct SharedMemoryManager new_manager;
+	struct SharedMemoryMapping new_mapping;
+	
+	bool result;
+	
+	result = openSharedMemoryFile(&new_manager, shared_memory_file_name, &new_mapping);
+	
+	if (!result)
+	{
+		print_error("openSharedMemoryFile() failed");
+		return false;
+	}
+	
+	size_t isClaimed = false;
+	
+	if (!CAS_size_t(&isClaimed, true, &isManagerClaimed))
+	//Global(manager) is being set by some other thread
+	{
+		munmap(new_mapping.base - HEADER_SIZE, new_mapping.size + HEADER_SIZE);
+		
+		while (manager == NULL)
+			;
+		
+		return true;
+	}
+	
+	managerStorage = new_manager;
+	mappings[0]    = new_mapping;
+	mappingsUsed   = 1;
+	currentMapping = &mappings[0];
+	mapping        = new_mapping;
+	
+	manager = &managerStorage;
+	
+	return true;
+	
+}
+
+
+
+bool __dtsharedmemory_set_manager_ex(const char *shared_memory_file_name, const struct SharedMemoryOptions *newOptions)
+{
+	
+	//Global(manager) is already set, with the options it was set with
+	if(manager != NULL)
+		return true;
+	
+	FAIL_IF(newOptions != NULL && newOptions->dumpYardSize > DUMP_YARD_SIZE, ERROR_INVALID_ARGUMENT, "dumpYardSize is more than DUMP_YARD_SIZE", false);
+	
+	if (newOptions != NULL)
+		options = *newOptions;
+	
+	return __dtsharedmemory_set_manager(shared_memory_file_name);
+	
+}
+
+
+
+void __dtsharedmemory_set_mapping_advice(size_t newPrefaultSize, bool newIsTailRandom)
+{
+	prefaultSize = newPrefaultSize;
+	isTailRandom = newIsTailRandom;
+}
+
+
+
+bool __dtsharedmemory_set_manager_lazily(const char *shared_memory_file_name)
+{
+	
+	FAIL_IF(shared_memory_file_name == NULL || *shared_memory_file_name == '\0', ERROR_INVALID_ARGUMENT, "Invalid name for shared memory file", false);
+	FAIL_IF(strlen(shared_memory_file_name) >= sizeof(deferredFileName), ERROR_INVALID_ARGUMENT, "Name of shared memory file is too long", false);
+	
+	size_t state = DEFERRED_NONE;
+	
+	//Already attached or going to be
+	if (manager != NULL || !CAS_size_t(&state, DEFERRED_SETTING, &deferredAttach))
+		return true;
+	
+	strcpy(deferredFileName, shared_memory_file_name);
+	
+	state = DEFERRED_SETTING;
+	
+	CAS_size_t(&state, DEFERRED_PENDING, &deferredAttach);
+	
+	return true;
+	
+}
+
+
+
+bool openSharedMemoryFile(struct SharedMemoryManager *new_manager, const char *shared_memory_file_name,
+						  struct SharedMemoryMapping *new_mapping)
+{
+	
+	FAIL_IF(new_manager == NULL, ERROR_INVALID_ARGUMENT, "Arg(new_manager) is NULL", false);
+	FAIL_IF(new_mapping == NULL, ERROR_INVALID_ARGUMENT, "Arg(new_mapping) is NULL", false);
+	FAIL_IF(shared_memory_file_name == NULL || *shared_memory_file_name == '\0', ERROR_INVALID_ARGUMENT, "Invalid name for shared memory file", false);
+	
+	bool is_truncate_needed;
+	size_t stat_check, initialFileSize;
+	int result;
+	struct SharedMemoryHeader *header = NULL;
+	
+	struct{
+		
+		const char *name;
+		int fd;
+		size_t size;
+		
+	}sharedMemoryFile;
+	
+	sharedMemoryFile.name = new_manager->sharedMemoryFile_name = shared_memory_file_name;
+	sharedMemoryFile.fd   = getInheritedFd(&stat_check);
+	
+	if(sharedMemoryFile.fd == -1)
+	{
+		sharedMemoryFile.fd = openOrCreateFile(sharedMemoryFile.name);
+		FAIL_IF(sharedMemoryFile.fd == -1, ERROR_CALL_FAILED, "openOrCreateFile() failed", false);
+		
+		stat_check = getFileSizeForFd(sharedMemoryFile.fd);
+	}
+	
+	
+	
+	if (sharedMemoryFile.fd >= 0)
+	{
+		
+		is_truncate_needed = (stat_check == 0) ? true : false;
+		
+		FAIL_IF(stat_check == (size_t)-1, ERROR_CALL_FAILED, "getFileSizeForFd() failed", false);
+		
+		//Whatever size the file has already got is mapped, the rest is mapped on demand
+		sharedMemoryFile.size = stat_check;
+		
+		if (is_truncate_needed)
+		{
+			initialFileSize = options.initialFileSize ? options.initialFileSize : INITIAL_FILE_SIZE;
+			
+			//Should always be more than at least ROOT_SIZE, the tomb CNode and the hot region
+			FAIL_IF(initialFileSize < FIRST_WRITE_OFFSET, ERROR_INITIALISATION, "Initial file size is too less", false);
+			FAIL_IF(options.maxFileSize && initialFileSize > options.maxFileSize, ERROR_INVALID_ARGUMENT, "Initial file size is more than maxFileSize", false);
+			
+			sharedMemoryFile.size = stat_check = HEADER_SIZE + initialFileSize;
+			
+			result = truncate(sharedMemoryFile.name, sharedMemoryFile.size);
+			FAIL_IF(result == -1, ERROR_SYSTEM_CALL, "truncate(2) failed", false);
+		}
+		
+		FAIL_IF(sharedMemoryFile.size < HEADER_SIZE + FIRST_WRITE_OFFSET, ERROR_INITIALISATION, "Shared memory file is too small to be one", false);
+		
+#if RESERVED_MAPPING_GB
+		FAIL_IF(sharedMemoryFile.size > HEADER_SIZE + RESERVED_MAPPING_SIZE, ERROR_INITIALISATION, "Shared memory file is bigger than RESERVED_MAPPING_GB", false);
+		
+		//Mapping beyond the end of the file is fine as long as those pages aren't touched
+		sharedMemoryFile.size = HEADER_SIZE + RESERVED_MAPPING_SIZE;
+#endif
+		
+		header = mmap(NULL, sharedMemoryFile.size, PROT_READ | PROT_WRITE, MAP_SHARED, sharedMemoryFile.fd, 0);
+		
+		FAIL_IF(header == MAP_FAILED, ERROR_SYSTEM_CALL, "mmap(2) failed", false);
+		
+		//stat_check still is the size of the file, which may be less than what is mapped
+		adviseMapping(header, sharedMemoryFile.size, stat_check);
+		
+		//Offsets are counted from the end of the header
+		new_mapping->base = (void *)header + HEADER_SIZE;
+		new_mapping->size = sharedMemoryFile.size - HEADER_SIZE;
+		
+		new_manager->sharedMemoryFile_fd = sharedMemoryFile.fd;
+		new_manager->status              = &(header->status);
+		
+	}
+	
+	
+	if (!setUpHeader(header))
+	{
+		munmap(header, sharedMemoryFile.size);
+		
+		print_error("setUpHeader() failed");
+		return false;
+	}
+	
+	
+	/*
+	 *	As the file size is expanded by truncate(2) which fills the file with '\0',
+	 *	sharedMemoryFileSize and writeFromOffset are initially 0.
+	 *
+	 *	Whichever thread or process opens the file, needs to check for
+	 *	new_manager->status->sharedMemoryFileSize and
+	 *	new_manager->status->writeFromOffset.
+	 *	If these two are found 0, replace them with appropriate initial values.
+	 *	sharedMemoryFileSize doesn't count the header.
+	 */
+	size_t oldValue, newValue;
+	
+	//The file may have been created by a process with another initial size
+	oldValue = 0;
+	newValue = stat_check - HEADER_SIZE;
+	
+	CAS_size_t(&oldValue, newValue, &(new_manager->status->sharedMemoryFileSize) );
+	
+	FAIL_IF(new_manager->status->sharedMemoryFileSize == 0, ERROR_INITIALISATION, "CAS for sharedMemoryFileSize failed", false);
+	
+	oldValue = 0;
+	newValue = FIRST_WRITE_OFFSET; //write after ROOT_SIZE bytes, the tomb CNode and the hot region
+	//PADDING_BYTES are kept after root CNode too, as it gets dumped and recycled like any other CNode
+	//The tomb CNode is never written to, so it needs no PADDING_BYTES
+	
+	CAS_size_t(&oldValue, newValue, &(new_manager->status->writeFromOffset) );
+	
+	FAIL_IF(new_manager->status->writeFromOffset == 0, ERROR_INITIALISATION, "CAS for writeFromOffset failed", false);
+	
+	
+	
+	//	If rootINode->mainNode is 0, need to initialise it.
+	//	It will be 0 the first time of this CAS because file is given its size
+	//	through truncate(2), which fills file with '\0'.
+	//	Every thread opening this file needs to make this check.
+	
+	oldValue = 0;
+	newValue = sizeof(INode);
+	
+	INode *rootINode = new_mapping->base;
+	
+	CAS_size_t(&oldValue, newValue, &(rootINode->mainNode));
+	
+	FAIL_IF(rootINode->mainNode == 0, ERROR_INITIALISATION, "Couldn't set root INode's mainNode", false);
+	
+	return true;
+	
+}
+
+
+
+bool setUpHeader(struct SharedMemoryHeader *header)
+{
+	
+	FAIL_IF(header == NULL, ERROR_INVALID_ARGUMENT, "Arg(header) is NULL", false);
+	
+	size_t oldValue;
+	
+	oldValue = 0;
+	
+	//Only whoever claims the fresh header writes it, so layouts of different builds never mix
+	if (CAS_size_t(&oldValue, HEADER_BEING_WRITTEN, &(header->magic)))
+	{
+		header->layoutVersion   = LAYOUT_VERSION;
+		header->headerSize      = HEADER_SIZE;
+		header->statusSize      = sizeof(struct SharedMemoryStatus);
+		header->iNodeSize       = sizeof(INode);
+		header->cNodeSize       = sizeof(CNode);
+		header->lowerLimit      = LOWER_LIMIT;
+		header->upperLimit      = UPPER_LIMIT;
+		header->layoutFlags     = LAYOUT_FLAGS;
+		header->sharedMemoryCap = SHARED_MEMORY_CAP;
+		header->hotRegionSize   = LAYOUT_HOT_REGION_SIZE;
+		header->valueSize       = VALUE_SIZE;
+		
+		//Defaults are taken only here, so EXPANDING_SIZE isn't evaluated on every expansion
+		header->options.initialFileSize = options.initialFileSize ? options.initialFileSize : INITIAL_FILE_SIZE;
+		header->options.expandingSize   = options.expandingSize   ? options.expandingSize   : EXPANDING_SIZE;
+		header->options.growthPercent   = options.growthPercent   ? options.growthPercent   : GROWTH_PERCENT;
+		header->options.maxFileSize     = options.maxFileSize     ? options.maxFileSize     : (size_t)-1 - HEADER_SIZE;
+		header->options.dumpYardSize    = options.dumpYardSize    ? options.dumpYardSize    : DUMP_YARD_SIZE;
+		header->options.compaction      = options.compaction;
+		
+		oldValue = HEADER_BEING_WRITTEN;
+		
+		CAS_size_t(&oldValue, HEADER_MAGIC, &(header->magic));
+	}
+	
+	//Its writer only has a few stores left to do
+	while (header->magic == HEADER_BEING_WRITTEN)
+		;
+	
+	FAIL_IF(header->magic != HEADER_MAGIC, ERROR_INITIALISATION, "Not a shared memory file", false);
+	
+	FAIL_IF(header->layoutVersion   != LAYOUT_VERSION                      ||
+			header->headerSize      != HEADER_SIZE                         ||
+			header->statusSize      != sizeof(struct SharedMemoryStatus)   ||
+			header->iNodeSize       != sizeof(INode)                       ||
+			header->cNodeSize       != sizeof(CNode)                       ||
+			header->lowerLimit      != LOWER_LIMIT                         ||
+			header->upperLimit      != UPPER_LIMIT                         ||
+			header->layoutFlags     != LAYOUT_FLAGS                        ||
+			header->sharedMemoryCap != SHARED_MEMORY_CAP                   ||
+			header->hotRegionSize   != LAYOUT_HOT_REGION_SIZE              ||
+			header->valueSize       != VALUE_SIZE,
+			ERROR_INITIALISATION, "Shared memory file was made by a library built with another layout", false);
+	
+	//`initialFileSize` only matters to whoever creates the file
+	FAIL_IF((options.expandingSize != 0 && options.expandingSize != header->options.expandingSize) ||
+			(options.growthPercent != 0 && options.growthPercent != header->options.growthPercent) ||
+			(options.maxFileSize   != 0 && options.maxFileSize   != header->options.maxFileSize)   ||
+			(options.dumpYardSize  != 0 && options.dumpYardSize  != header->options.dumpYardSize)  ||
+			(options.compaction    != 0 && options.compaction    != header->options.compaction),
+			ERROR_INITIALISATION, "Shared memory file was made with other options", false);
+	
+	//Every process grows the file alike
+	options = header->options;
+	
+	return true;
+	
+}
+
+
+
+bool __dtsharedmemory_insert(const char *path, uint8_t flags)
+{
+	return insertPath(path, flags, NULL);
+}
+
+
+
+#if VALUE_SIZE
+
+bool __dtsharedmemory_insert_value(const char *path, uint8_t flags, const void *value)
+{
+	FAIL_IF(value == NULL, ERROR_INVALID_ARGUMENT, "Arg(value) is NULL", false);
+	
+	return insertPath(path, flags, value);
+}
+
+#endif
+
+
+
+bool insertPath(const char *path, uint8_t flags, const void *value)
+{
+	
+	FAIL_IF(!MANAGER_OR_ATTACH(), ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	FAIL_IF(path == NULL, ERROR_INVALID_ARGUMENT, "Arg(path) is NULL", false);
+	
+	size_t pathLength;
+	size_t compactions;
+	size_t reading;
+	
+	bool result;
+	bool isRetryNeeded;
+	
+	PROBE2(insert__entry, path, flags);
+	
+	countStat(STAT_INSERTS);
+	
+	pathLength = strlen(path);
+	
+	/**
+	 *	If the path getting inserted is a prefix, and the last character of
+	 *	the inputted path is '/', just ignore the '/' and treat it like it was
+	 *	never in the Arg(path) because that's how __dtsharedmemory_search() will
+	 *	detect the prefix. The code in the end of tryInsertion() makes the ending node of a prefix path
+	 *	contain 0 in the `possibilities` array for '/' so that search can detect the prefix.
+	 **/
+	if ((flags & IS_PREFIX) && pathLength > 0 && path[pathLength - 1] == '/')
+	{
+		--pathLength;
+	}
+	
+	if (!keyForPath(&path, &pathLength))
+	{
+		PROBE2(insert__return, path, false);
+		return false;
+	}
+	
+	reading = startReading();
+	
+	reclaimDetachedSubtrees(RECLAIM_BATCH_SIZE);
+	
+#if LATENCY_SAMPLING
+	struct timespec start;
+	bool isSampled = startLatencySample(LATENCY_OF_INSERT, &start);
+#endif
+	
+	//Made again in the copy if the ctrie got compacted meanwhile
+	do
+	{
+		compactions = waitForCompaction();
+		
+		do
+		{
+			result = tryInsertion(path, pathLength, flags, value, compactions, &isRetryNeeded);
+			
+		} while (isRetryNeeded && countInsertRetry(path));
+		
+	} while (isCompactedSince(compactions));
+	
+	stopReading(reading);
+	
+#if LATENCY_SAMPLING
+	if (isSampled)
+		recordLatency(LATENCY_OF_INSERT, &start);
+#endif
+	
+	PROBE2(insert__return, path, result);
+	
+	return result;
+}
+
+
+
+bool tryInsertion(const char *path, size_t pathLength, uint8_t flags, const void *value, size_t compactions, bool *isRetryNeeded)
+{
+	
+	size_t traverser = 0;
+	size_t oldValue, newValue;
+	size_t childINode;
+	
+	//Characters up to which the tail goes
+	size_t tailEnd = pathLength;
+	
+	//INode from which `traverser` was reached and the entry that leads to it
+	size_t parentINode = 0;
+	uint8_t parentIndex = 0;
+	
+#if SHARED_MEMORY_CAP
+	//CNode of parentINode in which the entry was found, see isStillLinked()
+	CNode *parentCNode = NULL;
+#endif
+	
+	INode *currentINode;
+	CNode *currentCNode;
+	CNode *copiedCNode;
+	CNode tempCNode;
+	
+	size_t offsetToCopiedChildCNode;
+	
+	size_t currentCharacter;
+	
+	uint8_t pathCharacter;
+	
+	struct PrivateTail tail;
+	size_t offsetToTailNode;
+	size_t tailNode = 0;
+	
+	bool result;
+	bool isEndOfString;
+	bool isAlreadyInserted;
+	bool isParentTombed;
+	bool isCompacted = false;
+	
+	*isRetryNeeded = false;
+	
+	
+	/**
+	 *	Read-only walk.
+	 *	Most of the insertions are made for paths that already exist in shared
+	 *	memory (many processes race to insert the same popular paths), so first
+	 *	follow existing edges just like __dtsharedmemory_search() does. Nothing is
+	 *	reserved or CAS'd until the first missing edge is found.
+	 **/
+	for (currentCharacter = 0 ; currentCharacter < pathLength ; ++currentCharacter)
+	{
+		
+		pathCharacter = *(path + currentCharacter);
+		
+#ifndef STANDALONE_DTSM
+		//13 ascii is custom icon representer on macOS
+		if (pathCharacter == 13)
+			continue;
+#endif
+		
+		FAIL_IF(pathCharacter > (uint8_t)UPPER_LIMIT && !isKeySeparator(path + currentCharacter), ERROR_INVALID_CHARACTER, "Not accepting characters above UPPER_LIMIT", false);
+		FAIL_IF(pathCharacter < (uint8_t)LOWER_LIMIT, ERROR_INVALID_CHARACTER, "Not accepting characters below LOWER_LIMIT", false);
+		
+		currentINode = GOTO_OFFSET(traverser);
+		
+		FAIL_IF(!currentINode, ERROR_BAD_OFFSET, "currentINode found NULL", false);
+		
+		GUARD_CNODE_ACCESS
+		(
+		childINode = currentCNode->possibilities[pathCharacter - LOWER_LIMIT];
+		)
+		
+#if SHARED_MEMORY_CAP
+		//Taken out and maybe recycled for some other path meanwhile
+		if (parentCNode != NULL && !isStillLinked(parentINode, parentCNode, parentIndex, traverser))
+		{
+			*isRetryNeeded = true;
+			return false;
+		}
+		
+		//The path being inserted keeps its ancestors alive too
+		markAsReferenced(currentINode, currentCNode);
+#endif
+		
+		if (childINode == 0)
+			break;
+		
+		parentINode = traverser;
+		parentIndex = pathCharacter - LOWER_LIMIT;
+		traverser   = childINode;
+		
+#if SHARED_MEMORY_CAP
+		parentCNode = currentCNode;
+#endif
+	}
+	
+	
+	/**
+	 *	Write protocol, starting from the first missing edge.
+	 *	If the read-only walk reached the end of the path this block doesn't execute.
+	 *
+	 *	Nobody else can see nodes for the remaining suffix yet, so instead of
+	 *	copying and CAS'ing one node per character, the whole chain for the suffix is
+	 *	written privately by createPrivateTail() and gets linked
+	 *	into the ctrie by a single CAS at the node where the path diverges.
+	 *	If some other thread creates the missing edge before the CAS, its node is
+	 *	followed and the next node of the tail is tried to be linked from there.
+	 **/
+	if (currentCharacter < pathLength)
+	{
+#if SHARED_MEMORY_CAP
+		//Longer suffixes are linked a piece at a time, see TAIL_PIECE_NODES
+		if (pathLength - currentCharacter > TAIL_PIECE_NODES)
+			tailEnd = currentCharacter + TAIL_PIECE_NODES;
+#endif
+		
+		result = createPrivateTail(path + currentCharacter, tailEnd - currentCharacter, currentCharacter, tailEnd == pathLength, flags, value, &tail);
+		
+		FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to create tail for new nodes", false);
+	}
+	
+	for ( ; currentCharacter < tailEnd ; ++currentCharacter)
+	{
+		
+		pathCharacter = *(path + currentCharacter);
+		
+#ifndef STANDALONE_DTSM
+		//13 ascii is custom icon representer on macOS
+		if (pathCharacter == 13)
+			continue;
+#endif
+		
+		//Range of characters has already been checked by createPrivateTail()
+		
+		currentINode = GOTO_OFFSET(traverser);
+		
+		FAIL_IF(!currentINode, ERROR_BAD_OFFSET, "currentINode found NULL", false);
+		
+		offsetToTailNode = offsetToTailINode(&tail, tailNode);
+		
+		GUARD_CNODE_ACCESS
+		(
+		childINode = currentCNode->possibilities[pathCharacter - LOWER_LIMIT];
+		)
+		
+#if SHARED_MEMORY_CAP
+		if (parentCNode != NULL && !isStillLinked(parentINode, parentCNode, parentIndex, traverser))
+		{
+			discardPrivateTail(&tail);
+			
+			*isRetryNeeded = true;
+			return false;
+		}
+#endif
+		
+		if (childINode == 0)
+		{
+			
+			/**
+			 *	Entering this `if` block means the node doesn't contain pathCharacter
+			 *	This block would create a copy of currentCNode linking the tail
+			 *	and try repeated CAS on currentINode->mainNode.
+			 **/
+			
+			result = getSpaceForCNode(&offsetToCopiedChildCNode, traverser);
+			
+			FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to insert new node", false);
+			
+			copiedCNode = GOTO_OFFSET(offsetToCopiedChildCNode);
+			
+			FAIL_IF(!copiedCNode, ERROR_BAD_OFFSET, "copiedCNode found NULL", false);
+			
+			do
+			{
+				
+				oldValue = currentINode->mainNode;
+				
+				//currentINode has been removed, it must never be CAS'd again
+				if (MAIN_NODE(oldValue) == TOMB_CNODE_OFFSET)
+					break;
+				
+				GUARD_CNODE_ACCESS
+				(
+				childINode = currentCNode->possibilities[pathCharacter - LOWER_LIMIT];
+				)
+				
+#if SHARED_MEMORY_CAP
+				//Same as removed, it may have been recycled for some other path
+				if (parentCNode != NULL && !isStillLinked(parentINode, parentCNode, parentIndex, traverser))
+				{
+					oldValue = TOMB_CNODE_OFFSET;
+					break;
+				}
+#endif
+				
+				if (childINode)
+				{
+					//Some other thread may create a copy of the currentCNode and
+					//try to update the same array entry as this thread is doing.
+					//If this check is not made, one of the 2 insertions will fail.
+					
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+					//As the newly reserved offset is wasted, dump it.
+					dumpWastedMemory(offsetToCopiedChildCNode, traverser);
+#endif
+					break;
+					
+				}
+				
+				//The tail and the copy may be in the region retired by __dtsharedmemory_compact().
+				//Checked after reading `oldValue`, so currentINode can only be in the copy if
+				//it is the root, whose CAS then fails.
+				if (isCompactedSince(compactions))
+				{
+					isCompacted = true;
+					break;
+				}
+				
+				//The nodes on the way to a new path get a chance to be searched before they are evicted
+				newValue = offsetToCopiedChildCNode | REFERENCED_MAIN_NODE;
+				
+				//Need not be inside GUARD_CNODE_ACCESS because if the CNode changes,
+				//cas will fail anyway
+				tempCNode = *currentCNode;
+				
+				result = createUpdatedCNodeCopy(copiedCNode, tempCNode, -1, tempCNode.isEndOfString, tempCNode.flags);
+				
+				FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to update CNode", false);
+				
+				copiedCNode->possibilities[pathCharacter - LOWER_LIMIT] = offsetToTailNode;
+				
+			} while ( !CAS_size_t( &oldValue, NEXT_MAIN_NODE(oldValue, newValue), &(currentINode->mainNode) ) && countInsertRetry(path) );
+			
+			
+			if (isCompacted)
+			{
+				//__dtsharedmemory_insert() makes the insertion again in the copy
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+				dumpWastedMemory(offsetToCopiedChildCNode, traverser);
+#endif
+				discardPrivateTail(&tail);
+				
+				return false;
+			}
+			
+			if (MAIN_NODE(oldValue) == TOMB_CNODE_OFFSET)
+			{
+				//Take the removed INode out of its parent and start again
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+				dumpWastedMemory(offsetToCopiedChildCNode, traverser);
+#endif
+				discardPrivateTail(&tail);
+				
+				result = compressTombedChild(parentINode, parentIndex, traverser, &isParentTombed);
+				
+				FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to remove tombed INode", false);
+				
+				*isRetryNeeded = true;
+				return false;
+			}
+			
+			if (childINode == 0)
+			{
+				//Tail got linked, which completes the insertion
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+				dumpWastedMemory(MAIN_NODE(oldValue), traverser);
+				
+				//Nodes of the tail before the linked one are never used
+				freeUnusedTailNodes(&tail, tailNode);
+#endif
+				
+#if SHARED_MEMORY_CAP
+				//Only a piece of the suffix, the next one is linked below it
+				if (tailEnd < pathLength)
+				{
+					*isRetryNeeded = true;
+					return false;
+				}
+#endif
+				return true;
+			}
+			
+		}
+		
+		parentINode = traverser;
+		parentIndex = pathCharacter - LOWER_LIMIT;
+		traverser   = childINode;
+		++tailNode;
+		
+#if SHARED_MEMORY_CAP
+		parentCNode = currentCNode;
+#endif
+		
+	}
+	
+	if (tailNode > 0)
+	{
+		//	Some other thread inserted the complete path meanwhile (mostly the same path racing).
+		//	No node of the tail got linked.
+		discardPrivateTail(&tail);
+	}
+	
+#if SHARED_MEMORY_CAP
+	//The piece was there already, the next one is linked below it
+	if (tailEnd < pathLength)
+	{
+		*isRetryNeeded = true;
+		return false;
+	}
+#endif
+	
+	
+	currentINode = GOTO_OFFSET(traverser);
+	FAIL_IF(!currentINode, ERROR_BAD_OFFSET, "currentINode found NULL", false);
+	
+	
+	/**
+	 *	Fast path: the ending node already marks the end of string with the same flags,
+	 *	so there is nothing to update. Return without reserving any memory.
+	 **/
+	GUARD_CNODE_ACCESS
+	(
+	isAlreadyInserted = isInsertionRedundant(currentCNode, flags, value);
+	)
+	
+	if (isAlreadyInserted)
+		return true;
+	
+	
+	result = getSpaceForCNode(&offsetToCopiedChildCNode, traverser);
+	
+	FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to insert new node", false);
+	
+	copiedCNode = GOTO_OFFSET(offsetToCopiedChildCNode);
+	
+	FAIL_IF(!copiedCNode, ERROR_BAD_OFFSET, "copiedCNode found NULL", false);
+	
+	do
+	{
+		
+		oldValue = currentINode->mainNode;
+		
+		//A new path gets a chance to be searched before it is evicted
+		newValue = offsetToCopiedChildCNode | REFERENCED_MAIN_NODE;
+		
+		//currentINode has been removed, it must never be CAS'd again
+		if (MAIN_NODE(oldValue) == TOMB_CNODE_OFFSET)
+			break;
+		
+#if SHARED_MEMORY_CAP
+		//Same as removed, it may have been recycled for some other path
+		if (parentCNode != NULL && !isStillLinked(parentINode, parentCNode, parentIndex, traverser))
+		{
+			oldValue = TOMB_CNODE_OFFSET;
+			break;
+		}
+#endif
+		
+		//Same as above
+		if (isCompactedSince(compactions))
+		{
+			isCompacted = true;
+			break;
+		}
+		
+		//Need not be inside GUARD_CNODE_ACCESS because if the CNode changes,
+		//CAS will fail anyway
+		currentCNode = GOTO_OFFSET(MAIN_NODE(oldValue));
+		FAIL_IF(!currentCNode, ERROR_BAD_OFFSET, "currentCNode found NULL", false);
+		tempCNode = *currentCNode;
+		
+		//Some other thread made the same insertion meanwhile
+		if (isInsertionRedundant(&tempCNode, flags, value) && oldValue == currentINode->mainNode)
+		{
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+			dumpWastedMemory(offsetToCopiedChildCNode, traverser);
+#endif
+			return true;
+		}
+		
+		//-1 in the function call below indicates no updations required in array.
+		//Only need to change isEndOfString and flags.
+		isEndOfString = true;
+		result = createUpdatedCNodeCopy(copiedCNode, tempCNode, -1, isEndOfString, flags);
+		
+		FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to update CNode", false);
+		
+#if VALUE_SIZE
+		if (value != NULL)
+			memcpy(copiedCNode->value, value, VALUE_SIZE);
+#endif
+		
+		if (flags & IS_PREFIX)
+		{
+			//So that paths that have already been inseted with this
+			//prefix can be searched as prefixes now (see __dtsharedmemory_search())
+			copiedCNode->possibilities['/' - LOWER_LIMIT] = 0;
+		}
+		
+	} while ( !CAS_size_t( &oldValue, NEXT_MAIN_NODE(oldValue, newValue), &(currentINode->mainNode) ) && countInsertRetry(path) );
+	
+	if (isCompacted)
+	{
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+		dumpWastedMemory(offsetToCopiedChildCNode, traverser);
+#endif
+		return false;
+	}
+	
+	if (MAIN_NODE(oldValue) == TOMB_CNODE_OFFSET)
+	{
+		//Take the removed INode out of its parent and start again
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+		dumpWastedMemory(offsetToCopiedChildCNode, traverser);
+#endif
+		result = compressTombedChild(parentINode, parentIndex, traverser, &isParentTombed);
+		
+		FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to remove tombed INode", false);
+		
+		*isRetryNeeded = true;
+		return false;
+	}
+	
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+	dumpWastedMemory(MAIN_NODE(oldValue), traverser);
+#endif
+	
+	return true;
+}
+
+
+
+//Times searchPath() when LATENCY_SAMPLING is not 0
+static inline bool sampleSearch(const char *path, uint8_t *flags, void *value)
+{
+	
+	bool result;
+	size_t reading;
+	
+	PROBE1(search__entry, path);
+	
+#if LATENCY_SAMPLING
+	struct timespec start;
+	bool isSampled = startLatencySample(LATENCY_OF_SEARCH, &start);
+#endif
+	
+	reading = startReading();
+	
+	result = searchPath(path, flags, value);
+	
+	stopReading(reading);
+	
+#if LATENCY_SAMPLING
+	if (isSampled)
+		recordLatency(LATENCY_OF_SEARCH, &start);
+#endif
+	
+	PROBE3(search__return, path, result, result ? *flags : 0);
+	
+	return result;
+}
+
+
+
+bool __dtsharedmemory_search(const char *path, uint8_t *flags)
+{
+	return sampleSearch(path, flags, NULL);
+}
+
+
+
+#if VALUE_SIZE
+
+bool __dtsharedmemory_search_value(const char *path, uint8_t *flags, void *value)
+{
+	FAIL_IF(value == NULL, ERROR_INVALID_ARGUMENT, "Arg(value) is NULL", false);
+	
+	return sampleSearch(path, flags, value);
+}
+
+#endif
+
+
+
+bool searchPath(const char *path, uint8_t *flags, void *value)
+{
+	
+	FAIL_IF(!MANAGER_OR_ATTACH(), ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	FAIL_IF(path == NULL, ERROR_INVALID_ARGUMENT, "Arg(path) is NULL", false);
+	
+	countStat(STAT_SEARCHES);
+	
+	int currentCharacter;
+	uint8_t pathCharacter;
+	
+	
+	size_t traverser = 0;
+	INode *currentINode;
+	CNode *currentCNode;
+	bool isEndOfString;
+	
+	bool entryFor_pathCharacter;
+	uint8_t flagsForCurrentCNode;
+	
+#if SHARED_MEMORY_CAP
+	//INode from which `traverser` was reached, see isStillLinked()
+	size_t parentINode = 0;
+	CNode *parentCNode = NULL;
+	int parentIndex    = 0;
+#endif
+	
+	size_t pathLength;
+	
+	//strlen() is only needed to prepend the namespace, the walk stops at '\0' anyway
+	if (namespaceLength != 0)
+	{
+		pathLength = strlen(path);
+		
+		if (!keyForPath(&path, &pathLength))
+			return false;
+	}
+	
+	for (currentCharacter = 0 ; *(path + currentCharacter) != '\0' ; ++currentCharacter)
+	{
+		
+		pathCharacter = *(path + currentCharacter);
+	
+#if STANDALONE_DTSM
+		//13 ascii is custom icon representer
+		if (pathCharacter == 13)
+			continue;
+#endif
+		
+		FAIL_IF(pathCharacter > (uint8_t)UPPER_LIMIT && !isKeySeparator(path + currentCharacter), ERROR_INVALID_CHARACTER, "Not accepting characters above UPPER_LIMIT", false);
+		FAIL_IF(pathCharacter < (uint8_t)LOWER_LIMIT, ERROR_INVALID_CHARACTER, "Not accepting characters below LOWER_LIMIT", false);
+		
+		
+		currentINode = GOTO_OFFSET(traverser);
+		
+		FAIL_IF(!currentINode, ERROR_BAD_OFFSET, "currentINode found NULL", false);
+		
+		GUARD_CNODE_ACCESS
+		(
+		entryFor_pathCharacter = currentCNode->possibilities[pathCharacter - LOWER_LIMIT];
+		flagsForCurrentCNode   = currentCNode->flags;
+		
+		//Only a prefix can be found here
+		if (flagsForCurrentCNode & IS_PREFIX)
+			COPY_VALUE(value, currentCNode);
+		)
+		
+#if SHARED_MEMORY_CAP
+		//Taken out meanwhile, so the path doesn't exist anymore
+		if (parentCNode != NULL && !isStillLinked(parentINode, parentCNode, parentIndex, traverser))
+			return false;
+		
+		markAsReferenced(currentINode, currentCNode);
+#endif
+		
+		if ( entryFor_pathCharacter == false)
+		{
+			
+			if (pathCharacter == '/' && (flagsForCurrentCNode & IS_PREFIX))
+			{
+				*flags = flagsForCurrentCNode;
+				
+				countStat(STAT_SEARCH_HITS);
+				countStat(STAT_PREFIX_HITS);
+				
+				return true;
+			}
+			
+			
+			//Doesn't exist in shared memory
+			return false;
+		}
+		
+		
+#if SHARED_MEMORY_CAP
+		parentINode = traverser;
+		parentIndex = pathCharacter - LOWER_LIMIT;
+#endif
+		
+		GUARD_CNODE_ACCESS
+		(
+		traverser = currentCNode->possibilities[pathCharacter - LOWER_LIMIT];
+		)
+		
+#if SHARED_MEMORY_CAP
+		parentCNode = currentCNode;
+#endif
+		
+	}
+	
+	currentINode = GOTO_OFFSET(traverser);
+	
+	FAIL_IF(!currentINode, ERROR_BAD_OFFSET, "currentINode found NULL", false);
+	
+	GUARD_CNODE_ACCESS
+	(
+	*flags        = currentCNode->flags;
+	isEndOfString = currentCNode->isEndOfString;
+	COPY_VALUE(value, currentCNode);
+	)
+	
+#if SHARED_MEMORY_CAP
+	if (parentCNode != NULL && !isStillLinked(parentINode, parentCNode, parentIndex, traverser))
+		return false;
+	
+	if (isEndOfString)
+		markAsReferenced(currentINode, currentCNode);
+#endif
+	
+	if (isEndOfString)
+		countStat(STAT_SEARCH_HITS);
+	
+	return isEndOfString;
+}
+
+
+
+bool __dtsharedmemory_remove(const char *path)
+{
+	
+	FAIL_IF(!MANAGER_OR_ATTACH(), ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	FAIL_IF(path == NULL, ERROR_INVALID_ARGUMENT, "Arg(path) is NULL", false);
+	
+	size_t pathLength;
+	
+	pathLength = strlen(path);
+	
+	if (!keyForPath(&path, &pathLength))
+		return false;
+	
+	return removePath(path, pathLength, false);
+}
+
+
+
+bool __dtsharedmemory_remove_prefix(const char *prefix)
+{
+	
+	FAIL_IF(!MANAGER_OR_ATTACH(), ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	FAIL_IF(prefix == NULL, ERROR_INVALID_ARGUMENT, "Arg(prefix) is NULL", false);
+	
+	size_t prefixLength;
+	
+	prefixLength = strlen(prefix);
+	
+	//Same as __dtsharedmemory_insert() does for prefixes
+	if (prefixLength > 0 && prefix[prefixLength - 1] == '/')
+	{
+		--prefixLength;
+	}
+	
+	if (!keyForPath(&prefix, &prefixLength))
+		return false;
+	
+	return removePath(prefix, prefixLength, true);
+}
+
+
+
+bool __dtsharedmemory_set_namespace(const char *name)
+{
+	
+	size_t nameLength, i;
+	
+	nameLength = (name != NULL ? strlen(name) : 0);
+	
+	FAIL_IF(nameLength >= NAMESPACE_SIZE, ERROR_INVALID_ARGUMENT, "Arg(name) is too long", false);
+	
+	for (i = 0 ; i < nameLength ; ++i)
+	{
+		FAIL_IF(name[i] == '/', ERROR_INVALID_ARGUMENT, "Arg(name) can't contain '/'", false);
+		FAIL_IF((uint8_t)name[i] > (uint8_t)UPPER_LIMIT, ERROR_INVALID_CHARACTER, "Not accepting characters above UPPER_LIMIT", false);
+		FAIL_IF((uint8_t)name[i] < (uint8_t)LOWER_LIMIT, ERROR_INVALID_CHARACTER, "Not accepting characters below LOWER_LIMIT", false);
+	}
+	
+	if (nameLength != 0)
+		memcpy(namespaceName, name, nameLength);
+	
+	namespaceName[nameLength] = '\0';
+	namespaceLength = nameLength;
+	
+	return true;
+}
+
+
+
+bool __dtsharedmemory_reset()
+{
+	
+	FAIL_IF(!MANAGER_OR_ATTACH(), ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	
+	size_t oldValue, keyLength = 1;
+	const char *key = "/";
+	
+	//Paths of a namespace all start with '/', so they are all inside the key of the namespace
+	//without it, which is removed as a prefix
+	if (namespaceLength != 0 && !keyForPath(&key, &keyLength))
+		return false;
+	
+	if (namespaceLength != 0 ? !removePath(key, keyLength - 1, true) : !removeDefaultNamespace())
+		return false;
+	
+	do
+	{
+		oldValue = manager->status->generation;
+		
+	} while ( !CAS_size_t( &oldValue, oldValue + 1, &(manager->status->generation) ) );
+	
+	return true;
+}
+
+
+
+size_t __dtsharedmemory_get_generation()
+{
+	return (manager != NULL ? manager->status->generation : 0);
+}
+
+
+
+bool __dtsharedmemory_compact()
+{
+	
+	FAIL_IF(!MANAGER_OR_ATTACH(), ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	
+#if COMPACTION_AVAILABLE
+	
+	bool result;
+	size_t reading;
+	
+	FAIL_IF(options.compaction == 0, ERROR_CALL_FAILED, "Shared memory file wasn't made with compaction", false);
+	
+	reading = startReading();
+	reclaimDetachedSubtrees(RECLAIM_BATCH_SIZE);
+	stopReading(reading);
+	
+	//Not an error, some other thread is compacting
+	if (!lockCompaction())
+		return false;
+	
+	if (manager->status->retiredEnd != 0)
+		result = reuseRetiredRegion();
+	else
+		result = compactCtrie();
+	
+	manager->status->compactingProcess = 0;
+	
+	return result;
+	
+#else
+	
+	FAIL_IF(true, ERROR_CALL_FAILED, "Compaction needs the stack of freed CNodes and SHARED_MEMORY_CAP to be 0", false);
+	
+#endif
+	
+}
+
+
+
+bool __dtsharedmemory_get_stats(struct SharedMemoryStats *stats)
+{
+	
+	FAIL_IF(stats == NULL, ERROR_INVALID_ARGUMENT, "Arg(stats) is NULL", false);
+	
+	memset(stats, 0, sizeof(struct SharedMemoryStats));
+	
+#if !(DISABLE_STATISTICS)
+	
+	FAIL_IF(!MANAGER_OR_ATTACH(), ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	
+	size_t sums[NUMBER_OF_STATS] = {0};
+	int stat, shard;
+	
+	//In decreasing order, so hits are read before searches (see the prototype)
+	for (stat = NUMBER_OF_STATS - 1 ; stat >= 0 ; --stat)
+	{
+		for (shard = 0 ; shard < STATS_SHARDS ; ++shard)
+		{
+			sums[stat] += manager->status->stats[shard][stat];
+		}
+	}
+	
+	stats->searches      = sums[STAT_SEARCHES];
+	stats->hits          = sums[STAT_SEARCH_HITS];
+	stats->misses        = sums[STAT_SEARCHES] - sums[STAT_SEARCH_HITS];
+	stats->prefixHits    = sums[STAT_PREFIX_HITS];
+	stats->inserts       = sums[STAT_INSERTS];
+	stats->insertRetries = sums[STAT_INSERT_RETRIES];
+	stats->guardRetries  = sums[STAT_GUARD_RETRIES];
+	stats->recycleHits   = sums[STAT_RECYCLE_HITS];
+	stats->recycleMisses = sums[STAT_RECYCLE_MISSES];
+	stats->dumpYardFull  = sums[STAT_DUMP_YARD_FULL];
+	stats->expansions    = sums[STAT_EXPANSIONS];
+	stats->usedBytes     = manager->status->writeFromOffset;
+	
+	return true;
+	
+#else
+	
+	return false;
+	
+#endif
+	
+}
+
+
+
+size_t __dtsharedmemory_get_latency_percentile(int operation, double percentile)
+{
+	
+#if LATENCY_SAMPLING
+	
+	FAIL_IF(!MANAGER_OR_ATTACH(), ERROR_NO_MANAGER, "Global(manager) is NULL", 0);
+	FAIL_IF(operation < 0 || operation >= NUMBER_OF_LATENCIES, ERROR_INVALID_ARGUMENT, "Arg(operation) is invalid", 0);
+	
+	size_t samples = 0, counted = 0;
+	size_t bucket;
+	
+	for (bucket = 0 ; bucket < LATENCY_BUCKETS ; ++bucket)
+	{
+		samples += manager->status->latencies[operation][bucket];
+	}
+	
+	if (samples == 0)
+		return 0;
+	
+	for (bucket = 0 ; bucket < LATENCY_BUCKETS ; ++bucket)
+	{
+		counted += manager->status->latencies[operation][bucket];
+		
+		if (counted != 0 && counted >= percentile / 100 * samples)
+			return bucketToLatency(bucket);
+	}
+	
+	return bucketToLatency(LATENCY_BUCKETS - 1);
+	
+#else
+	
+	return 0;
+	
+#endif
+	
+}
+
+
+
+int __dtsharedmemory_get_last_error()
+{
+	
+	if (errorsRecorded == 0)
+		return ERROR_NONE;
+	
+	return errorRing[(errorsRecorded - 1) % ERROR_RING_SIZE].error;
+}
+
+
+
+size_t __dtsharedmemory_get_errors(struct SharedMemoryError *errors, size_t count)
+{
+	
+	size_t i;
+	
+	if (errors == NULL)
+		return 0;
+	
+	if (count > errorsRecorded)
+		count = errorsRecorded;
+	
+	if (count > ERROR_RING_SIZE)
+		count = ERROR_RING_SIZE;
+	
+	for (i = 0 ; i < count ; ++i)
+	{
+		errors[i] = errorRing[(errorsRecorded - 1 - i) % ERROR_RING_SIZE];
+	}
+	
+	return count;
+}
+
+
+
+void __dtsharedmemory_clear_errors()
+{
+	errorsRecorded = 0;
+}
+
+
+
+const char *__dtsharedmemory_get_error_name(int error)
+{
+	
+	static const char *names[NUMBER_OF_ERRORS] =
+	{
+		"ERROR_NONE",
+		"ERROR_INVALID_ARGUMENT",
+		"ERROR_INVALID_CHARACTER",
+		"ERROR_NO_MANAGER",
+		"ERROR_SYSTEM_CALL",
+		"ERROR_OUT_OF_MEMORY",
+		"ERROR_INITIALISATION",
+		"ERROR_BAD_OFFSET",
+		"ERROR_CALL_FAILED",
+		"ERROR_INTERNAL"
+	};
+	
+	if (error < 0 || error >= NUMBER_OF_ERRORS)
+		return "ERROR_UNKNOWN";
+	
+	return names[error];
+}
+
+
+
+void __dtsharedmemory_set_error_sink(void (*sink)(const struct SharedMemoryError *error))
+{
+	errorSink = sink;
+}
+
+
+
+void __dtsharedmemory_set_debug_messages(bool areAllowed)
+{
+	__dtsharedmemory_are_debug_messages_on = areAllowed;
+}
+
+
+
+bool removePath(const char *path, size_t pathLength, bool isPrefix)
+{
+	
+	struct RemovalTrail *trail;
+	size_t compactions, reading;
+	bool result = false;
+	
+	//+1 as malloc(0) may return NULL
+	trail = (struct RemovalTrail *)malloc((pathLength + 1) * sizeof(struct RemovalTrail));
+	
+	FAIL_IF(trail == NULL, ERROR_SYSTEM_CALL, "malloc(2) failed", false);
+	
+	reading = startReading();
+	
+	do
+	{
+		compactions = waitForCompaction();
+		
+		if (removeUsingTrail(path, pathLength, isPrefix, trail))
+			result = true;
+		
+	} while (isCompactedSince(compactions));
+	
+	stopReading(reading);
+	
+	free(trail);
+	
+	return result;
+}
+
+
+
+bool removeUsingTrail(const char *path, size_t pathLength, bool isPrefix, struct RemovalTrail *trail)
+{
+	
+	size_t traverser = 0;
+	size_t oldValue, newValue;
+	size_t childINode;
+	size_t detachedINode;
+	
+	INode *currentINode;
+	CNode *currentCNode;
+	CNode *copiedCNode = NULL;
+	CNode tempCNode;
+	
+	size_t offsetToCopiedCNode = 0;
+	
+	size_t currentCharacter, depth;
+	
+	uint8_t pathCharacter;
+	
+	bool result;
+	
+	depth = 0;
+	
+	for (currentCharacter = 0 ; currentCharacter < pathLength ; ++currentCharacter)
+	{
+		
+		pathCharacter = *(path + currentCharacter);
+		
+#ifndef STANDALONE_DTSM
+		//13 ascii is custom icon representer on macOS
+		if (pathCharacter == 13)
+			continue;
+#endif
+		
+		FAIL_IF(pathCharacter > (uint8_t)UPPER_LIMIT && !isKeySeparator(path + currentCharacter), ERROR_INVALID_CHARACTER, "Not accepting characters above UPPER_LIMIT", false);
+		FAIL_IF(pathCharacter < (uint8_t)LOWER_LIMIT, ERROR_INVALID_CHARACTER, "Not accepting characters below LOWER_LIMIT", false);
+		
+		currentINode = GOTO_OFFSET(traverser);
+		
+		FAIL_IF(!currentINode, ERROR_BAD_OFFSET, "currentINode found NULL", false);
+		
+		GUARD_CNODE_ACCESS
+		(
+		childINode = currentCNode->possibilities[pathCharacter - LOWER_LIMIT];
+		)
+		
+		//Doesn't exist in shared memory
+		if (childINode == 0)
+			return false;
+		
+		trail[depth].iNode = traverser;
+		trail[depth].index = pathCharacter - LOWER_LIMIT;
+		++depth;
+		
+		traverser = childINode;
+	}
+	
+	
+	currentINode = GOTO_OFFSET(traverser);
+	FAIL_IF(!currentINode, ERROR_BAD_OFFSET, "currentINode found NULL", false);
+	
+	do
+	{
+		
+		oldValue = currentINode->mainNode;
+		
+		//Need not be inside GUARD_CNODE_ACCESS because if the CNode changes,
+		//CAS will fail anyway
+		currentCNode = GOTO_OFFSET(MAIN_NODE(oldValue));
+		FAIL_IF(!currentCNode, ERROR_BAD_OFFSET, "currentCNode found NULL", false);
+		tempCNode = *currentCNode;
+		
+		detachedINode = isPrefix ? tempCNode.possibilities['/' - LOWER_LIMIT] : 0;
+		
+		//Nothing to remove (also the case when the INode has already been tombed)
+		if (!tempCNode.isEndOfString && detachedINode == 0 && oldValue == currentINode->mainNode)
+		{
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+			if (copiedCNode != NULL)
+				freeCNode(offsetToCopiedCNode, traverser);
+#endif
+			return false;
+		}
+		
+		tempCNode.isEndOfString = false;
+		tempCNode.flags         = 0;
+		
+#if VALUE_SIZE
+		memset(tempCNode.value, 0, VALUE_SIZE);
+#endif
+		
+		if (isPrefix)
+		{
+			tempCNode.possibilities['/' - LOWER_LIMIT] = 0;
+		}
+		
+		if (traverser != 0 && isCNodeEmpty(&tempCNode))
+		{
+			newValue = TOMB_CNODE_OFFSET;
+		}
+		else
+		{
+			if (copiedCNode == NULL)
+			{
+				result = getSpaceForCNode(&offsetToCopiedCNode, traverser);
+				
+				FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to get space for CNode", false);
+				
+				copiedCNode = GOTO_OFFSET(offsetToCopiedCNode);
+				
+				FAIL_IF(!copiedCNode, ERROR_BAD_OFFSET, "copiedCNode found NULL", false);
+			}
+			
+			//Taken before __dtsharedmemory_compact() switched the root to the copy,
+			//removePath() makes the removal again in the copy
+			if (isRetired(offsetToCopiedCNode))
+				return false;
+			
+			result = createUpdatedCNodeCopy(copiedCNode, tempCNode, -1, tempCNode.isEndOfString, tempCNode.flags);
+			
+			FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to update CNode", false);
+			
+			//The copy keeps the second chance of the node, see evictColdPaths()
+			newValue = offsetToCopiedCNode | (oldValue & REFERENCED_MAIN_NODE);
+		}
+		
+	} while ( !CAS_size_t( &oldValue, NEXT_MAIN_NODE(oldValue, newValue), &(currentINode->mainNode) ) );
+	
+	
+	if (newValue == TOMB_CNODE_OFFSET)
+	{
+		
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+		//The copy was never made visible to anyone
+		if (copiedCNode != NULL)
+			freeCNode(offsetToCopiedCNode, traverser);
+		
+		freeCNode(MAIN_NODE(oldValue), traverser);
+#endif
+		
+		result = removeTombedINode(trail, depth, traverser);
+		
+		FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to remove tombed INode", false);
+		
+	}
+	else
+	{
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+		dumpWastedMemory(MAIN_NODE(oldValue), traverser);
+#endif
+	}
+	
+	
+	//Nobody can reach the paths inside the prefix anymore, except threads already inside.
+	//Reclaiming them is left to later insertions and compactions.
+	if (detachedINode != 0 && !queueDetachedSubtree(detachedINode))
+	{
+		tombSubtree(detachedINode);
+		
+#if SHARED_MEMORY_CAP
+		freeINode(detachedINode);
+#endif
+	}
+	
+	return true;
+}
+
+
+
+bool removeDefaultNamespace()
+{
+	
+	size_t compactions, reading;
+	bool result = false;
+	
+	reading = startReading();
+	
+	do
+	{
+		compactions = waitForCompaction();
+		
+		if (removeFromRoot())
+			result = true;
+		
+	} while (isCompactedSince(compactions));
+	
+	stopReading(reading);
+	
+	return result;
+}
+
+
+
+bool removeFromRoot()
+{
+	
+	size_t oldValue, newValue;
+	size_t offsetToCopiedCNode, detachedINode;
+	int index;
+	
+	INode *root;
+	CNode *currentCNode;
+	CNode *copiedCNode;
+	CNode tempCNode, keptCNode;
+	
+	bool result;
+	
+	root = GOTO_OFFSET(0);
+	FAIL_IF(!root, ERROR_BAD_OFFSET, "root found NULL", false);
+	
+	result = getSpaceForCNode(&offsetToCopiedCNode, 0);
+	FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to get space for CNode", false);
+	
+	copiedCNode = GOTO_OFFSET(offsetToCopiedCNode);
+	FAIL_IF(!copiedCNode, ERROR_BAD_OFFSET, "copiedCNode found NULL", false);
+	
+	memset(&keptCNode, 0, sizeof(CNode));
+	
+	do
+	{
+		
+		oldValue = root->mainNode;
+		
+		//Need not be inside GUARD_CNODE_ACCESS because if the CNode changes,
+		//CAS will fail anyway
+		currentCNode = GOTO_OFFSET(MAIN_NODE(oldValue));
+		FAIL_IF(!currentCNode, ERROR_BAD_OFFSET, "currentCNode found NULL", false);
+		tempCNode = *currentCNode;
+		
+		keptCNode.possibilities[NAMESPACE_SEPARATOR - LOWER_LIMIT] = tempCNode.possibilities[NAMESPACE_SEPARATOR - LOWER_LIMIT];
+		
+		//Nothing to remove
+		if (memcmp(tempCNode.possibilities, keptCNode.possibilities, sizeof(keptCNode.possibilities)) == 0 &&
+			!tempCNode.isEndOfString && oldValue == root->mainNode)
+		{
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+			freeCNode(offsetToCopiedCNode, 0);
+#endif
+			return false;
+		}
+		
+		//Taken before __dtsharedmemory_compact() switched the root to the copy,
+		//removeDefaultNamespace() makes the removal again in the copy
+		if (isRetired(offsetToCopiedCNode))
+			return false;
+		
+		result = createUpdatedCNodeCopy(copiedCNode, keptCNode, -1, false, 0);
+		
+		FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to update CNode", false);
+		
+		newValue = offsetToCopiedCNode;
+		
+	} while ( !CAS_size_t( &oldValue, NEXT_MAIN_NODE(oldValue, newValue), &(root->mainNode) ) );
+	
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+	dumpWastedMemory(MAIN_NODE(oldValue), 0);
+#endif
+	
+	//Reclaimed later, like the paths inside a prefix
+	for (index = 0 ; index < POSSIBLE_CHARACTERS ; ++index)
+	{
+		detachedINode = tempCNode.possibilities[index];
+		
+		if (index == NAMESPACE_SEPARATOR - LOWER_LIMIT || detachedINode == 0 || queueDetachedSubtree(detachedINode))
+			continue;
+		
+		tombSubtree(detachedINode);
+		
+#if SHARED_MEMORY_CAP
+		freeINode(detachedINode);
+#endif
+	}
+	
+	return true;
+}
+
+
+
+bool compressTombedChild(size_t parentINode, uint8_t index, size_t tombedINode, bool *isParentTombed)
+{
+	
+	size_t oldValue, newValue = 0;
+	size_t childINode;
+	
+	INode *currentINode;
+	CNode *currentCNode;
+	CNode *copiedCNode = NULL;
+	CNode tempCNode;
+	
+	size_t offsetToCopiedCNode = 0;
+	
+	bool result;
+	
+	*isParentTombed = false;
+	
+	currentINode = GOTO_OFFSET(parentINode);
+	FAIL_IF(!currentINode, ERROR_BAD_OFFSET, "currentINode found NULL", false);
+	
+	do
+	{
+		
+		oldValue = currentINode->mainNode;
+		
+		GUARD_CNODE_ACCESS
+		(
+		childINode = currentCNode->possibilities[index];
+		)
+		
+		//Either some other thread has already done it or the parent itself
+		//has been tombed (tomb CNode has no entries), in which case that thread takes care of it.
+		//A tombed INode is never linked again, so the entry can't come back.
+		if (childINode != tombedINode)
+			break;
+		
+#if SHARED_MEMORY_CAP
+		//It was taken out and recycled for a path that took its place meanwhile
+		if (MAIN_NODE(((INode *)GOTO_OFFSET(tombedINode))->mainNode) != TOMB_CNODE_OFFSET)
+		{
+			childINode = 0;
+			break;
+		}
+#endif
+		
+		//Need not be inside GUARD_CNODE_ACCESS because if the CNode changes,
+		//CAS will fail anyway
+		tempCNode = *currentCNode;
+		tempCNode.possibilities[index] = 0;
+		
+		if (parentINode != 0 && isCNodeEmpty(&tempCNode))
+		{
+			newValue = TOMB_CNODE_OFFSET;
+		}
+		else
+		{
+			//Space for the copy is only taken when it is needed,
+			//as mostly whole chains of nodes get tombed one after another.
+			if (copiedCNode == NULL)
+			{
+				result = getSpaceForCNode(&offsetToCopiedCNode, parentINode);
+				
+				FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to get space for CNode", false);
+				
+				copiedCNode = GOTO_OFFSET(offsetToCopiedCNode);
+				
+				FAIL_IF(!copiedCNode, ERROR_BAD_OFFSET, "copiedCNode found NULL", false);
+			}
+			
+			//Taken before __dtsharedmemory_compact() switched the root to the copy,
+			//the insertion or removal is made again in the copy
+			if (isRetired(offsetToCopiedCNode))
+				return true;
+			
+			result = createUpdatedCNodeCopy(copiedCNode, tempCNode, -1, tempCNode.isEndOfString, tempCNode.flags);
+			
+			FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to update CNode", false);
+			
+			//The copy keeps the second chance of the node, see evictColdPaths()
+			newValue = offsetToCopiedCNode | (oldValue & REFERENCED_MAIN_NODE);
+		}
+		
+	} while ( !CAS_size_t( &oldValue, NEXT_MAIN_NODE(oldValue, newValue), &(currentINode->mainNode) ) );
+	
+	
+	if (childINode != tombedINode)
+	{
+		//Nothing was CAS'd, so the copy was never made visible to anyone
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+		if (copiedCNode != NULL)
+			freeCNode(offsetToCopiedCNode, parentINode);
+#endif
+		return true;
+	}
+	
+#if SHARED_MEMORY_CAP
+	freeINode(tombedINode);
+#endif
+	
+	if (newValue == TOMB_CNODE_OFFSET)
+	{
+		*isParentTombed = true;
+		
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+		if (copiedCNode != NULL)
+			freeCNode(offsetToCopiedCNode, parentINode);
+		
+		freeCNode(MAIN_NODE(oldValue), parentINode);
+#endif
+	}
+	else
+	{
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+		dumpWastedMemory(MAIN_NODE(oldValue), parentINode);
+#endif
+	}
+	
+	return true;
+}
+
+
+
+bool removeTombedINode(const struct RemovalTrail *trail, size_t depth, size_t tombedINode)
+{
+	
+	bool result;
+	bool isParentTombed;
+	
+	while (depth > 0)
+	{
+		--depth;
+		
+		result = compressTombedChild(trail[depth].iNode, trail[depth].index, tombedINode, &isParentTombed);
+		
+		FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to remove tombed INode", false);
+		
+		if (!isParentTombed)
+			break;
+		
+		tombedINode = trail[depth].iNode;
+	}
+	
+	return true;
+}
+
+
+
+size_t tombSubtree(size_t offsetToINode)
+{
+	
+	size_t oldValue, numberOfINodes;
+	int index;
+	
+	INode *currentINode;
+	CNode *currentCNode;
+	
+	currentINode = GOTO_OFFSET(offsetToINode);
+	
+	if (!currentINode)
+		return 0;
+	
+	do
+	{
+		oldValue = currentINode->mainNode;
+		
+		if (MAIN_NODE(oldValue) == TOMB_CNODE_OFFSET)
+			return 0;
+		
+	} while ( !CAS_size_t( &oldValue, NEXT_MAIN_NODE(oldValue, TOMB_CNODE_OFFSET), &(currentINode->mainNode) ) );
+	
+	//The old CNode can't be changed or freed by anyone else now
+	currentCNode = GOTO_OFFSET(MAIN_NODE(oldValue));
+	
+	if (!currentCNode)
+		return 1;
+	
+	numberOfINodes = 1;
+	
+	for (index = 0 ; index < POSSIBLE_CHARACTERS ; ++index)
+	{
+		if (currentCNode->possibilities[index] == 0)
+			continue;
+		
+		numberOfINodes += tombSubtree(currentCNode->possibilities[index]);
+		
+#if SHARED_MEMORY_CAP
+		//Only reachable through the tombed CNode, nobody else takes it out
+		freeINode(currentCNode->possibilities[index]);
+#endif
+	}
+	
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+	freeCNode(MAIN_NODE(oldValue), offsetToINode);
+#endif
+	
+	return numberOfINodes;
+	
+}
+
+
+
+bool queueDetachedSubtree(size_t offsetToINode)
+{
+	
+	size_t oldValue;
+	int index;
+	
+	addToDetachedSubtreeCount(1);
+	
+	for (index = 0 ; index < DETACHED_SUBTREE_SLOTS ; ++index)
+	{
+		oldValue = 0;
+		
+		if (CAS_size_t( &oldValue, offsetToINode, &(manager->status->detachedSubtrees[index]) ))
+			return true;
+	}
+	
+	addToDetachedSubtreeCount((size_t)-1);
+	
+	return false;
+	
+}
+
+
+
+bool takeDetachedSubtree(size_t *offsetToINode)
+{
+	
+	size_t oldValue;
+	int index;
+	
+	if (manager->status->detachedSubtreeCount == 0)
+		return false;
+	
+	for (index = 0 ; index < DETACHED_SUBTREE_SLOTS ; ++index)
+	{
+		oldValue = manager->status->detachedSubtrees[index];
+		
+		if (oldValue != 0 && CAS_size_t( &oldValue, 0, &(manager->status->detachedSubtrees[index]) ))
+		{
+			addToDetachedSubtreeCount((size_t)-1);
+			
+			*offsetToINode = oldValue;
+			
+			return true;
+		}
+	}
+	
+	return false;
+	
+}
+
+
+
+size_t reclaimDetachedSubtrees(size_t budget)
+{
+	
+	size_t offsetToINode, numberOfINodes = 0;
+	
+	while (numberOfINodes < budget && takeDetachedSubtree(&offsetToINode))
+	{
+		if (isRetired(offsetToINode))
+			continue;
+		
+		numberOfINodes += tombDetachedINode(offsetToINode);
+		
+#if SHARED_MEMORY_CAP
+		freeINode(offsetToINode);
+#endif
+	}
+	
+	return numberOfINodes;
+	
+}
+
+
+
+size_t tombDetachedINode(size_t offsetToINode)
+{
+	
+	size_t oldValue, offsetToChild, numberOfINodes;
+	int index;
+	
+	INode *currentINode;
+	CNode *currentCNode;
+	
+	currentINode = GOTO_OFFSET(offsetToINode);
+	
+	if (!currentINode)
+		return 0;
+	
+	do
+	{
+		oldValue = currentINode->mainNode;
+		
+		if (MAIN_NODE(oldValue) == TOMB_CNODE_OFFSET)
+			return 0;
+		
+	} while ( !CAS_size_t( &oldValue, NEXT_MAIN_NODE(oldValue, TOMB_CNODE_OFFSET), &(currentINode->mainNode) ) );
+	
+	//The old CNode can't be changed or freed by anyone else now
+	currentCNode = GOTO_OFFSET(MAIN_NODE(oldValue));
+	
+	if (!currentCNode)
+		return 1;
+	
+	numberOfINodes = 1;
+	
+	for (index = 0 ; index < POSSIBLE_CHARACTERS ; ++index)
+	{
+		offsetToChild = currentCNode->possibilities[index];
+		
+		if (offsetToChild == 0 || queueDetachedSubtree(offsetToChild))
+			continue;
+		
+		numberOfINodes += tombSubtree(offsetToChild);
+		
+#if SHARED_MEMORY_CAP
+		freeINode(offsetToChild);
+#endif
+	}
+	
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+	freeCNode(MAIN_NODE(oldValue), offsetToINode);
+#endif
+	
+	return numberOfINodes;
+	
+}
+
+
+
+#if COMPACTION_AVAILABLE
+
+bool lockCompaction()
+{
+	
+	size_t oldValue, newValue;
+	size_t compactions;
+	
+	oldValue = manager->status->compactingProcess;
+	newValue = (size_t)getpid();
+	
+	if (oldValue != 0 && (oldValue == newValue || kill((pid_t)oldValue, 0) == 0 || errno != ESRCH))
+		return false;
+	
+	if (!CAS_size_t( &oldValue, newValue, &(manager->status->compactingProcess) ))
+		return false;
+	
+	compactions = manager->status->compactions;
+	
+	//Its process died while copying. The root may or may not have been switched
+	//to the copy, so the old region is never handed out, the next compaction retires it again.
+	if (compactions % 2 == 1)
+	{
+		manager->status->retiredEnd  = 0;
+		manager->status->compactions = compactions + 1;
+	}
+	
+	return true;
+	
+}
+
+
+
+bool compactCtrie()
+{
+	
+	size_t compactions, numberOfNodes, nodesCopied;
+	size_t toSpace, oldRootCNode, newRootCNode, retiredEnd;
+	INode *root;
+	bool result, isHoleUsed;
+	
+	root = GOTO_OFFSET(0);
+	FAIL_IF(!root, ERROR_BAD_OFFSET, "root found NULL", false);
+	
+	//Not an error, reusing what this copy retires would not wait for them
+	if (hasEarlierReaders())
+		return false;
+	
+	compactions = manager->status->compactions;
+	
+	manager->status->compactions = compactions + 1;
+	
+	numberOfNodes  = countLiveINodes(0, 0);
+	numberOfNodes += numberOfNodes / 8 + COMPACTION_SLACK;
+	
+	isHoleUsed = (manager->status->holeEnd - manager->status->holeStart >= numberOfNodes * COMPACTED_NODE_SIZE);
+	
+	if (isHoleUsed)
+	{
+		toSpace = manager->status->holeStart;
+	}
+	else if (!reserveSpaceInSharedMemory(numberOfNodes * COMPACTED_NODE_SIZE, &toSpace))
+	{
+		manager->status->compactions = compactions + 2;
+		FAIL_IF(true, ERROR_CALL_FAILED, "Failed to reserve space for the copy", false);
+	}
+	
+	result = copyCtrie(toSpace, numberOfNodes, &oldRootCNode, &nodesCopied);
+	
+	//Everything reserved before it gets retired. Its end is taken by a reservation rather
+	//than read, so that releaseReservedSpace() can't give back any of it afterwards.
+	if (result && reserveSpaceInSharedMemory(CNODE_BLOCK_SIZE, &retiredEnd))
+	{
+		//Retired before the switch, as insertions and removals may still be going on.
+		//`retiredEnd` goes last, see isRetired().
+		manager->status->copyStart    = toSpace;
+		manager->status->copyEnd      = toSpace + nodesCopied * COMPACTED_NODE_SIZE;
+		manager->status->retiredStart = FIRST_WRITE_OFFSET;
+		manager->status->retiredEnd   = retiredEnd;
+		
+		newRootCNode = toSpace + ALIGNED_SIZE(sizeof(INode));
+		
+		result = CAS_size_t( &oldRootCNode, newRootCNode, &(root->mainNode) );
+		
+		if (!result)
+			manager->status->retiredEnd = 0;
+		
+		freeCNode(retiredEnd, 0);
+	}
+	else
+	{
+		result = false;
+	}
+	
+	//Whatever is left of the hole, or of the space reserved for the copy, is retired too
+	if (result)
+	{
+		manager->status->holeEnd = manager->status->holeStart = 0;
+	}
+	else if (!isHoleUsed)
+	{
+		freeUnusedSpace(toSpace, numberOfNodes * COMPACTED_NODE_SIZE);
+	}
+	
+	manager->status->compactions = compactions + 2;
+	
+	return result;
+	
+}
+
+
+
+size_t countLiveINodes(size_t offsetToINode, size_t depth)
+{
+	
+	size_t numberOfINodes = 1;
+	int index;
+	
+	INode *currentINode;
+	CNode *currentCNode;
+	
+	//Deeper than any path can be, the ctrie changed while being walked
+	if (depth > NAMESPACE_SIZE + PATH_MAX)
+		return 0;
+	
+	currentINode = GOTO_OFFSET(offsetToINode);
+	
+	if (!currentINode)
+		return 0;
+	
+	currentCNode = GOTO_OFFSET(MAIN_NODE(currentINode->mainNode));
+	
+	if (!currentCNode)
+		return 1;
+	
+	for (index = 0 ; index < POSSIBLE_CHARACTERS ; ++index)
+	{
+		if (currentCNode->possibilities[index] != 0)
+			numberOfINodes += countLiveINodes(currentCNode->possibilities[index], depth + 1);
+	}
+	
+	return numberOfINodes;
+	
+}
+
+
+
+bool copyCtrie(size_t toSpace, size_t numberOfNodes, size_t *oldRootCNode, size_t *nodesCopied)
+{
+	
+	size_t scanned, copied, offsetToNode;
+	int index;
+	
+	INode *currentINode;
+	CNode *currentCNode;
+	INode *copiedINode;
+	CNode *copiedCNode;
+	CNode *scannedCNode;
+	
+	//Maps the whole region at once, rather than every EXPANDING_SIZE bytes while copying
+	copiedINode = GOTO_OFFSET(toSpace + (numberOfNodes - 1) * COMPACTED_NODE_SIZE);
+	FAIL_IF(!copiedINode, ERROR_BAD_OFFSET, "copiedINode found NULL", false);
+	
+	currentINode = GOTO_OFFSET(0);
+	FAIL_IF(!currentINode, ERROR_BAD_OFFSET, "currentINode found NULL", false);
+	
+	copiedCNode = GOTO_OFFSET(toSpace + ALIGNED_SIZE(sizeof(INode)));
+	FAIL_IF(!copiedCNode, ERROR_BAD_OFFSET, "copiedCNode found NULL", false);
+	
+	//Same as GUARD_CNODE_ACCESS, keeping the offset for the CAS of the root
+	do
+	{
+		*oldRootCNode = currentINode->mainNode;
+		currentCNode  = GOTO_OFFSET(MAIN_NODE(*oldRootCNode));
+		FAIL_IF(!currentCNode, ERROR_BAD_OFFSET, "currentCNode found NULL", false);
+		*copiedCNode  = *currentCNode;
+		
+	} while (*oldRootCNode != currentINode->mainNode);
+	
+	for (scanned = 0, copied = 1 ; scanned < copied ; ++scanned)
+	{
+		
+		//Nobody else can see the copy yet
+		scannedCNode = GOTO_OFFSET(toSpace + scanned * COMPACTED_NODE_SIZE + ALIGNED_SIZE(sizeof(INode)));
+		FAIL_IF(!scannedCNode, ERROR_BAD_OFFSET, "scannedCNode found NULL", false);
+		
+		for (index = 0 ; index < POSSIBLE_CHARACTERS ; ++index)
+		{
+			
+			if (scannedCNode->possibilities[index] == 0)
+				continue;
+			
+			//Not an error, insertions which had started before added more than expected
+			if (copied == numberOfNodes)
+				return false;
+			
+			offsetToNode = toSpace + copied * COMPACTED_NODE_SIZE;
+			
+			copiedINode = GOTO_OFFSET(offsetToNode);
+			FAIL_IF(!copiedINode, ERROR_BAD_OFFSET, "copiedINode found NULL", false);
+			
+			copiedCNode = GOTO_OFFSET(offsetToNode + ALIGNED_SIZE(sizeof(INode)));
+			FAIL_IF(!copiedCNode, ERROR_BAD_OFFSET, "copiedCNode found NULL", false);
+			
+			currentINode = GOTO_OFFSET(scannedCNode->possibilities[index]);
+			FAIL_IF(!currentINode, ERROR_BAD_OFFSET, "currentINode found NULL", false);
+			
+			GUARD_CNODE_ACCESS
+			(
+			*copiedCNode = *currentCNode;
+			)
+			
+			//Tombed (the tomb CNode is empty) or left with nothing by a removal
+			if (isCNodeEmpty(copiedCNode))
+			{
+				scannedCNode->possibilities[index] = 0;
+				continue;
+			}
+			
+			copiedINode->mainNode = offsetToNode + ALIGNED_SIZE(sizeof(INode));
+			
+			scannedCNode->possibilities[index] = offsetToNode;
+			
+			++copied;
+		}
+	}
+	
+	*nodesCopied = copied;
+	
+	return true;
+	
+}
+
+
+
+bool reuseRetiredRegion()
+{
+	
+	size_t offsetToCNode, offsetToINode, keptCNodes = 0;
+	size_t lowerStart, lowerEnd, upperStart, upperEnd;
+	size_t *keptCNode;
+	int i;
+	
+	//Not an error, operations which started before the copy may still be reading the region
+	if (hasEarlierReaders())
+		return false;
+	
+	//popFreedCNode() drops the freed CNodes in the region, the rest are put back
+	while (popFreedCNode(&(manager->status->freedCNodes), &offsetToCNode, 0))
+	{
+		keptCNode = GOTO_OFFSET(offsetToCNode);
+		
+		if (!keptCNode)
+			break;
+		
+		*keptCNode = keptCNodes;
+		keptCNodes = offsetToCNode;
+	}
+	
+	while (keptCNodes != 0)
+	{
+		offsetToCNode = keptCNodes;
+		keptCNode     = GOTO_OFFSET(offsetToCNode);
+		
+		if (!keptCNode)
+			break;
+		
+		keptCNodes = *keptCNode;
+		
+		pushFreedCNode(offsetToCNode, *(keptCNode + 1));
+	}
+	
+	//recycleWastedMemory() drops the dumped CNodes in the region. The rest are lost too,
+	//as the INodes which dumped them aren't known (no INode is at SIZE_MAX).
+	for (i = 0 ; (size_t)i < options.dumpYardSize ; ++i)
+	{
+		recycleWastedMemory(&offsetToCNode, SIZE_MAX);
+	}
+	
+#if HOT_LEVELS
+	//Nothing in the hot region was copied, it is all handed out again from its start
+	while (popFreedCNode(&(manager->status->freedHotCNodes), &offsetToCNode, 0))
+		;
+	
+	manager->status->hotRegionUsed = 0;
+#endif
+	
+	//Subtrees detached before the copy are in the region too
+	for (i = 0 ; i < DETACHED_SUBTREE_SLOTS ; ++i)
+	{
+		offsetToINode = manager->status->detachedSubtrees[i];
+		
+		if (offsetToINode != 0 && isRetired(offsetToINode) &&
+			CAS_size_t( &offsetToINode, 0, &(manager->status->detachedSubtrees[i]) ))
+			addToDetachedSubtreeCount((size_t)-1);
+	}
+	
+	//The copy is always inside the region, which ends at a reservation made after the copy
+	lowerStart = manager->status->retiredStart;
+	lowerEnd   = manager->status->copyStart;
+	upperStart = manager->status->copyEnd;
+	upperEnd   = manager->status->retiredEnd;
+	
+	if (lowerEnd - lowerStart >= upperEnd - upperStart)
+	{
+		manager->status->holeStart = lowerStart;
+		manager->status->holeEnd   = lowerEnd;
+		
+		manager->status->retiredEnd = 0;
+		
+		freeUnusedSpace(upperStart, upperEnd - upperStart);
+	}
+	else
+	{
+		manager->status->holeStart = upperStart;
+		manager->status->holeEnd   = upperEnd;
+		
+		manager->status->retiredEnd = 0;
+		
+		freeUnusedSpace(lowerStart, lowerEnd - lowerStart);
+	}
+	
+	return true;
+	
+}
+
+
+
+bool hasEarlierReaders()
+{
+	
+	size_t slot, pid, parity;
+	
+	//`compactions` is even, this process is the one compacting
+	parity = (manager->status->compactions / 2 + 1) % 2;
+	
+	for (slot = 0 ; slot < READER_SLOTS ; ++slot)
+	{
+		if (manager->status->readers[slot][READER_ACTIVE + parity] == 0)
+			continue;
+		
+		pid = manager->status->readers[slot][READER_PID];
+		
+		//Its process died in the middle of an operation
+		if (slot != READER_SLOTS - 1 && pid != 0 && kill((pid_t)pid, 0) == -1 && errno == ESRCH)
+			continue;
+		
+		return true;
+	}
+	
+	return false;
+	
+}
+
+#endif
+
+
+
+#if SHARED_MEMORY_CAP
+
+bool evictColdPaths()
+{
+	
+	FAIL_IF(manager == NULL, ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	
+	struct EvictionSweep *sweep;
+	size_t oldValue, newValue;
+	int wait;
+	bool isEndReached, isWholeCtrieSwept;
+	
+	//Removing an evicted path needed a CNode
+	if (isEvicting)
+		return false;
+	
+	oldValue = manager->status->evictingProcess;
+	newValue = (size_t)getpid();
+	
+	//Some other thread is evicting, unless its process has died.
+	//Wait for it a little, as it frees memory for everyone.
+	if (oldValue != 0 && (oldValue == newValue || kill((pid_t)oldValue, 0) == 0 || errno != ESRCH))
+	{
+		for (wait = 0 ; wait < EVICTION_WAIT_LIMIT && manager->status->evictingProcess != 0 ; ++wait)
+		{
+			usleep(EVICTION_WAIT_INTERVAL);
+		}
+		
+		return true;
+	}
+	
+	//Some other thread has just started
+	if (!CAS_size_t( &oldValue, newValue, &(manager->status->evictingProcess) ))
+		return true;
+	
+	//Too big for the stack of every thread
+	sweep = (struct EvictionSweep *)malloc(sizeof(struct EvictionSweep));
+	
+	if (sweep == NULL)
+	{
+		manager->status->evictingProcess = 0;
+		FAIL_IF(true, ERROR_SYSTEM_CALL, "malloc(2) failed", false);
+	}
+	
+	isEvicting = true;
+	
+	sweep->nodesEvicted = 0;
+	sweep->nodesSpared  = 0;
+	
+	memcpy(sweep->hand, manager->status->clockHand, CLOCK_HAND_SIZE);
+	sweep->hand[CLOCK_HAND_SIZE - 1] = '\0';
+	
+	sweep->isHandPassed = (sweep->hand[0] == '\0');
+	
+	//Never wraps around within one call, the bits it just cleared
+	//need searches to happen before they are looked at again.
+	isEndReached = sweepForEviction(0, 0, sweep);
+	
+	if (isEndReached)
+	{
+		//The next call starts from the beginning
+		manager->status->clockHand[0] = '\0';
+	}
+	
+	isEvicting = false;
+	
+	manager->status->evictingProcess = 0;
+	
+	newValue = sweep->nodesEvicted + sweep->nodesSpared;
+	
+	//Unless this call went over the whole ctrie, the beginning was cleared
+	//by an earlier call, so trying again right away is fine
+	isWholeCtrieSwept = isEndReached && sweep->hand[0] == '\0';
+	
+	free(sweep);
+	
+	return newValue > 0 || !isWholeCtrieSwept;
+	
+}
+
+
+
+bool sweepForEviction(size_t offsetToINode, size_t depth, struct EvictionSweep *sweep)
+{
+	
+	INode *currentINode;
+	CNode *currentCNode;
+	
+	size_t childINode, mainNode;
+	int index, nextIndex, firstIndex;
+	
+	bool result;
+	
+	currentINode = GOTO_OFFSET(offsetToINode);
+	
+	FAIL_IF(!currentINode, ERROR_BAD_OFFSET, "currentINode found NULL", false);
+	
+	firstIndex = 0;
+	
+	if (!sweep->isHandPassed)
+	{
+		//The hand itself, it was evicted when the last sweep stopped
+		if (sweep->hand[depth] == '\0')
+		{
+			sweep->isHandPassed = true;
+			return true;
+		}
+		
+		//Nodes on the way to the hand were swept last time
+		firstIndex = (uint8_t)sweep->hand[depth] - LOWER_LIMIT;
+		
+		//Not a path written by us, just start from here
+		if (firstIndex < 0 || firstIndex >= POSSIBLE_CHARACTERS)
+		{
+			sweep->isHandPassed = true;
+			firstIndex = 0;
+		}
+	}
+	else if (depth > 0)
+	{
+		mainNode = currentINode->mainNode;
+		
+		if (!(mainNode & REFERENCED_MAIN_NODE))
+		{
+			sweep->nodesEvicted += tombSubtree(offsetToINode);
+			
+			result = removeTombedINode(sweep->trail, depth, offsetToINode);
+			
+			FAIL_IF(!result, ERROR_OUT_OF_MEMORY, "Failed to evict", false);
+			
+			if (sweep->nodesEvicted < EVICTION_BATCH_SIZE)
+				return true;
+			
+			//Next eviction continues after this subtree
+			memcpy(manager->status->clockHand, sweep->path, depth);
+			manager->status->clockHand[depth] = '\0';
+			
+			return false;
+		}
+		
+		//Second chance, the nodes below get their own.
+		//If the CAS fails, the INode has just been written, which counts as a reference too.
+		CAS_size_t( &mainNode, mainNode & ~REFERENCED_MAIN_NODE, &(currentINode->mainNode) );
+		
+		++sweep->nodesSpared;
+	}
+	
+	for (index = firstIndex ; index < POSSIBLE_CHARACTERS && depth + 1 < CLOCK_HAND_SIZE ; ++index)
+	{
+		
+		//Skip to the next entry
+		GUARD_CNODE_ACCESS
+		(
+		for (nextIndex = index ; nextIndex < POSSIBLE_CHARACTERS && currentCNode->possibilities[nextIndex] == 0 ; ++nextIndex);
+		childINode = (nextIndex < POSSIBLE_CHARACTERS ? currentCNode->possibilities[nextIndex] : 0);
+		)
+		
+		if (childINode == 0)
+			break;
+		
+		index = nextIndex;
+		
+		//Only the entry for the character of the hand leads further along the hand
+		if (index != firstIndex)
+			sweep->isHandPassed = true;
+		
+		sweep->path[depth]        = index + LOWER_LIMIT;
+		sweep->trail[depth].iNode = offsetToINode;
+		sweep->trail[depth].index = index;
+		
+		if (!sweepForEviction(childINode, depth + 1, sweep))
+			return false;
+		
+		sweep->isHandPassed = true;
+	}
+	
+	//Whatever comes next is after the hand, even if the hand doesn't exist anymore
+	sweep->isHandPassed = true;
+	
+	return true;
+	
+}
+
+#endif
+
+
+
+bool reserveSpaceInSharedMemory(size_t bytesToBeReserverd, size_t *reservedOffset)
+{
+	
+	FAIL_IF(manager == NULL, ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	
+	size_t oldValue, newValue;
+	
+	do
+	{
+		oldValue = manager->status->writeFromOffset;
+		
+		//PADDING_BYTES are added so that recycled offsets can use an odd offset
+		//by adding 1. PADDING_BYTES create extra space so 1 can be added to recycled offsets.
+		newValue = oldValue + ALIGNED_SIZE(bytesToBeReserverd + PADDING_BYTES);
+		
+#if !(LARGE_MEMORY_NEEDED)
+		FAIL_IF(newValue >= UINT32_MAX, ERROR_OUT_OF_MEMORY, "Set LARGE_MEMORY_NEEDED to 1 in dtsharedmemory.h to use more memory", false);
+#endif
+		
+		FAIL_IF(newValue <= oldValue, ERROR_OUT_OF_MEMORY, "Memory limit reached", false);
+		
+#if SHARED_MEMORY_CAP
+		//Not an error, the caller evicts paths to make space (see evictColdPaths())
+		if (newValue > SHARED_MEMORY_CAP && !isEvicting)
+			return false;
+#endif
+		
+	} while ( !CAS_size_t( &oldValue, newValue, &(manager->status->writeFromOffset) ) );
+	
+#if RESERVED_MAPPING_GB
+	//Nothing can point into the reserved space yet, so growing the file here means
+	//no thread ever reads beyond the end of the file (and gets SIGBUS)
+	if (newValue + sizeof(CNode) + sizeof(INode) > manager->status->sharedMemoryFileSize &&
+		!expandSharedMemory(newValue + sizeof(CNode) + sizeof(INode)))
+	{
+		//Not released through releaseReservedSpace() as it clears the space, which isn't in the file
+		CAS_size_t( &newValue, oldValue, &(manager->status->writeFromOffset) );
+		return false;
+	}
+#endif
+	
+	*reservedOffset = oldValue;
+	
+	return true;
+	
+}
+
+
+
+#if HOT_LEVELS
+
+bool reserveSpaceInHotRegion(size_t bytesToBeReserverd, size_t *reservedOffset)
+{
+	
+	FAIL_IF(manager == NULL, ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	
+	size_t oldValue, newValue;
+	
+	do
+	{
+		oldValue = manager->status->hotRegionUsed;
+		//PADDING_BYTES as in reserveSpaceInSharedMemory(), so that the CNode can be recycled once
+		newValue = oldValue + ALIGNED_SIZE(bytesToBeReserverd + PADDING_BYTES);
+		
+		//Not an error, the caller takes space from the rest of the file instead.
+		//Once retired, the region is only handed out again from its start by reuseRetiredRegion().
+		if (newValue > HOT_REGION_SIZE || isRetired(HOT_REGION_OFFSET))
+			return false;
+		
+	} while ( !CAS_size_t( &oldValue, newValue, &(manager->status->hotRegionUsed) ) );
+	
+	*reservedOffset = HOT_REGION_OFFSET + oldValue;
+	
+	return true;
+	
+}
+
+#endif
+
+
+
+bool growSharedMemoryFile(size_t offset)
+{
+	
+	FAIL_IF(manager == NULL, ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	
+	size_t oldValue, newValue, newSize, step, fileSize, limit;
+	int wait = 0;
+	
+#if RESERVED_MAPPING_GB
+	limit = RESERVED_MAPPING_SIZE;
+#elif SHARED_MEMORY_CAP
+	//No need to go much beyond what can be used under the cap
+	limit = SHARED_MEMORY_CAP + sizeof(CNode) + sizeof(INode);
+	limit = limit < offset ? offset : limit;
+#else
+	limit = options.maxFileSize;
+#endif
+	
+	FAIL_IF(offset > options.maxFileSize, ERROR_OUT_OF_MEMORY, "Shared memory file can't grow beyond maxFileSize", false);
+	
+	limit = limit > options.maxFileSize ? options.maxFileSize : limit;
+	
+	/**
+	 *	Only one thread grows the file at a time, as truncating it to a size which some other
+	 *	thread has already grown the file beyond would shrink it under the nodes written there.
+	 *	The others wait for it and then only map what it has grown the file to.
+	 *	`growingProcess` is taken over if its process has died.
+	 **/
+	while (manager->status->sharedMemoryFileSize < offset)
+	{
+		
+#if DISABLE_MEMORY_EXPANSION
+		FAIL_IF(true, ERROR_OUT_OF_MEMORY, "Memory expansion is disabled", false);
+#endif
+		
+		oldValue = manager->status->growingProcess;
+		newValue = (size_t)getpid();
+		
+		if (oldValue != 0 && (kill((pid_t)oldValue, 0) == 0 || errno != ESRCH))
+		{
+			FAIL_IF(++wait > GROWTH_WAIT_LIMIT, ERROR_OUT_OF_MEMORY, "Shared memory file is being grown for too long", false);
+			
+			usleep(GROWTH_WAIT_INTERVAL);
+			continue;
+		}
+		
+		if (!CAS_size_t( &oldValue, newValue, &(manager->status->growingProcess) ))
+			continue;
+		
+		newSize = manager->status->sharedMemoryFileSize;
+		
+		if (newSize < offset)
+		{
+			//Grows geometrically, and at least up to `offset`, as a single reservation,
+			//e.g., by __dtsharedmemory_compact(), can be bigger than the step
+			step     = newSize / 100 * options.growthPercent;
+			newSize += step > options.expandingSize ? step : options.expandingSize;
+			newSize  = newSize < offset ? offset : newSize;
+			newSize  = newSize > limit ? limit : newSize;
+			
+			fileSize = getFileSizeForFd(manager->sharedMemoryFile_fd);
+			
+			//A grower which died before updating `sharedMemoryFileSize` may have grown it already.
+			//ftruncate(2) on the descriptor mmap(2) uses, so that it is the mapped file which grows.
+			if (fileSize == (size_t)-1 ||
+				(fileSize < HEADER_SIZE + newSize &&
+				 ftruncate(manager->sharedMemoryFile_fd, HEADER_SIZE + newSize) == -1))
+			{
+				manager->status->growingProcess = 0;
+				FAIL_IF(true, ERROR_SYSTEM_CALL, "Shared memory file couldn't be grown", false);
+			}
+			
+			manager->status->sharedMemoryFileSize = newSize;
+			
+			countStat(STAT_EXPANSIONS);
+		}
+		
+		manager->status->growingProcess = 0;
 	}
-	else if(statusFile.fd == -1 && (access(statusFile.name, F_OK) == -1))
-	//File doesn't exist
+	
+	return true;
+	
+}
+
+
+
+bool expandSharedMemory(size_t offset)
+{
+	
+	FAIL_IF(manager == NULL, ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	
+#if !(RESERVED_MAPPING_GB)
+	size_t newSize, slot;
+	struct SharedMemoryMapping *old_mapping, *new_mapping;
+	
+	old_mapping = currentMapping;
+#endif
+	
+	PROBE2(expand__entry, offset, currentMapping->size);
+	
+#if RESERVED_MAPPING_GB
+	
+	FAIL_IF(offset > RESERVED_MAPPING_SIZE, ERROR_OUT_OF_MEMORY, "Set RESERVED_MAPPING_GB bigger to use more memory", false);
+	
+	//Already mapped, only the file needs to be grown, unless some other thread did it
+	if (!growSharedMemoryFile(offset))
+		return false;
+	
+	PROBE2(expand__return, offset, (size_t)manager->status->sharedMemoryFileSize);
+	
+	return true;
+	
+#else
+	
+	//Some other thread already expanded memory, or this thread only had an old mapping
+	if(old_mapping->size >= offset)
 	{
-		//Create file
-		//Doesn't overwrite existing file because O_EXCL is added in flags.
-		statusFile.fd = open(statusFile.name, O_CREAT | O_EXCL | O_TRUNC | O_RDWR, FILE_PERMISSIONS);
+		mapping = *old_mapping;
+		
+		PROBE2(expand__return, offset, mapping.size);
+		return true;
+	}
+	
+	if (!growSharedMemoryFile(offset))
+		return false;
+	
+	//Maps all the file has been grown to, which may be well beyond `offset`
+	newSize = manager->status->sharedMemoryFileSize;
+	
+	
+	//Take an unused element of `mappings` for the new mapping
+	do
+	{
+		slot = mappingsUsed;
+		
+		FAIL_IF(slot >= MAX_MAPPINGS, ERROR_OUT_OF_MEMORY, "All MAX_MAPPINGS are used", false);
 		
-		if(statusFile.fd == -1)
+	} while ( !CAS_size_t( &slot, slot + 1, &mappingsUsed ) );
+	
+	new_mapping = &mappings[slot];
+	
+	new_mapping->base = mmap(NULL, HEADER_SIZE + newSize, PROT_READ | PROT_WRITE, MAP_SHARED, manager->sharedMemoryFile_fd, 0 );
+	FAIL_IF(new_mapping->base == MAP_FAILED, ERROR_SYSTEM_CALL, "mmap(2) failed", false);
+	adviseMapping(new_mapping->base, HEADER_SIZE + newSize, HEADER_SIZE + newSize);
+	new_mapping->base += HEADER_SIZE;
+	new_mapping->size  = newSize;
+	
+	
+	//Replace `currentMapping`
+	do
+	{
+		
+		old_mapping = currentMapping;
+		
+		if(old_mapping->size >= new_mapping->size)
 		{
-			//Some other thread or process may have entered the code and created the file
-			//before this thread could. Assuming that, attempt to open the file again.
+			//Never published, so no other thread can be using it
+			munmap(new_mapping->base - HEADER_SIZE, new_mapping->size + HEADER_SIZE);
 			
-			statusFile.fd = open(statusFile.name, O_RDWR, FILE_PERMISSIONS);
-			FAIL_IF(statusFile.fd == -1, "open(2) failed", false);
+			mapping = *old_mapping;
+			
+			PROBE2(expand__return, offset, mapping.size);
+			return true;
 		}
+		
+	} while ( !CAS_ptr( &old_mapping, new_mapping, &(currentMapping) ) );
+	
+	mapping = *new_mapping;
+	
+	PROBE2(expand__return, offset, newSize);
+	
+	return true;
+	
+#endif
+	
+}
+
+
+
+bool createUpdatedCNodeCopy(CNode *copy, CNode cNodeToBeCopied, int index, bool updated_isEndOfString, uint8_t updated_flags)
+{
+	
+	FAIL_IF(manager == NULL, ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	
+	
+	//copying the complete old CNode
+	copy = memcpy(copy, &cNodeToBeCopied, sizeof(CNode));
+	
+	
+	//Only create a new entry if `index` is non negative.
+	if (index >= 0)
+	{
+		bool result;
+		size_t bytesToBeReserverd, writeFromOffset;
+		
+		//Making changes to the `copy` by adding new child
+		
+		bytesToBeReserverd = sizeof(INode) + sizeof(CNode);
+		
+		result = reserveSpaceInSharedMemory(bytesToBeReserverd, &writeFromOffset);
+		
+		FAIL_IF(!result, ERROR_CALL_FAILED, "Failed to create an updated copy of CNode", false);
+		
+		
+		//Creating child INode
+		
+		INode *baseAddressOfINode = GOTO_OFFSET(writeFromOffset);
+		FAIL_IF(!baseAddressOfINode, ERROR_BAD_OFFSET, "baseAddressOfINode found NULL", false);
+		//	The values of child CNode are to be set to 0. Because truncate(2) already
+		//	fills the file with '\0', this eliminates the need to do this ourselves.
+		baseAddressOfINode->mainNode = writeFromOffset + sizeof(INode);
+		
+		copy->possibilities[index] = writeFromOffset;
 	}
-	else if(statusFile.fd == -1)
+	
+	
+	copy->isEndOfString = updated_isEndOfString;
+	copy->flags         = updated_flags;
+	
+	return true;
+	
+}
+
+
+
+bool createPrivateTail(const char *suffix, size_t suffixLength, size_t depth, bool isEndOfString, uint8_t flags, const void *value, struct PrivateTail *tail)
+{
+	
+	size_t currentCharacter, tailNode, coldNodes;
+	size_t offsetToTailNode, offsetToCNode, offsetToNewCNode;
+	size_t reusedCNodes, numberOfReusedCNodes;
+	uint8_t pathCharacter;
+	int attempt;
+	bool result;
+	
+	INode *tailINode;
+	CNode *tailCNode;
+	
+	tail->numberOfNodes = 0;
+	
+	for (currentCharacter = 0 ; currentCharacter < suffixLength ; ++currentCharacter)
 	{
-		/*
-		 *Its is possible that file was created just before access(2) was called in
-		 *the above `if` condition so trying to open again
-		 */
-		statusFile.fd = open(statusFile.name, O_RDWR, FILE_PERMISSIONS);
-		FAIL_IF(statusFile.fd == -1, "open(2) failed", false);
+		pathCharacter = *(suffix + currentCharacter);
+		
+#ifndef STANDALONE_DTSM
+		//13 ascii is custom icon representer on macOS
+		if (pathCharacter == 13)
+			continue;
+#endif
+		
+		FAIL_IF(pathCharacter > (uint8_t)UPPER_LIMIT && !isKeySeparator(suffix + currentCharacter), ERROR_INVALID_CHARACTER, "Not accepting characters above UPPER_LIMIT", false);
+		FAIL_IF(pathCharacter < (uint8_t)LOWER_LIMIT, ERROR_INVALID_CHARACTER, "Not accepting characters below LOWER_LIMIT", false);
 		
+		++tail->numberOfNodes;
 	}
-	else
+	
+	FAIL_IF(tail->numberOfNodes == 0, ERROR_INTERNAL, "No characters for the tail", false);
+	
+#if HOT_LEVELS
+	tail->hotNodes = 0;
+	
+	if (depth < HOT_LEVELS)
 	{
-		print_error("Unknown error! File descriptor negative but not -1");
-		return false;
+		tail->hotNodes = (HOT_LEVELS - depth < tail->numberOfNodes) ? HOT_LEVELS - depth : tail->numberOfNodes;
+		
+		//Once the region is full, the whole tail is placed like any other
+		if (!reserveSpaceInHotRegion(HOT_TAIL_SIZE(tail->hotNodes), &(tail->hotOffset)))
+			tail->hotNodes = 0;
 	}
+#endif
+	
+	coldNodes = coldTailNodes(tail);
 	
 	
-	if (statusFile.fd >= 0)
+	//	Freed CNodes taken for this tail are kept in a list of their own, linked the same
+	//	way as in `freedCNodes` stack, until they are written.
+	reusedCNodes = 0;
+	numberOfReusedCNodes = 0;
+	
+#if SHARED_MEMORY_CAP
+	tail->iNodes = 0;
+#endif
+	
+	//Nothing is reserved if the whole tail is in the hot region
+	tail->offset        = 0;
+	tail->bytesReserved = 0;
+	
+	for (attempt = 0 ; coldNodes != 0 ; ++attempt)
 	{
 		
-		is_truncate_needed = ((stat_check = getFileSizeForFile(statusFile.name)) == 0) ? true : false;
+#if FREED_CNODES_STACK_AVAILABLE
+		while (numberOfReusedCNodes < coldNodes && reuseFreedCNode(&offsetToCNode, 0))
+		{
+			tailCNode = GOTO_OFFSET(offsetToCNode);
+			FAIL_IF(!tailCNode, ERROR_BAD_OFFSET, "tailCNode found NULL", false);
+			
+			*(size_t *)tailCNode = reusedCNodes;
+			reusedCNodes = offsetToCNode;
+			
+			++numberOfReusedCNodes;
+		}
+		
+#	if SHARED_MEMORY_CAP
+		if (numberOfReusedCNodes == coldNodes &&
+			takeRecycledINodes(coldNodes, &(tail->iNodes)))
+		{
+			tail->offset        = 0;
+			tail->bytesReserved = 0;
+			break;
+		}
+#	endif
+		
+		if (numberOfReusedCNodes == coldNodes &&
+			takeSpareINodes(coldNodes, &(tail->offset)))
+		{
+			tail->bytesReserved = 0;
+			break;
+		}
+#endif
+		
+		//Rounded so that the spare tail space made out of it stays aligned too
+		tail->bytesReserved = ALIGNED_SIZE(coldNodes * sizeof(INode) +
+		(coldNodes - numberOfReusedCNodes) * CNODE_BLOCK_SIZE);
 		
-		FAIL_IF(stat_check == (size_t)-1, "getFileSizeForFile() failed", false);
+		result = reserveSpaceForTail(tail->bytesReserved, &(tail->offset));
 		
-		if (is_truncate_needed)
+		if (result)
+			break;
+		
+#if SHARED_MEMORY_CAP
+		//SHARED_MEMORY_CAP has been reached, evict and try again with the freed CNodes.
+		//Other threads may take them first, so more than once.
+		if (attempt < EVICTION_ATTEMPTS && evictColdPaths())
+			continue;
+#endif
+		
+#if FREED_CNODES_STACK_AVAILABLE
+		//Give back the CNodes taken for nothing
+		while (reusedCNodes != 0)
+		{
+			offsetToCNode = reusedCNodes;
+			
+			tailCNode = GOTO_OFFSET(offsetToCNode);
+			FAIL_IF(!tailCNode, ERROR_BAD_OFFSET, "tailCNode found NULL", false);
+			
+			reusedCNodes = *(size_t *)tailCNode;
+			
+			freeCNode(offsetToCNode, 0);
+		}
+#endif
+		
+#if HOT_LEVELS
+		//The INodes are lost but the CNodes can still be used in the hot region
+		freeUnusedSpace(tail->hotOffset, HOT_TAIL_SIZE(tail->hotNodes));
+#endif
+		
+		FAIL_IF(true, ERROR_CALL_FAILED, "Failed to reserve space for the tail", false);
+	}
+	
+	//	The values of new CNodes are to be set to 0. Because truncate(2) already
+	//	fills the file with '\0', this eliminates the need to do this ourselves
+	//	for the CNodes written after the INodes. Reused CNodes are filled with '\0' here,
+	//	and so are the ones in the hot region, which is handed out again after a compaction.
+	offsetToNewCNode = tail->offset + coldNodes * sizeof(INode);
+	tailNode = 0;
+	tailCNode = NULL;
+	
+	for (currentCharacter = 0 ; currentCharacter < suffixLength ; ++currentCharacter)
+	{
+		pathCharacter = *(suffix + currentCharacter);
+		
+#ifndef STANDALONE_DTSM
+		if (pathCharacter == 13)
+			continue;
+#endif
+		
+		offsetToTailNode = offsetToTailINode(tail, tailNode);
+		
+		//Entry for this character goes into the previous node of the tail
+		if (tailCNode != NULL)
+		{
+			tailCNode->possibilities[pathCharacter - LOWER_LIMIT] = offsetToTailNode;
+		}
+		
+#if HOT_LEVELS
+		if (tailNode < tail->hotNodes)
+		{
+			offsetToCNode = tail->hotOffset + ALIGNED_SIZE(tail->hotNodes * sizeof(INode)) + tailNode * CNODE_BLOCK_SIZE;
+			
+			tailCNode = GOTO_OFFSET(offsetToCNode);
+			FAIL_IF(!tailCNode, ERROR_BAD_OFFSET, "tailCNode found NULL", false);
+			
+			memset(tailCNode, 0, sizeof(CNode));
+		}
+		else
+#endif
+		if (reusedCNodes != 0)
+		{
+			offsetToCNode = reusedCNodes;
+			
+			tailCNode = GOTO_OFFSET(offsetToCNode);
+			FAIL_IF(!tailCNode, ERROR_BAD_OFFSET, "tailCNode found NULL", false);
+			
+			reusedCNodes = *(size_t *)tailCNode;
+			
+			memset(tailCNode, 0, sizeof(CNode));
+		}
+		else
 		{
-			result = truncate(statusFile.name, statusFile.size);
-			FAIL_IF(result == -1, "truncate(2) failed", false);
+			offsetToCNode = offsetToNewCNode;
+			offsetToNewCNode += CNODE_BLOCK_SIZE;
+			
+			tailCNode = GOTO_OFFSET(offsetToCNode);
+			FAIL_IF(!tailCNode, ERROR_BAD_OFFSET, "tailCNode found NULL", false);
 		}
 		
+		tailINode = GOTO_OFFSET(offsetToTailNode);
+		FAIL_IF(!tailINode, ERROR_BAD_OFFSET, "tailINode found NULL", false);
 		
-		new_manager->statusFile_mmap_base =
-		mmap(NULL, statusFile.size, PROT_READ | PROT_WRITE, MAP_SHARED, statusFile.fd, 0);
+		//A recycled INode may still be the old value of some stale CAS, see MAIN_NODE().
+		//A new path gets a chance to be searched before it is evicted.
+		tailINode->mainNode = NEXT_MAIN_NODE(tailINode->mainNode, offsetToCNode | REFERENCED_MAIN_NODE);
 		
-		FAIL_IF(new_manager->sharedMemoryFile_mmap_base == MAP_FAILED, "mmap(2) failed", false);
+		++tailNode;
+	}
+	
+	if (!isEndOfString)
+		return true;
+	
+	tailCNode->isEndOfString = true;
+	tailCNode->flags         = flags;
+	
+#if VALUE_SIZE
+	//A CNode taken from `offsetToNewCNode` is 0s already
+	if (value != NULL)
+		memcpy(tailCNode->value, value, VALUE_SIZE);
+#endif
+	
+	return true;
+	
+}
+
+
+
+bool releaseReservedSpace(size_t reservedOffset, size_t bytesReserved)
+{
+	
+	FAIL_IF(manager == NULL, ERROR_NO_MANAGER, "Global(manager) is NULL", false);
+	
+	size_t oldValue, newValue;
+	void *endOfReservedSpace;
+	
+	oldValue = reservedOffset + ALIGNED_SIZE(bytesReserved + PADDING_BYTES);
+	newValue = reservedOffset;
+	
+	//Cheap check to avoid clearing the space when it can't be given back anyway
+	if (manager->status->writeFromOffset != oldValue)
+		return false;
+	
+	endOfReservedSpace = GOTO_OFFSET(reservedOffset + bytesReserved);
+	FAIL_IF(!endOfReservedSpace, ERROR_BAD_OFFSET, "endOfReservedSpace found NULL", false);
+	
+	memset(endOfReservedSpace - bytesReserved, 0, bytesReserved);
+	
+	return CAS_size_t( &oldValue, newValue, &(manager->status->writeFromOffset) );
+	
+}
+
+
+
+bool reserveSpaceForTail(size_t bytesToBeReserverd, size_t *reservedOffset)
+{
+	
+	if (spareTailSpace.size >= bytesToBeReserverd &&
+		isSpareUsable(spareTailSpace.pid, spareTailSpace.compactions, spareTailSpace.offset))
+	{
+		*reservedOffset = spareTailSpace.offset;
 		
-		new_manager->statusFile_fd = statusFile.fd;
+		spareTailSpace.offset += bytesToBeReserverd;
+		spareTailSpace.size   -= bytesToBeReserverd;
 		
+		return true;
 	}
 	
+	return reserveSpaceInSharedMemory(bytesToBeReserverd, reservedOffset);
 	
-	/*
-	 *	As the file size is expanded by truncate(2) which fills the file with '\0',
-	 *	sharedMemoryFileSize and writeFromOffset are initially 0.
-	 *
-	 *	Whichever thread or process opens the status file, needs to check for
-	 *	new_manager->statusFile_mmap_base->sharedMemoryFileSize and
-	 *	new_manager->statusFile_mmap_base->writeFromOffset.
-	 *	If these two are found 0, replace them with appropriate initial values.
-	 */
-	size_t oldValue, newValue;
-	
-	oldValue = 0;
-	newValue = INITIAL_FILE_SIZE;
-	
-	//Should always be more than at least ROOT_SIZE
-	FAIL_IF(newValue < ROOT_SIZE, "INITIAL_FILE_SIZE is too less", false);
-	
-	
-	result =
-	CAS_size_t(&oldValue, newValue, &(new_manager->statusFile_mmap_base->sharedMemoryFileSize) );
+}
+
+
+
+void keepSpareTailSpace(size_t offsetToTail, size_t bytesUsed)
+{
 	
+	void *endOfTail;
 	
-	FAIL_IF(new_manager->statusFile_mmap_base->sharedMemoryFileSize == 0, "CAS for sharedMemoryFileSize failed", false);
+	if (!isSpareUsable(spareTailSpace.pid, spareTailSpace.compactions, spareTailSpace.offset))
+	{
+		spareTailSpace.size        = 0;
+		spareTailSpace.pid         = getpid();
+		spareTailSpace.compactions = getCompactions();
+	}
 	
-	oldValue = 0;
-	newValue = 0 + ROOT_SIZE; //write after ROOT_SIZE bytes
+	//Taken before __dtsharedmemory_compact() retired its region
+	if (isRetired(offsetToTail))
+		return;
 	
-	result =
-	CAS_size_t(&oldValue, newValue, &(new_manager->statusFile_mmap_base->writeFromOffset) );
+	if (bytesUsed <= spareTailSpace.size)
+	{
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+		freeUnusedSpace(offsetToTail, bytesUsed);
+#endif
+		return;
+	}
 	
+	endOfTail = GOTO_OFFSET(offsetToTail + bytesUsed);
 	
-	FAIL_IF(new_manager->statusFile_mmap_base->writeFromOffset == 0, "CAS for writeFromOffset failed", false);
+	if (!endOfTail)
+		return;
 	
+	memset(endOfTail - bytesUsed, 0, bytesUsed);
 	
+	//Keep the bigger one
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+	freeUnusedSpace(spareTailSpace.offset, spareTailSpace.size);
+#endif
 	
-	return true;
+	spareTailSpace.offset = offsetToTail;
+	spareTailSpace.size   = bytesUsed;
 	
 }
 
 
 
-bool openSharedMemoryFile(struct SharedMemoryManager *new_manager, const char *shared_memory_file_name)
+void discardPrivateTail(const struct PrivateTail *tail)
 {
 	
-	FAIL_IF(new_manager == NULL, "Arg(new_manager) is NULL", false);
-	FAIL_IF(shared_memory_file_name == NULL || *shared_memory_file_name == '\0', "Invalid name for shared memory file", false);
+#if !(DISABLE_DUMPING_AND_RECYCLING)
 	
-	bool is_truncate_needed;
-	size_t stat_check;
-	int result;
+	size_t tailNode, offsetToTailNode;
+	INode *tailINode;
 	
-	struct{
+	//CNodes that are not inside the reserved space were reused, free them again
+	for (tailNode = 0 ; tailNode < tail->numberOfNodes ; ++tailNode)
+	{
+		offsetToTailNode = offsetToTailINode(tail, tailNode);
 		
-		const char *name;
-		int fd;
-		size_t size;
+		tailINode = GOTO_OFFSET(offsetToTailNode);
 		
-	}sharedMemoryFile;
+		if (!tailINode)
+			return;
+		
+		if (MAIN_NODE(tailINode->mainNode) < tail->offset || MAIN_NODE(tailINode->mainNode) >= tail->offset + tail->bytesReserved)
+		{
+			freeCNode(MAIN_NODE(tailINode->mainNode), offsetToTailNode);
+		}
+	}
 	
-	sharedMemoryFile.name = new_manager->sharedMemoryFile_name = shared_memory_file_name;
-	sharedMemoryFile.size = new_manager->statusFile_mmap_base->sharedMemoryFileSize;
-	sharedMemoryFile.fd   = open(sharedMemoryFile.name, O_RDWR, FILE_PERMISSIONS);
+#endif
 	
+#if HOT_LEVELS
 	
-	if(sharedMemoryFile.fd >= 0)
-	{
-		//Most frequent case, so kept on top
-		//Yea, it does nothing
-	}
-	else if(sharedMemoryFile.fd == -1 && (access(sharedMemoryFile.name, F_OK) == -1))
-	//File doesn't exist
+	//INodes in the hot region are left unused, their CNodes have been freed above
+	if (coldTailNodes(tail) == 0)
+		return;
+	
+#endif
+	
+#if FREED_CNODES_STACK_AVAILABLE
+	
+	if (tail->bytesReserved == 0)
 	{
-		//Create file
-		//Doesn't overwrite existing file because O_EXCL is added in flags.
-		sharedMemoryFile.fd = open(sharedMemoryFile.name, O_CREAT | O_EXCL | O_TRUNC | O_RDWR, FILE_PERMISSIONS);
-		
-		if(sharedMemoryFile.fd == -1)
+#	if SHARED_MEMORY_CAP
+		if (tail->iNodes != 0)
 		{
-			//Some other thread or process may have entered the code and created the file
-			//before this thread could. Assuming that, attempt to open the file again.
-			
-			sharedMemoryFile.fd = open(sharedMemoryFile.name, O_RDWR, FILE_PERMISSIONS);
-			FAIL_IF(sharedMemoryFile.fd == -1, "open(2) failed", false);
+			giveBackRecycledINodes(tail->iNodes, coldTailNodes(tail));
+			return;
 		}
-	}
-	else if(sharedMemoryFile.fd == -1)
-	{
-		/*
-		 *Its is possible that file was created just before access(2) was called in
-		 *the above `if` condition so trying to open again
-		 */
-		sharedMemoryFile.fd = open(sharedMemoryFile.name, O_RDWR, FILE_PERMISSIONS);
-		FAIL_IF(sharedMemoryFile.fd == -1, "open(2) failed", false);
+#	endif
 		
+		giveBackSpareINodes(tail->offset, coldTailNodes(tail));
+		return;
 	}
-	else
+	
+#endif
+	
+	//If nothing was reserved after it, hand the space back,
+	//otherwise keep it for the next tail created by this thread.
+	if (!releaseReservedSpace(tail->offset, tail->bytesReserved))
 	{
-		print_error("Unknown error! File descriptor negative but not -1");
-		return false;
+		keepSpareTailSpace(tail->offset, tail->bytesReserved);
 	}
 	
+}
+
+
+
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+
+void freeUnusedTailNodes(const struct PrivateTail *tail, size_t numberOfNodes)
+{
 	
+	size_t tailNode, offsetToTailNode;
+	INode *tailINode;
 	
-	if (sharedMemoryFile.fd >= 0)
+	for (tailNode = 0 ; tailNode < numberOfNodes ; ++tailNode)
 	{
+		offsetToTailNode = offsetToTailINode(tail, tailNode);
 		
-		is_truncate_needed = ((stat_check = getFileSizeForFile(sharedMemoryFile.name)) == 0) ? true : false;
-		
-		FAIL_IF(stat_check == (size_t)-1, "getFileSizeForFile() failed", false);
-		
-		if (is_truncate_needed)
-		{
-			result = truncate(sharedMemoryFile.name, sharedMemoryFile.size);
-			FAIL_IF(result == -1, "truncate(2) failed", false);
-		}
-		
-		new_manager->sharedMemoryFile_mmap_base = mmap(NULL, sharedMemoryFile.size, PROT_READ | PROT_WRITE, MAP_SHARED, sharedMemoryFile.fd, 0);
-		
-		FAIL_IF(new_manager->sharedMemoryFile_mmap_base == MAP_FAILED, "mmap(2) failed", false);
+		tailINode = GOTO_OFFSET(offsetToTailNode);
 		
-		new_manager->sharedMemoryFile_mapping_size = sharedMemoryFile.size;
+		if (!tailINode)
+			return;
 		
-		new_manager->sharedMemoryFile_fd = sharedMemoryFile.fd;
+		freeCNode(MAIN_NODE(tailINode->mainNode), offsetToTailNode);
 		
+#	if SHARED_MEMORY_CAP
+		tailINode->mainNode = NEXT_MAIN_NODE(tailINode->mainNode, TOMB_CNODE_OFFSET);
+		freeINode(offsetToTailNode);
+#	endif
 	}
 	
+}
+
+
+
+void freeUnusedSpace(size_t offset, size_t bytes)
+{
 	
+	size_t freedBytes;
 	
-	//	If rootINode->mainNode is 0, need to initialise it.
-	//	It will be 0 the first time of this CAS because file is given its size
-	//	through truncate(2), which fills file with '\0'.
-	//	Every thread opening this file needs to make this check.
+	for (freedBytes = 0 ; freedBytes + CNODE_BLOCK_SIZE <= bytes ; freedBytes += CNODE_BLOCK_SIZE)
+	{
+		freeCNode(offset + freedBytes, 0);
+	}
 	
-	size_t oldValue, newValue;
+}
+
+#endif
+
+
+
+bool getSpaceForCNode(size_t *offsetToCNode, size_t parentINode)
+{
 	
-	oldValue = 0;
-	newValue = sizeof(INode);
+#if SHARED_MEMORY_CAP
+	int attempt;
+	bool isEvictionWorthRetrying;
+#endif
 	
-	INode *rootINode = new_manager->sharedMemoryFile_mmap_base;
+#if HOT_LEVELS
 	
-	CAS_size_t(&oldValue, newValue, &(rootINode->mainNode));
+	//CNodes of the root and of the INodes in the hot region stay in it while it has space
+	if (parentINode == 0 || isInHotRegion(parentINode))
+	{
+		//popFreedCNode() would take 0, the root, as an INode nobody knows about
+		if (parentINode != 0 && popFreedCNode(&(manager->status->freedHotCNodes), offsetToCNode, parentINode))
+			return countStat(STAT_RECYCLE_HITS);
+		
+		if (reserveSpaceInHotRegion(sizeof(CNode), offsetToCNode))
+			return true;
+	}
 	
-	FAIL_IF(rootINode->mainNode == 0, "Couldn't set root INode's mainNode", false);
+#endif
 	
-	return true;
+#if FREED_CNODES_STACK_AVAILABLE
 	
-}
-
-
-
-bool __dtsharedmemory_insert(const char *path, uint8_t flags)
-{
+	if (reuseFreedCNode(offsetToCNode, parentINode))
+		return countStat(STAT_RECYCLE_HITS);
 	
-	FAIL_IF(manager == NULL, "Global(manager) is NULL", false);
-	FAIL_IF(path == NULL, "Arg(path) is NULL", false);
+#endif
 	
-	size_t traverser = 0;
-	size_t oldValue, newValue;
+#if !(DISABLE_DUMPING_AND_RECYCLING)
 	
-	INode *currentINode;
-	CNode *currentCNode;
-	CNode *copiedCNode;
-	CNode tempCNode;
+	if (recycleWastedMemory(offsetToCNode, parentINode))
+		return countStat(STAT_RECYCLE_HITS);
 	
-	size_t offsetToCopiedChildCNode;
+#endif
 	
-	int currentCharacter;
+	countStat(STAT_RECYCLE_MISSES);
 	
-	uint8_t pathCharacter;
+	if (reserveSpaceInSharedMemory(sizeof(CNode), offsetToCNode))
+		return true;
 	
-	bool result;
-	bool entryFor_pathCharacter_alreadyExists ;
-	bool entryFor_pathCharacter;
-	bool isEndOfString;
+#if SHARED_MEMORY_CAP
 	
-	for (currentCharacter = 0 ; *(path + currentCharacter) != '\0' ; ++currentCharacter)
+	//SHARED_MEMORY_CAP has been reached. Paths already removed are given up before
+	//any is evicted.
+	if (reclaimDetachedSubtrees(RECLAIM_BATCH_SIZE) != 0 && reuseFreedCNode(offsetToCNode, parentINode))
+		return true;
+	
+	//Even if another thread is evicting, it may have freed something by now.
+	//Other threads may take the freed CNodes first, so more than once.
+	for (attempt = 0 ; attempt < EVICTION_ATTEMPTS ; ++attempt)
 	{
+		isEvictionWorthRetrying = evictColdPaths();
 		
-		pathCharacter = *(path + currentCharacter);
-		
-#ifndef STANDALONE_DTSM
-		//13 ascii is custom icon representer on macOS
-		if (pathCharacter == 13)
-			continue;
-#endif
-		
-		FAIL_IF(pathCharacter > (uint8_t)UPPER_LIMIT, "Not accepting characters above UPPER_LIMIT", false);
-		FAIL_IF(pathCharacter < (uint8_t)LOWER_LIMIT, "Not accepting characters below LOWER_LIMIT", false);
-		
-		currentINode = GOTO_OFFSET(traverser);
-		
-		FAIL_IF(!currentINode, "currentINode found NULL", false);
-		
-		
-		GUARD_CNODE_ACCESS
-		(
-		entryFor_pathCharacter = (bool)currentCNode->possibilities[pathCharacter - LOWER_LIMIT];
-		)
-		
+		if (reuseFreedCNode(offsetToCNode, parentINode))
+			return true;
 		
-		if ( entryFor_pathCharacter == false )
-		{
-			
-			/**
-			 *	Entering this `if` block means the node doesn't contain pathCharacter
-			 *	This block would create a copy of currentCNode with updated values
-			 *	and try repeated CAS on currentINode->mainNode.
-			 **/
-			
-			
-#if !(DISABLE_DUMPING_AND_RECYCLING)
-			
-			result = recycleWastedMemory(&offsetToCopiedChildCNode, traverser);
-			
-			if (!result)
-			{
-				result = reserveSpaceInSharedMemory(sizeof(CNode), &offsetToCopiedChildCNode);
-			}
-			
+		if (!isEvictionWorthRetrying)
+			break;
+	}
+	
+	return false;
+	
 #else
-			
-			result = reserveSpaceInSharedMemory(sizeof(CNode), &offsetToCopiedChildCNode);
-			
+	
+	return false;
+	
 #endif
-			
-			FAIL_IF(!result, "Failed to insert new node", false);
-			
-			copiedCNode = GOTO_OFFSET(offsetToCopiedChildCNode);
-			
-			FAIL_IF(!copiedCNode, "copiedCNode found NULL", false);
-			
-			entryFor_pathCharacter_alreadyExists = false;
-			
-			do
-			{
-				
-				oldValue = currentINode->mainNode;
-				
-				GUARD_CNODE_ACCESS
-				(
-				entryFor_pathCharacter = currentCNode->possibilities[pathCharacter - LOWER_LIMIT];
-				)
-				
-				if ( entryFor_pathCharacter )
-				{
-					//Some other thread may create a copy of the currentCNode and
-					//try to update the same array entry as this thread is doing.
-					//If this check is not made, one of the 2 insertions will fail.
-					
+	
+}
+
+
+
 #if !(DISABLE_DUMPING_AND_RECYCLING)
-					//As the newly reserved offset is wasted, dump it.
-					dumpWastedMemory(offsetToCopiedChildCNode, traverser);
+
+void freeCNode(size_t offsetToCNode, size_t iNode)
+{
+	
+#if FREED_CNODES_STACK_AVAILABLE
+	
+	pushFreedCNode(offsetToCNode, 0);
+	
+#else
+	
+	dumpWastedMemory(offsetToCNode, iNode);
+	
 #endif
-					entryFor_pathCharacter_alreadyExists = true;
-					break;
-					
-				}
-				
-				newValue = offsetToCopiedChildCNode;
-				
-				//Need not be inside GUARD_CNODE_ACCESS because if the CNode changes,
-				//cas will fail anyway
-				tempCNode = *currentCNode;
-				
-				result = createUpdatedCNodeCopy(copiedCNode, tempCNode, pathCharacter - LOWER_LIMIT, tempCNode.isEndOfString, tempCNode.flags);
-				
-				FAIL_IF(!result, "Failed to update CNode", false);
-				
-				
-			} while ( !CAS_size_t( &oldValue, newValue, &(currentINode->mainNode) ) );
-			
-			
-			if (!entryFor_pathCharacter_alreadyExists)
-			{
-				
-#if !(DISABLE_DUMPING_AND_RECYCLING)
-				dumpWastedMemory(oldValue, traverser);
+	
+}
+
 #endif
-				currentCNode = copiedCNode;
-				
-			}
-			
-		}
-		
-		GUARD_CNODE_ACCESS
-		(
-		traverser = currentCNode->possibilities[pathCharacter - LOWER_LIMIT];
-		)
+
+
+
+#if FREED_CNODES_STACK_AVAILABLE
+
+bool takeSpareINodes(size_t numberOfINodes, size_t *offsetToINodes)
+{
+	
+	size_t offsetToCNode;
+	
+	if (numberOfINodes > INODES_IN_CNODE)
+		return false;
+	
+	if (!isSpareUsable(spareINodes.pid, spareINodes.compactions, spareINodes.offset))
+	{
+		spareINodes.count       = 0;
+		spareINodes.pid         = getpid();
+		spareINodes.compactions = getCompactions();
+	}
+	
+	if (spareINodes.count < numberOfINodes)
+	{
+		if (!reuseFreedCNode(&offsetToCNode, 0))
+			return false;
 		
+		spareINodes.offset = ALIGNED_SIZE(offsetToCNode);
+		spareINodes.count  = INODES_IN_CNODE;
 	}
 	
-	/**
-	 *	If the path getting inserted is a prefix, and the last character of
-	 *	the inputted path is '/', just ignore the '/' and treat it like it was
-	 *	never in the Arg(path) because that's how __dtsharedmemory_search() will
-	 *	detect the prefix. The code in the end of the func  makes the ending node of a prefix path
-	 *	contain 0 in the `possibilities` array for '/' so that search can detect the prefix.
-	 **/
-	if ((pathCharacter == '/' && (flags & IS_PREFIX))     ==    false)
-	{
-		currentINode = GOTO_OFFSET(traverser);
-		FAIL_IF(!currentINode, "currentINode found NULL", false);
-	}
+	*offsetToINodes = spareINodes.offset;
 	
+	spareINodes.offset += numberOfINodes * sizeof(INode);
+	spareINodes.count  -= numberOfINodes;
 	
-#if !(DISABLE_DUMPING_AND_RECYCLING)
+	return true;
 	
-	result = recycleWastedMemory(&offsetToCopiedChildCNode, traverser);
+}
+
+
+
+void giveBackSpareINodes(size_t offsetToINodes, size_t numberOfINodes)
+{
 	
-	if (!result)
+	if (spareINodes.pid == getpid() && spareINodes.offset == offsetToINodes + numberOfINodes * sizeof(INode))
 	{
-		result = reserveSpaceInSharedMemory(sizeof(CNode), &offsetToCopiedChildCNode);
+		spareINodes.offset  = offsetToINodes;
+		spareINodes.count  += numberOfINodes;
 	}
 	
-#else
+}
+
+
+
+void pushFreedCNode(size_t offsetToCNode, size_t excludedINode)
+{
+	
+	size_t oldValue, newValue;
+	size_t *nextFreedCNode;
+	FreedCNodesTop *top = &(manager->status->freedCNodes);
 	
-	result = reserveSpaceInSharedMemory(sizeof(CNode), &offsetToCopiedChildCNode);
+	//Nothing in the region given up by __dtsharedmemory_compact() is reused until it is handed out
+	if (isRetired(offsetToCNode))
+		return;
 	
+#if HOT_LEVELS
+	//Only reused in the hot region, see getSpaceForCNode()
+	if (isInHotRegion(offsetToCNode))
+		top = &(manager->status->freedHotCNodes);
 #endif
 	
-	FAIL_IF(!result, "Failed to insert new node", false);
+	nextFreedCNode = GOTO_OFFSET(offsetToCNode);
 	
-	copiedCNode = GOTO_OFFSET(offsetToCopiedChildCNode);
+	if (!nextFreedCNode)
+		return;
 	
-	FAIL_IF(!copiedCNode, "copiedCNode found NULL", false);
+	*(nextFreedCNode + 1) = excludedINode;
 	
 	do
 	{
 		
-		oldValue = currentINode->mainNode;
-		newValue = offsetToCopiedChildCNode;
-		
-		//Need not be inside GUARD_CNODE_ACCESS because if the CNode changes,
-		//CAS will fail anyway
-		tempCNode = *currentCNode;
-		
-		//-1 in the function call below indicates no updations required in array.
-		//Only need to change isEndOfString and flags.
-		isEndOfString = true;
-		result = createUpdatedCNodeCopy(copiedCNode, tempCNode, -1, isEndOfString, flags);
+		oldValue = *top;
 		
-		FAIL_IF(!result, "Failed to update CNode", false);
+		*nextFreedCNode = oldValue & FREED_CNODES_OFFSET_MASK;
 		
-		if (flags & IS_PREFIX)
-		{
-			//So that paths that have already been inseted with this
-			//prefix can be searched as prefixes now (see __dtsharedmemory_search())
-			copiedCNode->possibilities['/' - LOWER_LIMIT] = 0;
-		}
+		newValue = offsetToCNode | (((oldValue >> FREED_CNODES_TAG_SHIFT) + 1) << FREED_CNODES_TAG_SHIFT);
 		
-	} while ( !CAS_size_t( &oldValue, newValue, &(currentINode->mainNode) ) );
-	
-#if !(DISABLE_DUMPING_AND_RECYCLING)
-	dumpWastedMemory(oldValue, traverser);
-#endif
+	} while ( !CAS_size_t( &oldValue, newValue, top ) );
 	
-	return true;
 }
 
 
 
-bool __dtsharedmemory_search(const char *path, uint8_t *flags)
+bool reuseFreedCNode(size_t *offsetToCNode, size_t iNode)
 {
 	
-	FAIL_IF(manager == NULL, "Global(manager) is NULL", false);
-	FAIL_IF(path == NULL, "Arg(path) is NULL", false);
-	
+	return popFreedCNode(&(manager->status->freedCNodes), offsetToCNode, iNode);
 	
-	int currentCharacter;
-	uint8_t pathCharacter;
-	
-	
-	size_t traverser = 0;
-	INode *currentINode;
-	CNode *currentCNode;
-	bool isEndOfString;
+}
+
+
+
+bool popFreedCNode(FreedCNodesTop *top, size_t *offsetToCNode, size_t iNode)
+{
 	
-	bool entryFor_pathCharacter;
-	uint8_t flagsForCurrentCNode;
+	size_t oldValue, newValue;
+	size_t offsetToFreedCNode;
+	size_t *nextFreedCNode;
 	
-	for (currentCharacter = 0 ; *(path + currentCharacter) != '\0' ; ++currentCharacter)
+	do
 	{
 		
-		pathCharacter = *(path + currentCharacter);
-	
-#if STANDALONE_DTSM
-		//13 ascii is custom icon representer
-		if (pathCharacter == 13)
-			continue;
-#endif
-		
-		FAIL_IF(pathCharacter > (uint8_t)UPPER_LIMIT, "Not accepting characters above UPPER_LIMIT", false);
-		FAIL_IF(pathCharacter < (uint8_t)LOWER_LIMIT, "Not accepting characters below LOWER_LIMIT", false);
+		oldValue = *top;
 		
+		offsetToFreedCNode = oldValue & FREED_CNODES_OFFSET_MASK;
 		
-		currentINode = GOTO_OFFSET(traverser);
-		
-		FAIL_IF(!currentINode, "currentINode found NULL", false);
+		if (offsetToFreedCNode == 0)
+			return false;
 		
-		GUARD_CNODE_ACCESS
-		(
-		entryFor_pathCharacter = currentCNode->possibilities[pathCharacter - LOWER_LIMIT];
-		flagsForCurrentCNode   = currentCNode->flags;
-		)
+		nextFreedCNode = GOTO_OFFSET(offsetToFreedCNode);
 		
-		if ( entryFor_pathCharacter == false)
-		{
-			
-			if (pathCharacter == '/' && (flagsForCurrentCNode & IS_PREFIX))
-			{
-				*flags = flagsForCurrentCNode;
-				return true;
-			}
-			
-			
-			//Doesn't exist in shared memory
+		if (!nextFreedCNode)
 			return false;
-		}
 		
+		//It was dumped by `iNode` itself, see dumpWastedMemory()
+		if (iNode != 0 && *(nextFreedCNode + 1) == iNode)
+			return false;
 		
-		GUARD_CNODE_ACCESS
-		(
-		traverser = currentCNode->possibilities[pathCharacter - LOWER_LIMIT];
-		)
+		//If some other thread popped it meanwhile, this may read garbage
+		//but then the tag has changed and CAS fails.
+		newValue = (*nextFreedCNode & FREED_CNODES_OFFSET_MASK) |
+		(((oldValue >> FREED_CNODES_TAG_SHIFT) + 1) << FREED_CNODES_TAG_SHIFT);
 		
-	}
+	//Ones freed before __dtsharedmemory_compact() retired their region are dropped
+	} while ( !CAS_size_t( &oldValue, newValue, top ) || isRetired(offsetToFreedCNode) );
 	
-	currentINode = GOTO_OFFSET(traverser);
-	
-	FAIL_IF(!currentINode, "currentINode found NULL", false);
+	*offsetToCNode = offsetToFreedCNode;
 	
-	GUARD_CNODE_ACCESS
-	(
-	*flags        = currentCNode->flags;
-	isEndOfString = currentCNode->isEndOfString;
-	)
+	return true;
 	
-	return isEndOfString;
 }
 
+#endif
+
 
 
-bool reserveSpaceInSharedMemory(size_t bytesToBeReserverd, size_t *reservedOffset)
+#if SHARED_MEMORY_CAP
+
+void freeINode(size_t offsetToINode)
 {
 	
-	FAIL_IF(manager == NULL, "Global(manager) is NULL", false);
+	size_t *bundle;
 	
-	size_t oldValue, newValue;
+	if (recycledINodes.pid != getpid())
+	{
+		recycledINodes.filling = 0;
+		recycledINodes.taking  = 0;
+		recycledINodes.pid     = getpid();
+	}
 	
-	do
+	if (recycledINodes.filling == 0)
 	{
-		oldValue = manager->statusFile_mmap_base->writeFromOffset;
-		
-		//PADDING_BYTES are added so that recycled offsets can use an odd offset
-		//by adding 1. PADDING_BYTES create extra space so 1 can be added to recycled offsets.
-		newValue = oldValue + bytesToBeReserverd + PADDING_BYTES;
+		if (!reuseFreedCNode(&(recycledINodes.filling), 0))
+			return;
 		
-#if !(LARGE_MEMORY_NEEDED)
-		FAIL_IF(newValue >= UINT32_MAX, "Set LARGE_MEMORY_NEEDED to 1 in dtsharedmemory.h to use more memory", false);
-#endif
+		bundle = GOTO_OFFSET(ALIGNED_SIZE(recycledINodes.filling));
 		
-		FAIL_IF(newValue <= oldValue, "Memory limit reached", false);
+		if (!bundle)
+		{
+			recycledINodes.filling = 0;
+			return;
+		}
 		
-	} while ( !CAS_size_t( &oldValue, newValue, &(manager->statusFile_mmap_base->writeFromOffset) ) );
+		*(bundle + 1) = 0;
+	}
 	
-	*reservedOffset = oldValue;
+	bundle = GOTO_OFFSET(ALIGNED_SIZE(recycledINodes.filling));
 	
-	return true;
+	if (!bundle)
+		return;
+	
+	*(bundle + 2 + *(bundle + 1)) = offsetToINode;
+	++*(bundle + 1);
+	
+	if (*(bundle + 1) == INODES_IN_BUNDLE)
+	{
+		pushFreedINodes(recycledINodes.filling);
+		recycledINodes.filling = 0;
+	}
 	
 }
 
 
 
-bool expandSharedMemory(size_t offset)
+bool takeRecycledINodes(size_t numberOfINodes, size_t *offsetToINodes)
 {
 	
-#if DISABLE_MEMORY_EXPANSION && 1
-	
-	FAIL_IF(true, "Memory expansion is disabled", false);
-	
-#endif
-	
-	FAIL_IF(manager == NULL, "Global(manager) is NULL", false);
-	
-	size_t newSize;
-	int result;
-	struct SharedMemoryManager *old_manager, *new_manager;
+	size_t *bundle;
+	size_t offsetToBundle, index;
 	
+	if (numberOfINodes > INODES_IN_BUNDLE)
+		return false;
 	
-	/**
-	 *	Below we are just choosing the largest known file size
-	 *	Any number of cases can arise that may prevent the code from
-	 *	adding EXPANDING_SIZE to a much old known file size but the next 2 checks
-	 *	make it very very rare making such a condition only theoritical and EXPANDING_SIZE
-	 *	is big enough to even survive that in most cases.
-	 *	To explain it further, sometimes a particular processes may have a
-	 *	very old `sharedMemoryFile_mapping_size` whereas other processes may have went
-	 *	way far, that's why `statusFile_mmap_base->sharedMemoryFileSize` is also checked.
-	 **/
+	if (recycledINodes.pid != getpid())
+	{
+		recycledINodes.filling = 0;
+		recycledINodes.taking  = 0;
+		recycledINodes.pid     = getpid();
+	}
 	
-	newSize = manager->statusFile_mmap_base->sharedMemoryFileSize;
+	if (recycledINodes.taking != 0)
+	{
+		bundle = GOTO_OFFSET(ALIGNED_SIZE(recycledINodes.taking));
+		FAIL_IF(!bundle, ERROR_BAD_OFFSET, "bundle found NULL", false);
+		
+		if (*(bundle + 1) - recycledINodes.taken < numberOfINodes)
+		{
+			offsetToBundle = recycledINodes.taking;
+			recycledINodes.taking = 0;
+			
+			//The INodes left go to the bundle being filled
+			for (index = recycledINodes.taken ; index < *(bundle + 1) ; ++index)
+			{
+				freeINode(*(bundle + 2 + index));
+			}
+			
+			pushFreedCNode(offsetToBundle, 0);
+		}
+	}
 	
-	newSize = manager->sharedMemoryFile_mapping_size > newSize ? manager->sharedMemoryFile_mapping_size : newSize;
+	if (recycledINodes.taking == 0)
+	{
+		if (!popFreedINodes(&offsetToBundle))
+			return false;
+		
+		recycledINodes.taking = offsetToBundle;
+		recycledINodes.taken  = 0;
+	}
 	
+	*offsetToINodes = ALIGNED_SIZE(recycledINodes.taking) + (2 + recycledINodes.taken) * sizeof(size_t);
 	
-	newSize += EXPANDING_SIZE;
+	recycledINodes.taken += numberOfINodes;
 	
-	//Some other thread already expanded memory
-	if(manager->sharedMemoryFile_mapping_size > offset)
-		return true;
-	//Better if we avoid expanding if other thread already fulfilled requirement
+	return true;
 	
+}
+
+
+
+void giveBackRecycledINodes(size_t offsetToINodes, size_t numberOfINodes)
+{
 	
-	//File size expansion
-	if (manager->statusFile_mmap_base->sharedMemoryFileSize < newSize)
+	if (recycledINodes.pid == getpid() && recycledINodes.taking != 0 &&
+		ALIGNED_SIZE(recycledINodes.taking) + (2 + recycledINodes.taken) * sizeof(size_t) ==
+		offsetToINodes + numberOfINodes * sizeof(size_t))
 	{
-		//using truncate(2) instead of ftruncate(2)
-		//seems safer because of unpredicted fd clashes with
-		//processes in which library is injected
-		result = truncate(manager->sharedMemoryFile_name, newSize);
-		FAIL_IF(result == -1, "truncate(2) failed", false);
+		recycledINodes.taken -= numberOfINodes;
 	}
 	
+}
+
+
+
+void pushFreedINodes(size_t offsetToBundle)
+{
 	
-	//Make new manager with updated mappings to replace the current Global(manager)
-	new_manager = (struct SharedMemoryManager *)malloc(sizeof(struct SharedMemoryManager));
-	FAIL_IF(new_manager == NULL, "malloc(2) failed", false);
-	
-	memcpy(new_manager, manager, sizeof(struct SharedMemoryManager));
+	size_t oldValue, newValue;
+	size_t *nextBundle;
 	
-	new_manager->sharedMemoryFile_mmap_base = mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, manager->sharedMemoryFile_fd, 0 );
-	FAIL_IF(new_manager->sharedMemoryFile_mmap_base == MAP_FAILED, "mmap(2) failed", false);
-	new_manager->sharedMemoryFile_mapping_size = newSize;
+	nextBundle = GOTO_OFFSET(ALIGNED_SIZE(offsetToBundle));
 	
+	if (!nextBundle)
+		return;
 	
-	//Replace Global(manager)
 	do
 	{
 		
-		old_manager = manager;
-		
-		if(old_manager->sharedMemoryFile_mapping_size >= new_manager->sharedMemoryFile_mapping_size)
-		{
-			munmap(new_manager->sharedMemoryFile_mmap_base, new_manager->sharedMemoryFile_mapping_size);
-			free(new_manager);
-			
-			return true;
-		}
+		oldValue = manager->status->freedINodes;
 		
-	} while ( !CAS_ptr( &old_manager, new_manager, &(manager) ) );
-	
-	
-	
-	//Update file size in status file
-	size_t oldValue, newValue;
-	do
-	{
-		oldValue = manager->statusFile_mmap_base->sharedMemoryFileSize;
-		newValue = newSize;
+		*nextBundle = oldValue & FREED_CNODES_OFFSET_MASK;
 		
-		if (newValue <= oldValue)
-		{
-			break;
-		}
+		newValue = offsetToBundle | (((oldValue >> FREED_CNODES_TAG_SHIFT) + 1) << FREED_CNODES_TAG_SHIFT);
 		
-	} while ( !CAS_size_t( &oldValue, newValue, &(manager->statusFile_mmap_base->sharedMemoryFileSize) ) );
-	
-	
-	return true;
+	} while ( !CAS_size_t( &oldValue, newValue, &(manager->status->freedINodes) ) );
 	
 }
 
 
 
-bool createUpdatedCNodeCopy(CNode *copy, CNode cNodeToBeCopied, int index, bool updated_isEndOfString, uint8_t updated_flags)
+bool popFreedINodes(size_t *offsetToBundle)
 {
 	
-	FAIL_IF(manager == NULL, "Global(manager) is NULL", false);
-	
-	
-	//copying the complete old CNode
-	copy = memcpy(copy, &cNodeToBeCopied, sizeof(CNode));
-	
+	size_t oldValue, newValue;
+	size_t offsetToFreedBundle;
+	size_t *nextBundle;
 	
-	//Only create a new entry if `index` is non negative.
-	if (index >= 0)
+	do
 	{
-		bool result;
-		size_t bytesToBeReserverd, writeFromOffset;
-		
-		//Making changes to the `copy` by adding new child
 		
-		bytesToBeReserverd = sizeof(INode) + sizeof(CNode);
+		oldValue = manager->status->freedINodes;
 		
-		result = reserveSpaceInSharedMemory(bytesToBeReserverd, &writeFromOffset);
+		offsetToFreedBundle = oldValue & FREED_CNODES_OFFSET_MASK;
 		
-		FAIL_IF(!result, "Failed to create an updated copy of CNode", false);
+		if (offsetToFreedBundle == 0)
+			return false;
 		
+		nextBundle = GOTO_OFFSET(ALIGNED_SIZE(offsetToFreedBundle));
 		
-		//Creating child INode
+		if (!nextBundle)
+			return false;
 		
-		INode *baseAddressOfINode = GOTO_OFFSET(writeFromOffset);
-		FAIL_IF(!baseAddressOfINode, "baseAddressOfINode found NULL", false);
-		//	The values of child CNode are to be set to 0. Because truncate(2) already
-		//	fills the file with '\0', this eliminates the need to do this ourselves.
-		baseAddressOfINode->mainNode = writeFromOffset + sizeof(INode);
+		//Same as in reuseFreedCNode(), a stale read fails the CAS
+		newValue = (*nextBundle & FREED_CNODES_OFFSET_MASK) |
+		(((oldValue >> FREED_CNODES_TAG_SHIFT) + 1) << FREED_CNODES_TAG_SHIFT);
 		
-		copy->possibilities[index] = writeFromOffset;
-	}
+	} while ( !CAS_size_t( &oldValue, newValue, &(manager->status->freedINodes) ) );
 	
-	
-	copy->isEndOfString = updated_isEndOfString;
-	copy->flags         = updated_flags;
+	*offsetToBundle = offsetToFreedBundle;
 	
 	return true;
 	
 }
 
+#endif
 
 
-int __dtsharedmemory_getStatusFileFd()
-{
-	return (manager != NULL ? manager->statusFile_fd : -1);
-}
 
 int __dtsharedmemory_getSharedMemoryFileFd()
 {
@@ -1313,7 +6549,7 @@ int __dtsharedmemory_getSharedMemoryFileFd()
 
 size_t __dtsharedmemory_getUsedSharedMemorySize()
 {
-	return (manager != NULL ? manager->statusFile_mmap_base->writeFromOffset : 0);
+	return (manager != NULL ? manager->status->writeFromOffset : 0);
 }
 
 bool __dtsharedmemory_reset_fd()
@@ -1323,33 +6559,38 @@ bool __dtsharedmemory_reset_fd()
 	if (manager == NULL)
 		return true;
 	
-	struct SharedMemoryManager *old_manager, *new_manager;
+	int sharedMemoryFile_fd;
 	
-	new_manager = (struct SharedMemoryManager *)malloc(sizeof(struct SharedMemoryManager));
+	sharedMemoryFile_fd = open(manager->sharedMemoryFile_name, O_RDWR, FILE_PERMISSIONS);
 	
-	FAIL_IF(new_manager == NULL, "malloc(2) failed", false);
+	FAIL_IF(sharedMemoryFile_fd == -1, ERROR_SYSTEM_CALL, "open(2) failed", false);
 	
-	int statusFile_fd, sharedMemoryFile_fd;
+	//Readers only ever see either the old or the new fd
+	manager->sharedMemoryFile_fd = sharedMemoryFile_fd;
 	
-	sharedMemoryFile_fd = open(manager->sharedMemoryFile_name, O_RDWR, FILE_PERMISSIONS);
+	return true;
+}
+
+bool __dtsharedmemory_export_fd()
+{
 	
-	FAIL_IF(sharedMemoryFile_fd == -1, "open(2) failed", false);
+	FAIL_IF(!MANAGER_OR_ATTACH(), ERROR_NO_MANAGER, "Global(manager) is NULL", false);
 	
-	statusFile_fd = open(manager->statusFile_name, O_RDWR, FILE_PERMISSIONS);
+	struct stat sharedMemoryFileStats;
+	char exported[64];
+	int result;
 	
-	FAIL_IF(statusFile_fd == -1, "open(2) failed", false);
+	result = fstat(manager->sharedMemoryFile_fd, &sharedMemoryFileStats);
+	FAIL_IF(result == -1, ERROR_SYSTEM_CALL, "fstat(2) failed", false);
 	
-	do
-	{
-		old_manager = manager;
-		memcpy(new_manager, old_manager, sizeof(struct SharedMemoryManager));
-		
-		new_manager->sharedMemoryFile_fd = sharedMemoryFile_fd;
-		new_manager->statusFile_fd       = statusFile_fd;
-		
-	} while ( !CAS_ptr( &old_manager, new_manager, &(manager) ) );
+	snprintf(exported, sizeof(exported), "%d:%llu:%llu", manager->sharedMemoryFile_fd,
+			 (unsigned long long)sharedMemoryFileStats.st_dev, (unsigned long long)sharedMemoryFileStats.st_ino);
+	
+	result = setenv(INHERITED_FD_VARIABLE, exported, 1);
+	FAIL_IF(result == -1, ERROR_SYSTEM_CALL, "setenv(3) failed", false);
 	
 	return true;
+	
 }
 
 
@@ -1358,13 +6599,19 @@ bool __dtsharedmemory_reset_fd()
 bool dumpWastedMemory(size_t wastedOffset, size_t parentINode)
 {
 	
-	FAIL_IF(manager == NULL, "Global(manager) is NULL", false);
+	FAIL_IF(manager == NULL, ERROR_NO_MANAGER, "Global(manager) is NULL", false);
 	
 	int i;
 	size_t oldBitmap, newBitmap;
 	int bitmapIndex, bitmapOffset;
 	bool isFull;
 	
+	PROBE2(dump, wastedOffset, parentINode);
+	
+	//Nothing in the region given up by __dtsharedmemory_compact() is reused until it is handed out
+	if (isRetired(wastedOffset))
+		return true;
+	
 	++ wastedOffset;
 	/**
 	 *	To make it go to an odd offset
@@ -1378,8 +6625,22 @@ bool dumpWastedMemory(size_t wastedOffset, size_t parentINode)
 	 **/
 	if (wastedOffset % 2 == 0)
 	{
+#if SHARED_MEMORY_CAP
+		pushFreedCNode(wastedOffset - 1, parentINode);
+		return true;
+#else
 		return false;
+#endif
+	}
+	
+#if HOT_LEVELS
+	//Kept for the INodes in the hot region, see getSpaceForCNode(). Reused once like the rest.
+	if (isInHotRegion(wastedOffset))
+	{
+		pushFreedCNode(wastedOffset, parentINode);
+		return true;
 	}
+#endif
 	
 	
 	do
@@ -1387,13 +6648,13 @@ bool dumpWastedMemory(size_t wastedOffset, size_t parentINode)
 		
 		isFull = true;
 		
-		for (i = 0 ; i < DUMP_YARD_SIZE ; ++i)
+		for (i = 0 ; (size_t)i < options.dumpYardSize ; ++i)
 		{
 			
 			bitmapIndex  = i / NO_OF_BITS;
 			bitmapOffset = i % NO_OF_BITS;
 			
-			oldBitmap = manager->statusFile_mmap_base->bitmapForDumping[bitmapIndex];
+			oldBitmap = manager->status->bitmapForDumping[bitmapIndex];
 			
 			if (getBitmapAtIndex(oldBitmap, bitmapOffset) == false)
 			{
@@ -1405,21 +6666,30 @@ bool dumpWastedMemory(size_t wastedOffset, size_t parentINode)
 		
 		//Wasted memory dump yard full
 		if (isFull)
+		{
+			countStat(STAT_DUMP_YARD_FULL);
+			
+#if SHARED_MEMORY_CAP
+			pushFreedCNode(wastedOffset - 1, parentINode);
+			return true;
+#else
 			return false;
+#endif
+		}
 		
-	} while( !CAS_size_t( &oldBitmap, newBitmap, &(manager->statusFile_mmap_base->bitmapForDumping[bitmapIndex]) ) );
+	} while( !CAS_size_t( &oldBitmap, newBitmap, &(manager->status->bitmapForDumping[bitmapIndex]) ) );
 	
 	
-	manager->statusFile_mmap_base->wastedMemoryDumpYard[i] = wastedOffset;
-	manager->statusFile_mmap_base->parentINodesOfDumper[i] = parentINode;
+	manager->status->wastedMemoryDumpYard[i] = wastedOffset;
+	manager->status->parentINodesOfDumper[i] = parentINode;
 	
 	
 	do
 	{
-		oldBitmap = manager->statusFile_mmap_base->bitmapForRecycling[bitmapIndex];
+		oldBitmap = manager->status->bitmapForRecycling[bitmapIndex];
 		newBitmap = setBitmapAtIndex(oldBitmap, bitmapOffset);
 		
-	} while ( !CAS_size_t( &oldBitmap, newBitmap, &(manager->statusFile_mmap_base->bitmapForRecycling[bitmapIndex]) ) );
+	} while ( !CAS_size_t( &oldBitmap, newBitmap, &(manager->status->bitmapForRecycling[bitmapIndex]) ) );
 	
 	return true;
 	
@@ -1430,7 +6700,7 @@ bool dumpWastedMemory(size_t wastedOffset, size_t parentINode)
 bool recycleWastedMemory(size_t *reusableOffset, size_t parentINode)
 {
 	
-	FAIL_IF(manager == NULL, "Global(manager) is NULL", false);
+	FAIL_IF(manager == NULL, ERROR_NO_MANAGER, "Global(manager) is NULL", false);
 	
 	int i;
 	size_t oldBitmap, newBitmap, parentINodeOfDumper;
@@ -1442,13 +6712,13 @@ bool recycleWastedMemory(size_t *reusableOffset, size_t parentINode)
 	{
 		isEmpty = true;
 		
-		for (i = 0 ; i < DUMP_YARD_SIZE ; ++i)
+		for (i = 0 ; (size_t)i < options.dumpYardSize ; ++i)
 		{
 			
 			bitmapIndex  = i / NO_OF_BITS;
 			bitmapOffset = i % NO_OF_BITS;
 			
-			oldBitmap = manager->statusFile_mmap_base->bitmapForRecycling[bitmapIndex];
+			oldBitmap = manager->status->bitmapForRecycling[bitmapIndex];
 			
 			if (getBitmapAtIndex(oldBitmap, bitmapOffset) == true)
 			{
@@ -1460,27 +6730,41 @@ bool recycleWastedMemory(size_t *reusableOffset, size_t parentINode)
 		
 		//Wasted memory dump yard empty
 		if (isEmpty)
+		{
+			PROBE1(recycle__miss, parentINode);
 			return false;
+		}
 		
-	} while( !CAS_size_t( &oldBitmap, newBitmap, &(manager->statusFile_mmap_base->bitmapForRecycling[bitmapIndex]) ) );
+	} while( !CAS_size_t( &oldBitmap, newBitmap, &(manager->status->bitmapForRecycling[bitmapIndex]) ) );
 	
-	*reusableOffset	    = manager->statusFile_mmap_base->wastedMemoryDumpYard[i];
-	parentINodeOfDumper = manager->statusFile_mmap_base->parentINodesOfDumper[i];
-	manager->statusFile_mmap_base->wastedMemoryDumpYard[i] = 0;
+	*reusableOffset	    = manager->status->wastedMemoryDumpYard[i];
+	parentINodeOfDumper = manager->status->parentINodesOfDumper[i];
+	manager->status->wastedMemoryDumpYard[i] = 0;
 	
 	do
 	{
-		oldBitmap = manager->statusFile_mmap_base->bitmapForDumping[bitmapIndex];
+		oldBitmap = manager->status->bitmapForDumping[bitmapIndex];
 		newBitmap = unsetBitmapAtIndex(oldBitmap, bitmapOffset);
 		
-	} while ( !CAS_size_t( &oldBitmap, newBitmap, &(manager->statusFile_mmap_base->bitmapForDumping[bitmapIndex]) ) );
+	} while ( !CAS_size_t( &oldBitmap, newBitmap, &(manager->status->bitmapForDumping[bitmapIndex]) ) );
+	
+	//Dumped before __dtsharedmemory_compact() retired its region, so it is dropped
+	if (isRetired(*reusableOffset))
+	{
+		PROBE1(recycle__miss, parentINode);
+		return false;
+	}
 	
 	if (parentINode == parentINodeOfDumper)
 	{
 		dumpWastedMemory(*reusableOffset - 1, parentINode);
+		
+		PROBE1(recycle__miss, parentINode);
 		return false;
 	}
 	
+	PROBE2(recycle, *reusableOffset, parentINode);
+	
 	return true;
 	
 }
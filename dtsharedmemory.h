@@ -51,16 +51,31 @@ FILE *__darwintrace_stderr = NULL;
 #endif
 
 
-//For debugging purposes
-#define DISABLE_DUMPING_AND_RECYCLING (0)
+//For debugging purposes, DISABLE_DUMPING_AND_RECYCLING can also be given while compiling
+#ifndef DISABLE_DUMPING_AND_RECYCLING
+#	define DISABLE_DUMPING_AND_RECYCLING (0)
+#endif
 #define DISABLE_MEMORY_EXPANSION      (0)
 //Instead of disabling DISABLE_MEMORY_EXPANSION, a better idea is to
 //take INITIAL_FILE_SIZE big enough such that expansion isn't needed
 
+//Every counter behind __dtsharedmemory_get_stats() costs an atomic add, make it 1 to drop them
+#ifndef DISABLE_STATISTICS
+#	define DISABLE_STATISTICS (0)
+#endif
+
 
 //If __darwintrace_stderr is set as stderr, it can cause conflicts with installation.
 //See proc.c
-#define	DEBUG_MESSAGES_ALLOWED (1)
+//Failures are always recorded without any I/O, see __dtsharedmemory_get_last_error().
+//Printing them as well is opt-in at run time, see __dtsharedmemory_set_debug_messages().
+//-D DEBUG_MESSAGES_ALLOWED=0 leaves the printing out of the build.
+#ifndef DEBUG_MESSAGES_ALLOWED
+#	define DEBUG_MESSAGES_ALLOWED (1)
+#endif
+
+//Set by __dtsharedmemory_set_debug_messages(), false by default
+extern bool __dtsharedmemory_are_debug_messages_on;
 
 
 
@@ -72,26 +87,33 @@ FILE *__darwintrace_stderr = NULL;
 
 
 #if (DEBUG_MESSAGES_ALLOWED && 1) && (DEBUG_PRINT_MESSAGES && 1)
-#	define print_error(errorDescription) fprintf((!__darwintrace_stderr ? stderr : __darwintrace_stderr), "%s : func(%s) : %s : %s\n", __FILE__, __func__, errorDescription, strerror(errno));
+#	define print_error(errorDescription) if (__dtsharedmemory_are_debug_messages_on) fprintf((!__darwintrace_stderr ? stderr : __darwintrace_stderr), "%s : func(%s) : %s : %s\n", __FILE__, __func__, errorDescription, strerror(errno));
 #else
 #	define print_error(errorDescription)
 #endif
 
 
 
+/*
+ *	`error` is one of ERROR_INVALID_ARGUMENT ... ERROR_INTERNAL, recorded by recordError()
+ *	in dtsharedmemory.c along with `message`, which has to be a string literal.
+ */
 #if (DEBUG_MESSAGES_ALLOWED && 1) && (DEBUG_FAIL_MESSAGES && 1)
 /*Empty comments are placed all over to avoid crazy indentation caused by auto-indent on macro definitions*/
-#	define FAIL_IF(condition, message, returnVal) \
+#	define FAIL_IF(condition, error, message, returnVal) \
 \
 /**/	if((condition)){\
-/**/		fprintf((!__darwintrace_stderr ? stderr : __darwintrace_stderr), "%s : func(%s) : %s : %s\n", __FILE__, __func__, message, strerror(errno));\
+/**/		recordError(error, __func__, message);\
+/**/		if (__dtsharedmemory_are_debug_messages_on)\
+/**/			fprintf((!__darwintrace_stderr ? stderr : __darwintrace_stderr), "%s : func(%s) : %s : %s\n", __FILE__, __func__, message, strerror(errno));\
 /**/		return returnVal;\
 /**/	}
 
 #else
 
-#	define FAIL_IF(condition, message, returnVal) \
+#	define FAIL_IF(condition, error, message, returnVal) \
 /**/	if((condition)){\
+/**/		recordError(error, __func__, message);\
 /**/		return returnVal;\
 /**/	}
 
@@ -136,60 +158,263 @@ FILE *__darwintrace_stderr = NULL;
 
 
 /*
- *	EXPANDING_SIZE should be big enough such that newSize is never made less than
- *	the current file size by truncate(2) and will also cause other problems.
- *
- *	After testing till now, at least 20 MB expanding size seems necessary for the library
- *	to function correctly.
+ *	Only one process grows the file at a time (see expandSharedMemory() in dtsharedmemory.c),
+ *	so the file never shrinks whatever EXPANDING_SIZE is. It is the least the file
+ *	is grown by, while a big file is grown by GROWTH_PERCENT of its size instead, so that
+ *	the number of expansions (and `mappings`) is logarithmic in the size it ends up with.
+ *	These are only the defaults of `struct SharedMemoryOptions`, which are taken once
+ *	while attaching.
  *
  */
 #define INITIAL_FILE_SIZE  MB(20) //Keep it greater than sizeof(CNode)+sizeof(INode)
 
 #define EXPANDING_SIZE    (MB(10) * sysconf(_SC_NPROCESSORS_ONLN))
-//EXPANDING_SIZE should vary accordingly with number of processors and processing speed.
-//The bigger factor is number of processors, which has been considered above.
+
+#ifndef GROWTH_PERCENT
+#	define GROWTH_PERCENT (50)
+#endif
+
+//Every expansion maps the file again and the old mappings are kept, as other threads may
+//still be using them. So shared memory file can only be expanded MAX_MAPPINGS - 1 times.
+#define MAX_MAPPINGS 1024
+//EXPANDING_SIZE varies with number of processors, as more of them fill the file faster.
+
+
+
+/*
+ *	If not 0, the used shared memory is not allowed to grow beyond SHARED_MEMORY_CAP bytes
+ *	and the shared memory file isn't expanded much beyond it either.
+ *	When an insertion needs more memory, paths that haven't been searched for a while
+ *	are evicted and their memory is reused (see evictColdPaths() in dtsharedmemory.c).
+ *	If nothing can be evicted, the insertion fails and the path simply isn't cached.
+ *	Keep it a few times bigger than EXPANDING_SIZE. INITIAL_FILE_SIZE shouldn't be
+ *	bigger than it, as the file never shrinks.
+ *	Can be given while compiling, e.g., -D SHARED_MEMORY_CAP=MB(64)
+ */
+#ifndef SHARED_MEMORY_CAP
+#	define SHARED_MEMORY_CAP (0)
+#endif
+
+#if SHARED_MEMORY_CAP && DISABLE_DUMPING_AND_RECYCLING
+#	error SHARED_MEMORY_CAP needs DISABLE_DUMPING_AND_RECYCLING to be 0 to reuse evicted memory.
+#endif
+
+/*
+ *	If not 0, shared memory file is mapped only once, RESERVED_MAPPING_GB gigabytes long,
+ *	however small the file is. The file is grown before any offset beyond it is handed out
+ *	by reserveSpaceInSharedMemory(), so no page beyond the end of the file is ever touched.
+ *	GOTO_OFFSET() then is just `base + offset`, without any bounds check or remapping.
+ *	Only address space is taken, so it can be large, but it has to cover every offset
+ *	that can be used (4 GB without LARGE_MEMORY_NEEDED, SHARED_MEMORY_CAP if set).
+ *	Can be given while compiling, e.g., -D RESERVED_MAPPING_GB=16
+ */
+#ifndef RESERVED_MAPPING_GB
+#	define RESERVED_MAPPING_GB (0)
+#endif
+
+#if RESERVED_MAPPING_GB && !defined(__LP64__)
+#	error RESERVED_MAPPING_GB needs a 64 bit address space.
+#endif
+
+#define RESERVED_MAPPING_SIZE GB(RESERVED_MAPPING_GB)
+
+
+
+/*
+ *	Defaults of __dtsharedmemory_set_mapping_advice().
+ *	The first PREFAULT_SIZE bytes of the ctrie (and the header) are faulted in
+ *	when shared memory file is mapped, where the root and the top levels
+ *	which every search walks through are. If ADVISE_RANDOM_TAIL is 1, the kernel
+ *	is told the rest of the mapping is read randomly, so it doesn't read ahead.
+ *	Can be given while compiling, e.g., -D PREFAULT_SIZE=MB(1)
+ */
+#ifndef PREFAULT_SIZE
+#	define PREFAULT_SIZE (0)
+#endif
+
+#ifndef ADVISE_RANDOM_TAIL
+#	define ADVISE_RANDOM_TAIL (0)
+#endif
+
+
+
+/*
+ *	If not 0, the nodes for the first HOT_LEVELS characters of paths are placed in
+ *	a region of HOT_REGION_SIZE bytes right after the root, instead of wherever
+ *	the next free space happens to be. Every search walks through these nodes, so
+ *	they then take a few pages which stay cached, rather than a page each.
+ *	CNodes replaced in the region are reused only by the INodes in it. Once the region
+ *	is full, nodes are placed like any other. Needs the stack of freed CNodes
+ *	(a 64 bit machine and dumping and recycling enabled).
+ *	Can be given while compiling, e.g., -D HOT_LEVELS=16
+ */
+#ifndef HOT_LEVELS
+#	define HOT_LEVELS (0)
+#endif
+
+#ifndef HOT_REGION_SIZE
+#	define HOT_REGION_SIZE KB(512)
+#endif
+
+/*
+ *	If not 0, every path carries a value of VALUE_SIZE bytes along with its flags, e.g., the
+ *	port owning it, written by __dtsharedmemory_insert_value() and read along with the flags
+ *	by __dtsharedmemory_search_value(). Every CNode grows by VALUE_SIZE bytes.
+ *	Can be given while compiling, e.g., -D VALUE_SIZE=16
+ */
+#ifndef VALUE_SIZE
+#	define VALUE_SIZE (0)
+#endif
+
+#if VALUE_SIZE % 8
+#	error VALUE_SIZE has to be a multiple of 8.
+#endif
+
+//Longest path that can be evicted, also the size of the CLOCK hand in the status header
+#define CLOCK_HAND_SIZE 1024
+
+//Size of the name given to __dtsharedmemory_set_namespace(), including '\0'
+#define NAMESPACE_SIZE 64
+
+//Number of subtrees detached by removals that can wait in the status header to be reclaimed
+#define DETACHED_SUBTREE_SLOTS 64
+
+//Atomics written by many processes are kept on separate cache lines
+#define CACHE_LINE_SIZE 64
+#define CACHE_ALIGNED   __attribute__((aligned(CACHE_LINE_SIZE)))
+
+/*
+ *	Slots in the status header counting the operations of each process that may still be
+ *	reading the ctrie, see `readers`. The last slot is shared by the processes which don't
+ *	get one of their own. Each slot takes a cache line: its pid, then the number of operations
+ *	which started while `compactions` / 2 was even, then the number of those which started
+ *	while it was odd.
+ */
+#define READER_SLOTS      64
+#define READER_SLOT_WORDS (CACHE_LINE_SIZE / sizeof(size_t))
+#define READER_PID        0
+#define READER_ACTIVE     1
+
+
+/*
+ *	Counters kept in the status header, see `struct SharedMemoryStats` for what they count.
+ *	Each thread adds to one of STATS_SHARDS copies of them, so that all the threads
+ *	of all the processes don't keep fighting over the same cache line.
+ *	The counters of a shard are padded up to a multiple of 64 bytes for the same reason.
+ */
+enum
+{
+	STAT_SEARCHES,
+	STAT_SEARCH_HITS,
+	STAT_PREFIX_HITS,
+	STAT_INSERTS,
+	STAT_INSERT_RETRIES,
+	STAT_GUARD_RETRIES,
+	STAT_RECYCLE_HITS,
+	STAT_RECYCLE_MISSES,
+	STAT_DUMP_YARD_FULL,
+	STAT_EXPANSIONS,
+	NUMBER_OF_STATS
+};
+
+#define STATS_SHARDS    16
+#define STATS_PER_SHARD (((NUMBER_OF_STATS * sizeof(size_t) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE) * (CACHE_LINE_SIZE / sizeof(size_t)))
+
+
+
+/*
+ *	If not 0, one in every LATENCY_SAMPLING calls to __dtsharedmemory_search() and
+ *	__dtsharedmemory_insert() made by a thread is timed and counted in a histogram
+ *	in the status header, see __dtsharedmemory_get_latency_percentile().
+ *	Can be given while compiling, e.g., -D LATENCY_SAMPLING=64
+ *
+ *	The histogram has 8 buckets for every power of 2 nanoseconds (log-linear),
+ *	so a latency is known within 12.5% from 8 ns up to more than an hour.
+ */
+#ifndef LATENCY_SAMPLING
+#	define LATENCY_SAMPLING (0)
+#endif
+
+#define LATENCY_BUCKETS 320
+
+enum
+{
+	LATENCY_OF_SEARCH,
+	LATENCY_OF_INSERT,
+	NUMBER_OF_LATENCIES
+};
+
+
+
+/*
+ *	Reasons of failure, see `struct SharedMemoryError`.
+ *	__dtsharedmemory_get_error_name() gives their names.
+ */
+enum
+{
+	ERROR_NONE,
+	ERROR_INVALID_ARGUMENT,  //Including NULL arguments
+	ERROR_INVALID_CHARACTER, //Below LOWER_LIMIT or above UPPER_LIMIT
+	ERROR_NO_MANAGER,        //__dtsharedmemory_set_manager() not called or failed
+	ERROR_SYSTEM_CALL,       //`savedErrno` tells why
+	ERROR_OUT_OF_MEMORY,     //Shared memory file can't grow, or nothing could be evicted
+	ERROR_INITIALISATION,    //Shared memory file couldn't be set up or has another layout
+	ERROR_BAD_OFFSET,        //An offset pointed outside of shared memory file
+	ERROR_CALL_FAILED,       //A function called failed, the errors recorded before tell why
+	ERROR_INTERNAL,
+	NUMBER_OF_ERRORS
+};
+
+//Failures remembered per thread, the oldest ones are overwritten
+#define ERROR_RING_SIZE 16
 
 
 struct SharedMemoryStatus;
 
 
 /*
- *	#Member1(sharedMemoryFile_mmap_base):
- *		This stores the base address obtained by mmap(2) call on shared memory file.
+ *	A mapping of shared memory file. Once published it is never changed or unmapped,
+ *	as other threads may still be using it. See `mappings` in dtsharedmemory.c.
+ *
+ *	#Member1(base):
+ *		This stores the base address obtained by mmap(2) call on shared memory file
+ *		plus HEADER_SIZE, i.e., where the ctrie starts.
  *		Also gcc and clang allow void * arithemetic, so any offset can simply be accessed as
- *		*(sharedMemoryFile_mmap_base + offset).
+ *		*(base + offset).
  *
- *	#Member2(sharedMemoryFile_mapping_size):
- *		Size of the shared memory file mapping.
+ *	#Member2(size):
+ *		Size of the mapping without the header.
  *
- *	#Member3(sharedMemoryFile_name):
+ */
+struct SharedMemoryMapping{
+	
+	void * base;
+	size_t size;
+	
+};
+
+
+/*
+ *	There is a single one per process, it isn't allocated. Only __dtsharedmemory_reset_fd()
+ *	changes it after __dtsharedmemory_set_manager(), the mapping of shared memory file
+ *	is kept separately as it changes with every expansion.
+ *
+ *	#Member1(sharedMemoryFile_name):
  *		Name of file that is to be used for storing paths in a ctrie data structure.
  *
- *	#Member4(sharedMemoryFile_fd):
+ *	#Member2(sharedMemoryFile_fd):
  *		File descriptor of shared memory file.
  *
- *	#Member5(statusFile_mmap_base):
- *		This stores the base address obtained by mmap(2) call on shared memory status file.
- *
- *	#Member6(statusFile_fd):
- *		File descriptor of shared memory status file.
- *
- *	#Member7(statusFile_name):
- *		Name of shared memory status file.
+ *	#Member3(status):
+ *		`status` in the header of shared memory file, in the first mapping of it,
+ *		which is never unmapped.
  *
  */
 struct SharedMemoryManager{
 	
-	//shared memory file
-	void *       sharedMemoryFile_mmap_base;
-	size_t       sharedMemoryFile_mapping_size;
-	const char * sharedMemoryFile_name;
-	int          sharedMemoryFile_fd;
-	
-	//status file
-	struct	SharedMemoryStatus * statusFile_mmap_base;
-	int                          statusFile_fd;
-	const char *                 statusFile_name;
+	const char *                 sharedMemoryFile_name;
+	int                          sharedMemoryFile_fd;
+	struct	SharedMemoryStatus * status;
 	
 };
 
@@ -203,6 +428,8 @@ struct SharedMemoryManager{
  *	#Member2(sharedMemoryFileSize)
  *		Size of the file mapped into the process. New threads that call openSharedMemoryFile()
  *		use this file size for mmap(2).
+ *		`growingProcess` next to it holds the pid of the process growing the file,
+ *		0 if none is (see expandSharedMemory() in dtsharedmemory.c).
  *
  *	The members after this are used in dumping and recycling of wasted memory.
  *
@@ -262,6 +489,100 @@ struct SharedMemoryManager{
  *	size_t is being used as data type of bitmap because it gets
  *	largest possible unsigned integer (32 bit or 64 bit).
  *
+ *	#Member7(freedCNodes):
+ *		Top of a stack of CNodes that belonged to INodes removed by
+ *		__dtsharedmemory_remove() or __dtsharedmemory_remove_prefix().
+ *		A removed INode never changes again (unless it is recycled, see `freedINodes`),
+ *		so unlike `wastedMemoryDumpYard[]`, these CNodes can be reused by any INode
+ *		and the stack has no size limit.
+ *		The first bytes of every freed CNode store the offset to the next one.
+ *
+ *	#Member8(evictingProcess):
+ *		Only when SHARED_MEMORY_CAP is not 0.
+ *		pid of the process which is evicting paths, 0 if none is.
+ *		Only one thread evicts at a time, if the process dies meanwhile,
+ *		another one takes over.
+ *
+ *	#Member9(clockHand):
+ *		Only when SHARED_MEMORY_CAP is not 0.
+ *		The path at which the last eviction stopped. The next eviction continues
+ *		with the paths that come after it in lexicographic order, going round
+ *		the ctrie like the hand of a clock.
+ *
+ *	#Member10(freedINodes):
+ *		Only when SHARED_MEMORY_CAP is not 0.
+ *		Top of a stack of INodes taken out of the ctrie, tagged like `freedCNodes`.
+ *		Each element is a freed CNode holding the offsets to many such INodes,
+ *		see freeINode() in dtsharedmemory.c.
+ *
+ *	#Member11(generation):
+ *		Number of times __dtsharedmemory_reset() removed something.
+ *		Processes can compare it with an earlier value to know that the paths they
+ *		inserted before may be gone.
+ *
+ *	#Member12(hotRegionUsed):
+ *		Only when HOT_LEVELS is not 0.
+ *		Bytes of the hot region handed out so far, see HOT_LEVELS.
+ *
+ *	#Member13(freedHotCNodes):
+ *		Only when HOT_LEVELS is not 0.
+ *		Same as `freedCNodes`, for the CNodes freed in the hot region.
+ *		They are only taken for INodes in the hot region.
+ *
+ *	#Member14(compactions):
+ *		Only when SHARED_MEMORY_CAP is 0.
+ *		Incremented when __dtsharedmemory_compact() starts copying the ctrie and again
+ *		when it is done, so it is odd meanwhile. Insertions and removals wait while it is odd
+ *		and are made again if it changed while they were being made.
+ *
+ *	#Member15(compactingProcess):
+ *		Only when SHARED_MEMORY_CAP is 0.
+ *		pid of the process which is compacting, 0 if none is. Like `evictingProcess`,
+ *		it is taken over if its process dies.
+ *
+ *	#Member16(retiredStart), #Member17(retiredEnd):
+ *		Only when SHARED_MEMORY_CAP is 0.
+ *		The region used before the last compaction, which isn't reused until no operation
+ *		that started before the copy is left, see `readers`. `retiredEnd` is 0 if there is none.
+ *		They are only written while `compactions` is odd, except `retiredEnd` being set to 0,
+ *		and `retiredEnd` is set last, so that isRetired() can read them consistently.
+ *		With HOT_LEVELS the whole hot region is retired along with them.
+ *
+ *	#Member18(readers):
+ *		Only when SHARED_MEMORY_CAP is 0.
+ *		READER_SLOTS slots, one for each process using the shared memory, counting its
+ *		searches, insertions and removals under way by the parity of `compactions` / 2 when
+ *		they started. The region retired by a compaction is only reused once no live process
+ *		has any operation left from before the copy. Slots of dead processes are skipped and given up.
+ *
+ *	#Member19(copyStart), #Member20(copyEnd):
+ *		Only when SHARED_MEMORY_CAP is 0.
+ *		Where the last compaction copied the ctrie to, which isn't retired even though
+ *		it may be in the middle of the retired region.
+ *
+ *	#Member21(holeStart), #Member22(holeEnd):
+ *		Only when SHARED_MEMORY_CAP is 0.
+ *		The bigger part of the last retired region, left empty for the next compaction to
+ *		copy the ctrie to, so that compactions don't keep growing the file.
+ *
+ *	#Member23(detachedSubtreeCount):
+ *		Number of INodes in `detachedSubtrees`, counted before they are put in and after
+ *		they are taken out, so that it is never lower. Lets insertions skip looking at them.
+ *
+ *	#Member24(detachedSubtrees):
+ *		INodes detached from the ctrie by __dtsharedmemory_remove_prefix() and
+ *		__dtsharedmemory_reset(), 0 where there is none. Each one is tombed later by an insertion
+ *		or a compaction, see reclaimDetachedSubtrees() in dtsharedmemory.c, and the INodes
+ *		below it take its place.
+ *
+ *	#Member25(stats):
+ *		Only when DISABLE_STATISTICS is 0.
+ *		Counters summed up by __dtsharedmemory_get_stats(), see STATS_SHARDS.
+ *
+ *	#Member26(latencies):
+ *		Only when LATENCY_SAMPLING is not 0.
+ *		Histogram of the sampled latencies of each operation, see LATENCY_BUCKETS.
+ *
  *	This feature of dumping and recycling drops more than half of memory usage.
  *	Without dumping and recyclying, if the memory usage was "12MB", it drops to almost
  *	"6MB" when using dumping and recycling.
@@ -270,7 +591,10 @@ struct SharedMemoryManager{
 struct SharedMemoryStatus
 {
 	
-#define DUMP_YARD_SIZE 64
+	//The most slots `dumpYardSize` of `struct SharedMemoryOptions` can ask for
+#ifndef DUMP_YARD_SIZE
+#	define DUMP_YARD_SIZE 64
+#endif
 	
 	/*
 	 *	The bitmap may need to store more than NO_OF_BITS bits. A size_t can only store
@@ -288,20 +612,76 @@ struct SharedMemoryStatus
 	
 #	ifdef HAVE_STDATOMIC_H
 	
-	_Atomic(size_t) writeFromOffset;
-	_Atomic(size_t) sharedMemoryFileSize;
+	_Atomic(size_t) writeFromOffset       CACHE_ALIGNED;
+	_Atomic(size_t) sharedMemoryFileSize  CACHE_ALIGNED;
+	_Atomic(size_t) growingProcess;
 	
-	_Atomic(size_t) bitmapForDumping      [DUMP_YARD_BITMAP_ARRAY_SIZE];
+	_Atomic(size_t) bitmapForDumping      [DUMP_YARD_BITMAP_ARRAY_SIZE] CACHE_ALIGNED;
 	_Atomic(size_t) bitmapForRecycling    [DUMP_YARD_BITMAP_ARRAY_SIZE];
 	
+	_Atomic(size_t) freedCNodes           CACHE_ALIGNED;
+	_Atomic(size_t) generation;
+	
+#		if SHARED_MEMORY_CAP
+	_Atomic(size_t) evictingProcess;
+	_Atomic(size_t) freedINodes;
+#		endif
+	
+#		if HOT_LEVELS
+	_Atomic(size_t) hotRegionUsed         CACHE_ALIGNED;
+	_Atomic(size_t) freedHotCNodes;
+#		endif
+	
+#		if !(SHARED_MEMORY_CAP)
+	_Atomic(size_t) compactions           CACHE_ALIGNED;
+	_Atomic(size_t) compactingProcess;
+	_Atomic(size_t) retiredStart;
+	_Atomic(size_t) retiredEnd;
+	_Atomic(size_t) copyStart;
+	_Atomic(size_t) copyEnd;
+	_Atomic(size_t) holeStart;
+	_Atomic(size_t) holeEnd;
+	_Atomic(size_t) readers               [READER_SLOTS][READER_SLOT_WORDS] CACHE_ALIGNED;
+#		endif
+	
 #	else
 	
-	size_t          writeFromOffset;
-	size_t          sharedMemoryFileSize;
+	size_t          writeFromOffset       CACHE_ALIGNED;
+	size_t          sharedMemoryFileSize  CACHE_ALIGNED;
+	size_t          growingProcess;
 	
-	size_t          bitmapForDumping      [DUMP_YARD_BITMAP_ARRAY_SIZE];
+	size_t          bitmapForDumping      [DUMP_YARD_BITMAP_ARRAY_SIZE] CACHE_ALIGNED;
 	size_t          bitmapForRecycling    [DUMP_YARD_BITMAP_ARRAY_SIZE];
 	
+	size_t          freedCNodes           CACHE_ALIGNED;
+	size_t          generation;
+	
+#		if SHARED_MEMORY_CAP
+	size_t          evictingProcess;
+	size_t          freedINodes;
+#		endif
+	
+#		if HOT_LEVELS
+	size_t          hotRegionUsed         CACHE_ALIGNED;
+	size_t          freedHotCNodes;
+#		endif
+	
+#		if !(SHARED_MEMORY_CAP)
+	size_t          compactions           CACHE_ALIGNED;
+	size_t          compactingProcess;
+	size_t          retiredStart;
+	size_t          retiredEnd;
+	size_t          copyStart;
+	size_t          copyEnd;
+	size_t          holeStart;
+	size_t          holeEnd;
+	size_t          readers               [READER_SLOTS][READER_SLOT_WORDS] CACHE_ALIGNED;
+#		endif
+	
+#	endif
+	
+#	if SHARED_MEMORY_CAP
+	char            clockHand [CLOCK_HAND_SIZE];
 #	endif
 	
 
@@ -311,41 +691,260 @@ struct SharedMemoryStatus
 	
 #	ifdef HAVE_STDATOMIC_H
 	
-	_Atomic(size_t) writeFromOffset;
-	_Atomic(size_t)	sharedMemoryFileSize;
+	_Atomic(size_t) writeFromOffset       CACHE_ALIGNED;
+	_Atomic(size_t)	sharedMemoryFileSize  CACHE_ALIGNED;
+	_Atomic(size_t) growingProcess;
+	_Atomic(size_t) generation;
 	
 #	else
 	
-	size_t          writeFromOffset;
-	size_t          sharedMemoryFileSize;
+	size_t          writeFromOffset       CACHE_ALIGNED;
+	size_t          sharedMemoryFileSize  CACHE_ALIGNED;
+	size_t          growingProcess;
+	size_t          generation;
 	
 #	endif
 	
 
 #endif
 	
+#ifdef HAVE_STDATOMIC_H
+	_Atomic(size_t) detachedSubtreeCount  CACHE_ALIGNED;
+	_Atomic(size_t) detachedSubtrees      [DETACHED_SUBTREE_SLOTS];
+#else
+	size_t          detachedSubtreeCount  CACHE_ALIGNED;
+	size_t          detachedSubtrees      [DETACHED_SUBTREE_SLOTS];
+#endif
+	
+#if !(DISABLE_STATISTICS)
+#	ifdef HAVE_STDATOMIC_H
+	_Atomic(size_t) stats [STATS_SHARDS][STATS_PER_SHARD];
+#	else
+	size_t          stats [STATS_SHARDS][STATS_PER_SHARD];
+#	endif
+#endif
+	
+#if LATENCY_SAMPLING
+#	ifdef HAVE_STDATOMIC_H
+	_Atomic(size_t) latencies [NUMBER_OF_LATENCIES][LATENCY_BUCKETS];
+#	else
+	size_t          latencies [NUMBER_OF_LATENCIES][LATENCY_BUCKETS];
+#	endif
+#endif
+	
 };
 
 
 
 /**
  *
- *	This function allocates memory for a the Global(manager).
- *	It opens status file and shared memory file by calling
- *	openStatusFile() and openSharedMemoryFile().
- *	Those 2 functions set the manager's members to appropriate values.
+ *	Options for __dtsharedmemory_set_manager_ex(). A member left 0 takes its default.
+ *
+ *	#Member1(initialFileSize):
+ *		Size a new shared memory file is created with, without its header.
+ *		Default INITIAL_FILE_SIZE.
+ *
+ *	#Member2(expandingSize):
+ *		The least the file is grown by. Default EXPANDING_SIZE.
+ *
+ *	#Member3(growthPercent):
+ *		The file is grown by this percent of its size if that is more than `expandingSize`.
+ *		Default GROWTH_PERCENT.
+ *
+ *	#Member4(maxFileSize):
+ *		The file isn't grown beyond this size, without its header. Insertions which need more
+ *		fail, recording ERROR_OUT_OF_MEMORY. By default it is only limited by RESERVED_MAPPING_GB.
+ *
+ *	#Member5(dumpYardSize):
+ *		Slots of the dump yard which are used, up to DUMP_YARD_SIZE, the default.
+ *		Fewer are scanned faster by dumping and recycling but keep fewer CNodes for reuse.
+ *
+ *	#Member6(compaction):
+ *		1 to let __dtsharedmemory_compact() be used on the file. Every search, insertion and
+ *		removal is then counted in the status header, so that the region the ctrie is copied
+ *		from isn't reused while it may still be read. Default 0, nothing is counted.
+ *
+ **/
+struct SharedMemoryOptions
+{
+	size_t initialFileSize;
+	size_t expandingSize;
+	size_t growthPercent;
+	size_t maxFileSize;
+	size_t dumpYardSize;
+	size_t compaction;
+};
+
+
+
+/**
+ *
+ *	Shared memory file starts with this header, HEADER_SIZE bytes long, which is
+ *	followed by the ctrie. Offsets are counted from the end of the header, so the root
+ *	INode still is at offset 0.
+ *	The layout of the file depends on how the library was built, so the first process
+ *	writes it down here and every process attaching later checks it is the same before
+ *	using the file (see setUpHeader() in dtsharedmemory.c).
+ *
+ *	#Member1(magic):
+ *		HEADER_MAGIC once the header is written, HEADER_BEING_WRITTEN while it is being
+ *		written and 0 in a file that has just been created.
+ *
+ *	#Member2(layoutVersion):
+ *		LAYOUT_VERSION, to be incremented whenever the format of the file changes.
+ *
+ *	#Member3(headerSize), #Member4(statusSize), #Member5(iNodeSize), #Member6(cNodeSize):
+ *		Sizes of the header, `status`, an INode and a CNode.
+ *
+ *	#Member7(lowerLimit), #Member8(upperLimit):
+ *		LOWER_LIMIT and UPPER_LIMIT, which decide what an index of a CNode means.
+ *
+ *	#Member9(layoutFlags):
+ *		LAYOUT_* flags for the build flags changing what the nodes mean.
+ *
+ *	#Member10(sharedMemoryCap):
+ *		SHARED_MEMORY_CAP.
+ *
+ *	#Member11(hotRegionSize):
+ *		HOT_REGION_SIZE, or 0 if HOT_LEVELS is 0.
+ *
+ *	#Member12(valueSize):
+ *		VALUE_SIZE.
+ *
+ *	#Member13(options):
+ *		`struct SharedMemoryOptions` the file was made with, with defaults in place of 0s,
+ *		which every process attaching to it takes (see __dtsharedmemory_set_manager_ex()).
+ *
+ *	#Member14(status):
+ *		What the library keeps track of for the ctrie, see `struct SharedMemoryStatus`,
+ *		called the status header elsewhere.
+ *
+ **/
+#define HEADER_MAGIC          ((size_t)0x4454534D) //"DTSM"
+#define HEADER_BEING_WRITTEN  ((size_t)1)
+#define LAYOUT_VERSION        12
+
+#define LAYOUT_LARGE_MEMORY   (1 << 0)
+#define LAYOUT_NO_RECYCLING   (1 << 1)
+#define LAYOUT_FLAGS          ((LARGE_MEMORY_NEEDED ? LAYOUT_LARGE_MEMORY : 0) | \
+							   (DISABLE_DUMPING_AND_RECYCLING ? LAYOUT_NO_RECYCLING : 0))
+
+struct SharedMemoryHeader
+{
+	
+#ifdef HAVE_STDATOMIC_H
+	_Atomic(size_t) magic;
+#else
+	size_t          magic;
+#endif
+	
+	uint32_t        layoutVersion;
+	uint32_t        headerSize;
+	uint32_t        statusSize;
+	uint32_t        iNodeSize;
+	uint32_t        cNodeSize;
+	uint32_t        lowerLimit;
+	uint32_t        upperLimit;
+	uint32_t        layoutFlags;
+	uint64_t        sharedMemoryCap;
+	uint64_t        hotRegionSize;
+	uint64_t        valueSize;
+	
+	struct SharedMemoryOptions options;
+	
+	struct SharedMemoryStatus status CACHE_ALIGNED;
+	
+};
+
+#define LAYOUT_HOT_REGION_SIZE (HOT_LEVELS ? HOT_REGION_SIZE : 0)
+
+//Rounded up to 16 KB, the largest page size, so the ctrie starts on a page of its own
+#define HEADER_SIZE ((sizeof(struct SharedMemoryHeader) + KB(16) - 1) / KB(16) * KB(16))
+
+
+
+/**
+ *
+ *	This function sets up the Global(manager).
+ *	It opens shared memory file, creating it if needed, by calling openSharedMemoryFile(),
+ *	which sets the manager's members to appropriate values.
+ *	It fails if the file was made by a library built with a different layout
+ *	(see `struct SharedMemoryHeader`).
  *	This function would return if Global(manager) is not NULL.
  *
  *	Arguments:
  *
- *	#Arg1(status_file_name):
- *		Name of the status file.
+ *	#Arg1(shared_memory_file_name):
+ *		Name of the shared memory file
+ *
+ **/
+bool __dtsharedmemory_set_manager(const char *shared_memory_file_name);
+
+
+
+/**
+ *
+ *	Same as __dtsharedmemory_set_manager() but nothing is opened or mapped until
+ *	a function needing the shared memory (e.g., __dtsharedmemory_search() or
+ *	__dtsharedmemory_insert()) is called for the first time, so processes which never
+ *	search or insert don't pay for it. Only the name is copied, so it can't fail
+ *	but for an invalid name. If attaching later fails, those functions fail with
+ *	ERROR_NO_MANAGER and attaching isn't tried again.
+ *	__dtsharedmemory_getSharedMemoryFileFd() doesn't attach and returns -1 until then.
+ *	Attaching isn't async-signal-safe, so the first search shouldn't be made in a signal handler.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(shared_memory_file_name):
+ *		Name of the shared memory file, at most PATH_MAX - 1 characters.
  *
- *	#Arg2(shared_memory_file_name):
+ **/
+bool __dtsharedmemory_set_manager_lazily(const char *shared_memory_file_name);
+
+
+
+/**
+ *
+ *	Same as __dtsharedmemory_set_manager() but with `options` for how shared memory file
+ *	is created and grown. They only apply if this call sets Global(manager).
+ *	The options a file is made with are recorded in its header, so that every process
+ *	grows it alike. Members left 0 take the recorded ones, and it fails if any other
+ *	than `initialFileSize` is given a different one. Options fixing the layout of the
+ *	nodes (e.g., LARGE_MEMORY_NEEDED) are build flags checked against the header too.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(shared_memory_file_name):
  *		Name of the shared memory file
  *
+ *	#Arg2(options):
+ *		Options, or NULL for the defaults.
+ *
  **/
-bool __dtsharedmemory_set_manager(const char *status_file_name, const char *shared_memory_file_name);
+bool __dtsharedmemory_set_manager_ex(const char *shared_memory_file_name, const struct SharedMemoryOptions *options);
+
+
+
+/**
+ *
+ *	Sets how the mappings of shared memory file made from now on are advised, so
+ *	it has to be called before __dtsharedmemory_set_manager() to apply to the first one.
+ *	Short lived processes otherwise take a page fault on every page of the top levels
+ *	of the ctrie during their first searches. Mapping never fails because of it.
+ *	Defaults are PREFAULT_SIZE and ADVISE_RANDOM_TAIL.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(prefaultSize):
+ *		Bytes at the start of the ctrie which are faulted in with one madvise(2)
+ *		(MADV_POPULATE_READ, or only read ahead by MADV_WILLNEED where it isn't available).
+ *		0 to fault in nothing.
+ *
+ *	#Arg2(isTailRandom):
+ *		If true, the rest of the mapping is advised MADV_RANDOM.
+ *
+ **/
+void __dtsharedmemory_set_mapping_advice(size_t prefaultSize, bool isTailRandom);
 
 
 
@@ -385,16 +984,23 @@ typedef struct INode{
  *	Paths don't use ascii chars 0-31 and 128-256 generally, so no use of making such big nodes
  *	for rare cases. Bigger size of CNode means more time taken for insertion and also
  *	shared memory expands comparitively fast.
+ *	NAMESPACE_SEPARATOR, right after UPPER_LIMIT, takes one more entry. It can't be in a path
+ *	given by the user and only starts the keys of paths in a namespace (see keyForPath()).
  */
 #define LOWER_LIMIT 32	//inclusive
 #define UPPER_LIMIT 122	//inclusive
-#define POSSIBLE_CHARACTERS (UPPER_LIMIT - LOWER_LIMIT + 1) //The array size
+#define NAMESPACE_SEPARATOR (UPPER_LIMIT + 1)
+#define POSSIBLE_CHARACTERS (NAMESPACE_SEPARATOR - LOWER_LIMIT + 1) //The array size
 
 
 #if UPPER_LIMIT <= LOWER_LIMIT
 #	error 	Invalid range of possible characters. Reset UPPER_LIMIT and LOWER_LIMIT values.
 #endif
 
+#if UPPER_LIMIT >= 255
+#	error 	UPPER_LIMIT has to leave room for NAMESPACE_SEPARATOR.
+#endif
+
 
 
 /**
@@ -408,6 +1014,10 @@ typedef struct INode{
  *	#Member3(flags):
  *		These tells charactersistics associated with the path that has been inserted.
  *
+ *	#Member4(value):
+ *		Value of the path ending at this node, see VALUE_SIZE. It is written before the
+ *		node is published like the rest of it, so it is never changed in place.
+ *
  **/
 typedef struct CNode{
 	
@@ -420,6 +1030,10 @@ typedef struct CNode{
 	bool     isEndOfString;
 	uint8_t  flags;
 	
+#if VALUE_SIZE
+	uint8_t  value [VALUE_SIZE];
+#endif
+	
 }CNode;
 
 
@@ -473,8 +1087,9 @@ enum
  *
  *	This function inserts a string `path` along with `flags` into the shared memory.
  *	If insertion is successful, it returns true else false.
- *	The shared memory follows a ctrie data structure. Although it doesn't implement
- *	tomb nodes due to lack of need to remove nodes.
+ *	If `path` already exists with the same `flags`, nothing is written to the
+ *	shared memory and it simply returns true.
+ *	The shared memory follows a ctrie data structure.
  *
  *	Arguments:
  *
@@ -494,8 +1109,7 @@ bool __dtsharedmemory_insert(const char *path, uint8_t flags);
  *	This function searches for a string `path` in the shared memory.
  *	If found it returns true and sets the value of `flags`. Otherwise,
  *	it returns false.
- *	The shared memory follows a ctrie data structure. Although it doesn't implement
- *	tomb nodes due to lack of need to remove nodes.
+ *	The shared memory follows a ctrie data structure.
  *
  *	Arguments:
  *
@@ -511,15 +1125,356 @@ bool __dtsharedmemory_search(const char *path, uint8_t *flags);
 
 
 
+#if VALUE_SIZE
+/**
+ *
+ *	Same as __dtsharedmemory_insert() but `path` is given the VALUE_SIZE bytes at `value`
+ *	as its value too. __dtsharedmemory_insert() keeps the value a path already has and
+ *	gives a new one 0s. If `path` already exists with the same `flags` and value,
+ *	nothing is written to the shared memory.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(path):
+ *		Path to be inserted into shared memory.
+ *
+ *	#Arg2(flags):
+ *		Tell the characteristics of the path getting inserted.
+ *
+ *	#Arg3(value):
+ *		VALUE_SIZE bytes to be kept with the path.
+ *
+ **/
+bool __dtsharedmemory_insert_value(const char *path, uint8_t flags, const void *value);
+
+
+
+/**
+ *
+ *	Same as __dtsharedmemory_search() but the value of `path` is copied to `value` too.
+ *	It is read from the same node as `flags`, so both always come from the same insertion.
+ *	A path found as part of a prefix gets the value of the prefix.
+ *	`value` may have been written to even if it returns false.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(path):
+ *		Path to be searched in shared memory.
+ *
+ *	#Arg2(flags):
+ *		Tells the characteristics of the path.
+ *
+ *	#Arg3(value):
+ *		Where the VALUE_SIZE bytes of value of the path are copied.
+ *
+ **/
+bool __dtsharedmemory_search_value(const char *path, uint8_t *flags, void *value);
+#endif
+
+
+
+/**
+ *
+ *	This function removes a string `path`, inserted by __dtsharedmemory_insert(),
+ *	from the shared memory. Paths having `path` as a prefix are not affected.
+ *	It returns true if `path` existed and got removed, else false.
+ *	Nodes which are left with nothing to hold are removed as well
+ *	and their memory is reused by later insertions.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(path):
+ *		Path to be removed from shared memory. If `path` was inserted as a prefix,
+ *		it should be given without the ending '/'.
+ *
+ **/
+bool __dtsharedmemory_remove(const char *path);
+
+
+
+/**
+ *
+ *	This function removes `prefix` along with all the paths inside it,
+ *	i.e., all the paths that start with "`prefix`/".
+ *	e.g., removing "/usr/local" removes "/usr/local", "/usr/local/bin" and
+ *	"/usr/local/bin/ls" but not "/usr/localabc".
+ *	It returns true if anything got removed, else false.
+ *	The paths are unreachable as soon as it returns, but the memory they take is
+ *	reclaimed a little at a time by later insertions and compactions.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(prefix):
+ *		Prefix to be removed from shared memory. Ending '/' is ignored.
+ *
+ **/
+bool __dtsharedmemory_remove_prefix(const char *prefix);
+
+
+
+/**
+ *
+ *	This function makes the calling thread use the namespace `name` for all its later
+ *	insertions, searches and removals. Every namespace holds its own set of paths in the
+ *	same shared memory, e.g., one for the policy of each port, and paths of one
+ *	namespace are never seen from another one, nor from the default namespace.
+ *	Internally every path is prepended with NAMESPACE_SEPARATOR and `name`. So that
+ *	the name always ends where the path starts, paths of a namespace have to start with '/'
+ *	and `name` can't contain '/'. Paths of the default namespace have no such limit.
+ *	It returns false if `name` is not acceptable, else true.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(name):
+ *		Name of the namespace, shorter than NAMESPACE_SIZE and made of characters
+ *		between LOWER_LIMIT and UPPER_LIMIT other than '/'.
+ *		NULL or "" selects the default namespace, the one used if this function is never called.
+ *
+ **/
+bool __dtsharedmemory_set_namespace(const char *name);
+
+
+
+/**
+ *
+ *	This function removes all the paths of the current namespace
+ *	(see __dtsharedmemory_set_namespace()) in a single step, so that a new build
+ *	can start with an empty cache without recreating the status and shared memory files.
+ *	Other namespaces are not affected. For the default namespace, every path which isn't
+ *	in another namespace is removed, whatever it starts with.
+ *	If anything got removed, `generation` in the status header is incremented and true is returned,
+ *	else false. It takes the same time however many paths there are, their memory is
+ *	reclaimed later like for __dtsharedmemory_remove_prefix().
+ *
+ **/
+bool __dtsharedmemory_reset();
+
+
+
+/**
+ *
+ *	Returns the number of times __dtsharedmemory_reset() removed something from
+ *	the shared memory, or 0 if manager is NULL.
+ *
+ **/
+size_t __dtsharedmemory_get_generation();
+
+
+
+/**
+ *
+ *	This function copies the ctrie, all the namespaces, breadth-first into a new
+ *	contiguous region and switches the root INode to the copy with a single CAS.
+ *	Nodes the ctrie no longer reaches are left behind, so the copy is dense and
+ *	nodes used together are next to each other.
+ *	Searches go on meanwhile, while insertions and removals wait for the copy to be made.
+ *	The old region is reused by the next call made once every search, insertion and removal
+ *	which started before the copy is over, which doesn't copy the ctrie again: the bigger part
+ *	of it is kept for the next copy and the rest is handed out for new nodes.
+ *	It is meant to be called now and then, e.g., by a thread of the trace server.
+ *	It returns true if the ctrie got copied or the old region reused, false if another process
+ *	is compacting, the old region may still be read or the copy couldn't be made.
+ *	Only if the file is made with `compaction` in `struct SharedMemoryOptions`, and with
+ *	the stack of freed CNodes (a 64 bit machine and dumping and recycling enabled)
+ *	and without SHARED_MEMORY_CAP, otherwise it always fails.
+ *
+ **/
+bool __dtsharedmemory_compact();
+
+
+
+/**
+ *
+ *	Filled by __dtsharedmemory_get_stats(). The counts are of all the processes
+ *	since shared memory file was created.
+ *
+ *	#Member1(searches):
+ *		Calls to __dtsharedmemory_search().
+ *
+ *	#Member2(hits):
+ *		Searches that found the path, including `prefixHits`.
+ *
+ *	#Member3(misses):
+ *		Searches that didn't find the path, each of which generally costs
+ *		a round-trip to the trace server.
+ *
+ *	#Member4(prefixHits):
+ *		Searches that found a prefix of the path inserted with IS_PREFIX.
+ *
+ *	#Member5(inserts):
+ *		Calls to __dtsharedmemory_insert().
+ *
+ *	#Member6(insertRetries):
+ *		Times an insertion lost a CAS to another thread or found a removed node,
+ *		and had to try again.
+ *
+ *	#Member7(guardRetries):
+ *		Times a CNode got replaced while being read, see GUARD_CNODE_ACCESS in dtsharedmemory.c.
+ *
+ *	#Member8(recycleHits):
+ *		Copies of CNodes written into memory that was wasted or freed before.
+ *
+ *	#Member9(recycleMisses):
+ *		Copies of CNodes for which new memory had to be reserved.
+ *		The nodes of a new path are reserved all together and aren't counted.
+ *
+ *	#Member10(dumpYardFull):
+ *		Wasted CNodes that couldn't be dumped because `wastedMemoryDumpYard[]` was full.
+ *
+ *	#Member11(expansions):
+ *		Times the shared memory file was made bigger by expandSharedMemory().
+ *
+ *	#Member12(usedBytes):
+ *		Bytes of shared memory file handed out so far (`writeFromOffset` in the status header),
+ *		both to live nodes and to ones wasted later.
+ *
+ **/
+struct SharedMemoryStats
+{
+	size_t searches;
+	size_t hits;
+	size_t misses;
+	size_t prefixHits;
+	size_t inserts;
+	size_t insertRetries;
+	size_t guardRetries;
+	size_t recycleHits;
+	size_t recycleMisses;
+	size_t dumpYardFull;
+	size_t expansions;
+	size_t usedBytes;
+};
+
+
+
+/**
+ *
+ *	This function fills `stats` with the counters kept in the status header.
+ *	It returns false, leaving all of them 0, if manager is NULL or
+ *	the library was built with DISABLE_STATISTICS.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(stats):
+ *		Where the counters are written.
+ *
+ **/
+bool __dtsharedmemory_get_stats(struct SharedMemoryStats *stats);
+
+
+
+/**
+ *
+ *	This function returns the latency in nanoseconds below which `percentile` percent
+ *	of the sampled calls of `operation` completed, in all the processes since the status
+ *	file was created. It is the upper end of the histogram bucket, so it can be a little
+ *	(less than 12.5%) more than the real value.
+ *	It returns 0 if nothing has been sampled, manager is NULL or the library was
+ *	built without LATENCY_SAMPLING.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(operation):
+ *		LATENCY_OF_SEARCH or LATENCY_OF_INSERT.
+ *
+ *	#Arg2(percentile):
+ *		Between 0 and 100, e.g., 99.9
+ *
+ **/
+size_t __dtsharedmemory_get_latency_percentile(int operation, double percentile);
+
+
+
+/**
+ *
+ *	A failure of the library, recorded in a ring of ERROR_RING_SIZE per thread.
+ *	Recording it is a few stores, no allocation or I/O, so that rejected paths stay cheap.
+ *	A failure inside a function leads to a failure of each of its callers,
+ *	so a call usually leaves a chain of them, the innermost first.
+ *
+ *	#Member1(error):
+ *		ERROR_INVALID_ARGUMENT ... ERROR_INTERNAL.
+ *
+ *	#Member2(savedErrno):
+ *		`errno` when the failure was recorded, only meaningful for ERROR_SYSTEM_CALL.
+ *
+ *	#Member3(function):
+ *		Name of the function which failed.
+ *
+ *	#Member4(message):
+ *		What went wrong, e.g., "Not accepting characters above UPPER_LIMIT".
+ *
+ **/
+struct SharedMemoryError
+{
+	int         error;
+	int         savedErrno;
+	const char *function;
+	const char *message;
+};
+
+
+
+/**
+ *
+ *	__dtsharedmemory_get_last_error() returns the reason of the latest failure in the calling
+ *	thread, or ERROR_NONE. Like `errno`, it isn't cleared by calls that succeed, that's what
+ *	__dtsharedmemory_clear_errors() is for.
+ *
+ *	__dtsharedmemory_get_errors() copies up to `count` of the latest failures of the calling
+ *	thread to `errors`, the latest first, and returns how many it copied.
+ *
+ *	__dtsharedmemory_get_error_name() returns the name of `error`, e.g., "ERROR_BAD_OFFSET".
+ *
+ **/
+int __dtsharedmemory_get_last_error();
+size_t __dtsharedmemory_get_errors(struct SharedMemoryError *errors, size_t count);
+void __dtsharedmemory_clear_errors();
+const char *__dtsharedmemory_get_error_name(int error);
+
+
+
+/**
+ *
+ *	This function sets `sink` to be called with every failure as it is recorded, in the
+ *	thread that failed, e.g., to log them. NULL, the default, removes it.
+ *	`sink` must not call the library.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(sink):
+ *		Function to be called, or NULL.
+ *
+ **/
+void __dtsharedmemory_set_error_sink(void (*sink)(const struct SharedMemoryError *error));
+
+
+
+/**
+ *
+ *	This function sets whether failures are also printed to stderr (or `__darwintrace_stderr`)
+ *	as they are recorded, which they aren't by default. Does nothing if the library is
+ *	built with DEBUG_MESSAGES_ALLOWED as 0.
+ *
+ *	Arguments:
+ *
+ *	#Arg1(areAllowed):
+ *		true to print them, false to stop.
+ *
+ **/
+void __dtsharedmemory_set_debug_messages(bool areAllowed);
+
+
+
 /**
  *
  *	While installing a port there is a chance that it may try to use
- *	the file descriptor that is being used by either status file or
+ *	the file descriptor that is being used by
  *	shared memory file via dup2(2). Each process has a unique file descriptor
- *	for each of these files which is used throughout the process.
+ *	for this file which is used throughout the process.
  *	If while installing the port, an attempt is being made to use our fds via
  *	dup2(2) or close(2) tries to close our fd, this function resets the fd being used by
- *	status and shared memory file and the port can use the fd we were using before.
+ *	shared memory file and the port can use the fd we were using before.
  *	Although there always will be a chance of us or port using the wrong fd ,like ,
  *	the fd has just been prepared by open(2) in __dtsharedmemory_set_manager() or
  *	__dtsharedmemory_reset_fd() and currently the Global(manager) doesn't know about it.
@@ -538,17 +1493,34 @@ bool __dtsharedmemory_reset_fd();
 
 /**
  *
- *	__dtsharedmemory_getStatusFileFd() returns status file fd and __dtsharedmemory_getSharedMemoryFileFd()
- *	returns shared memory file fd, if manager is not NULL.
+ *	__dtsharedmemory_getSharedMemoryFileFd() returns shared memory file fd, if manager is not NULL.
  *	This provides a more faster way to check if dup2(2) or close(2)
  *	are trying to close this fd and if they are the call __dtsharedmemory_reset_fd().
  *
  **/
-int __dtsharedmemory_getStatusFileFd();
 int __dtsharedmemory_getSharedMemoryFileFd();
 
 
 
+/**
+ *
+ *	Lets the processes exec(3)ed from this one attach without opening any file.
+ *	The fd of shared memory file, with the device and inode of the file,
+ *	is written to the environment variable INHERITED_FD_VARIABLE.
+ *	__dtsharedmemory_set_manager() in a process inheriting both the variable
+ *	and the fd then only needs an fstat(2) and a mmap(2). If the process
+ *	has closed the fd or it is now used for some other file, the file is opened by
+ *	name as usual.
+ *	The fd mustn't have FD_CLOEXEC set, which the library never does.
+ *	Returns false if Global(manager) isn't set or fstat(2)/setenv(3) fails.
+ *
+ **/
+#define INHERITED_FD_VARIABLE "DTSM_INHERITED_FD"
+
+bool __dtsharedmemory_export_fd();
+
+
+
 /**
  *
  *	Returns the offset from which a new node would be written,
@@ -0,0 +1,348 @@
+/**
+ *
+ *	Reports the shape of the ctrie in a shared memory file
+ *	and how much of the used memory it actually takes. The file is only read,
+ *	so it is safe to run on a file in use, although the numbers of a ctrie
+ *	changing meanwhile won't be exact.
+ *	It has to be built with the same flags as the library (e.g., LARGE_MEMORY_NEEDED,
+ *	SHARED_MEMORY_CAP), as it reads `struct SharedMemoryStatus` and the nodes directly.
+ *	The header of the file tells if it wasn't.
+ *
+ *	Usage: ./dtsm-inspect [-p] <shared memory file>
+ *
+ *	-p also prints every path with its flags:
+ *		A ALLOW_PATH, D DENY_PATH, V SANDBOX_VIOLATION, U SANDBOX_UNKNOWN, P IS_PREFIX
+ *
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "dtsharedmemory.h"
+
+
+//Deeper than any path can be, only there to stop at a corrupted ctrie
+#define MAX_DEPTH 8192
+
+
+struct Inspection
+{
+	const char *base;
+	size_t      size;
+	bool        isPrintingPaths;
+	
+	size_t iNodes;
+	size_t cNodes;
+	size_t tombedINodes;
+	size_t paths;
+	size_t prefixes;
+	size_t invalidOffsets;
+	
+	size_t fanout [POSSIBLE_CHARACTERS + 1];
+	size_t depths [MAX_DEPTH + 1];
+	
+	char   path [MAX_DEPTH + 1];
+};
+
+
+void *mapFile(const char *name, size_t *size);
+void inspectINode(struct Inspection *inspection, size_t offsetToINode, size_t depth);
+size_t countStack(struct Inspection *inspection, size_t top, bool isBundleStack);
+void printFlags(uint8_t flags);
+
+
+int main(int argc, char *argv[])
+{
+	
+	struct Inspection *inspection;
+	struct SharedMemoryHeader *header;
+	struct SharedMemoryStatus *status;
+	size_t fileSize, liveBytes, i;
+	int argument = 1;
+	
+	inspection = (struct Inspection *)calloc(1, sizeof(struct Inspection));
+	
+	if (inspection == NULL)
+	{
+		perror("calloc");
+		return 1;
+	}
+	
+	if (argc == 3 && strcmp(argv[1], "-p") == 0)
+	{
+		inspection->isPrintingPaths = true;
+		++argument;
+	}
+	
+	if (argc - argument != 1)
+	{
+		fprintf(stderr, "Usage: %s [-p] <shared memory file>\n", argv[0]);
+		return 1;
+	}
+	
+	header = mapFile(argv[argument], &fileSize);
+	
+	if (header == NULL)
+		return 1;
+	
+	if (fileSize < HEADER_SIZE + ROOT_SIZE || header->magic != HEADER_MAGIC)
+	{
+		fprintf(stderr, "%s: not a shared memory file\n", argv[0]);
+		return 1;
+	}
+	
+	if (header->layoutVersion != LAYOUT_VERSION || header->headerSize != HEADER_SIZE ||
+		header->statusSize != sizeof(struct SharedMemoryStatus) || header->cNodeSize != sizeof(CNode) ||
+		header->layoutFlags != LAYOUT_FLAGS)
+	{
+		fprintf(stderr, "%s: the tool isn't built with the flags of the library\n", argv[0]);
+		return 1;
+	}
+	
+	//Offsets are counted from the end of the header
+	status           = &(header->status);
+	inspection->base = (const char *)header + HEADER_SIZE;
+	inspection->size = fileSize - HEADER_SIZE;
+	
+	
+	inspectINode(inspection, 0, 0);
+	
+	
+	//The root is never tombed, every other INode takes a CNode unless tombed
+	liveBytes = inspection->iNodes * sizeof(INode) + inspection->cNodes * sizeof(CNode);
+	
+	printf("Shared memory file size : %zu bytes\n", inspection->size);
+	printf("Used (writeFromOffset)  : %zu bytes\n", (size_t)status->writeFromOffset);
+	printf("Grown by                : %zu%%, at least %zu bytes, ", header->options.growthPercent, header->options.expandingSize);
+	
+	//The default maxFileSize, see setUpHeader()
+	if (header->options.maxFileSize == (size_t)-1 - HEADER_SIZE)
+		printf("no limit\n");
+	else
+		printf("up to %zu bytes\n", header->options.maxFileSize);
+	
+	printf("Live bytes              : %zu (%.1f%% of used)\n", liveBytes,
+		   status->writeFromOffset ? 100.0 * liveBytes / status->writeFromOffset : 0.0);
+	printf("Wasted bytes            : %zu\n",
+		   status->writeFromOffset > liveBytes ? (size_t)status->writeFromOffset - liveBytes : 0);
+	printf("INodes                  : %zu (%zu tombed)\n", inspection->iNodes, inspection->tombedINodes);
+	printf("CNodes                  : %zu\n", inspection->cNodes);
+	printf("Paths                   : %zu (%zu prefixes)\n", inspection->paths, inspection->prefixes);
+	
+#if !(DISABLE_DUMPING_AND_RECYCLING)
+	
+	size_t dumped = 0;
+	
+	for (i = 0 ; i < header->options.dumpYardSize ; ++i)
+	{
+		dumped += (status->bitmapForRecycling[i / NO_OF_BITS] >> (i % NO_OF_BITS)) & 1;
+	}
+	
+	printf("Dump yard               : %zu of %zu\n", dumped, header->options.dumpYardSize);
+	
+#	ifdef __LP64__
+	printf("Freed CNodes            : %zu\n", countStack(inspection, status->freedCNodes, false));
+#	endif
+	
+#	if SHARED_MEMORY_CAP
+	printf("Freed INodes            : %zu\n", countStack(inspection, status->freedINodes, true));
+#	endif
+	
+#	if HOT_LEVELS
+	printf("Hot region              : %zu of %d bytes used (%zu freed CNodes)\n", (size_t)status->hotRegionUsed,
+		   HOT_REGION_SIZE, countStack(inspection, status->freedHotCNodes, false));
+#	endif
+	
+#	if !(SHARED_MEMORY_CAP)
+	printf("Compactions             : %zu\n", (size_t)status->compactions / 2);
+	printf("Retired by compaction   : %zu bytes\n", status->retiredEnd == 0 ? 0 :
+		   (size_t)(status->retiredEnd - status->retiredStart - (status->copyEnd - status->copyStart)));
+	printf("Kept for compaction     : %zu bytes\n", (size_t)(status->holeEnd - status->holeStart));
+#	endif
+	
+#endif
+	
+	if (inspection->invalidOffsets != 0)
+		printf("Offsets out of file     : %zu\n", inspection->invalidOffsets);
+	
+	printf("\nFanout (entries in a CNode : CNodes)\n");
+	
+	for (i = 0 ; i <= POSSIBLE_CHARACTERS ; ++i)
+	{
+		if (inspection->fanout[i] != 0)
+			printf("%6zu : %zu\n", i, inspection->fanout[i]);
+	}
+	
+	printf("\nDepth (characters in a path : paths)\n");
+	
+	for (i = 0 ; i <= MAX_DEPTH ; ++i)
+	{
+		if (inspection->depths[i] != 0)
+			printf("%6zu : %zu\n", i, inspection->depths[i]);
+	}
+	
+	return 0;
+}
+
+
+void *mapFile(const char *name, size_t *size)
+{
+	
+	struct stat fileStatus;
+	void *base;
+	int fd;
+	
+	fd = open(name, O_RDONLY);
+	
+	if (fd == -1 || fstat(fd, &fileStatus) == -1)
+	{
+		perror(name);
+		return NULL;
+	}
+	
+	*size = fileStatus.st_size;
+	
+	base = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+	
+	close(fd);
+	
+	if (base == MAP_FAILED)
+	{
+		perror(name);
+		return NULL;
+	}
+	
+	return base;
+}
+
+
+void inspectINode(struct Inspection *inspection, size_t offsetToINode, size_t depth)
+{
+	
+	const INode *iNode;
+	const CNode *cNode;
+	size_t mainNode, entries, i;
+	
+	if (offsetToINode + sizeof(INode) > inspection->size || depth > MAX_DEPTH)
+	{
+		++inspection->invalidOffsets;
+		return;
+	}
+	
+	iNode    = (const INode *)(inspection->base + offsetToINode);
+	mainNode = iNode->mainNode;
+	
+#if SHARED_MEMORY_CAP
+	//Upper 16 bits are a version and the one below them the referenced bit,
+	//see MAIN_NODE() in dtsharedmemory.c
+	mainNode &= ((size_t)1 << 47) - 1;
+#endif
+	
+	if (mainNode + sizeof(CNode) > inspection->size)
+	{
+		++inspection->invalidOffsets;
+		return;
+	}
+	
+	cNode = (const CNode *)(inspection->base + mainNode);
+	
+	++inspection->iNodes;
+	
+	for (entries = 0, i = 0 ; i < POSSIBLE_CHARACTERS ; ++i)
+	{
+		entries += (cNode->possibilities[i] != 0);
+	}
+	
+	//Removal points an INode left with nothing to the tomb CNode, see TOMB_CNODE_OFFSET
+	if (offsetToINode != 0 && entries == 0 && !cNode->isEndOfString)
+	{
+		++inspection->tombedINodes;
+		return;
+	}
+	
+	++inspection->cNodes;
+	++inspection->fanout[entries];
+	
+	if (cNode->isEndOfString)
+	{
+		++inspection->paths;
+		++inspection->depths[depth];
+		
+		if (cNode->flags & IS_PREFIX)
+			++inspection->prefixes;
+		
+		if (inspection->isPrintingPaths)
+		{
+			printFlags(cNode->flags);
+			printf(" %.*s\n", (int)depth, inspection->path);
+		}
+	}
+	
+	for (i = 0 ; i < POSSIBLE_CHARACTERS ; ++i)
+	{
+		if (cNode->possibilities[i] == 0)
+			continue;
+		
+		if (depth < MAX_DEPTH)
+			inspection->path[depth] = i + LOWER_LIMIT;
+		
+		inspectINode(inspection, cNode->possibilities[i], depth + 1);
+	}
+}
+
+
+/**
+ *
+ *	Counts the elements of `freedCNodes` or `freedINodes` stack in status file,
+ *	whose top is `top`. The first bytes of every element hold the offset to the next one.
+ *	For `freedINodes`, the INodes in every bundle are counted instead.
+ *
+ **/
+size_t countStack(struct Inspection *inspection, size_t top, bool isBundleStack)
+{
+	
+	const size_t *element;
+	size_t offset, count = 0;
+	
+	//Upper 16 bits are a tag, see FREED_CNODES_TAG_SHIFT in dtsharedmemory.c
+	offset = top & (((size_t)1 << 48) - 1);
+	
+	//Offset 0 is the root, which is never freed. The stack may change while it is
+	//being read, so it is never followed longer than the whole file could hold.
+	while (offset != 0 && count <= inspection->size / sizeof(size_t))
+	{
+		if (isBundleStack)
+			offset = (offset + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+		
+		if (offset + sizeof(CNode) > inspection->size)
+		{
+			++inspection->invalidOffsets;
+			break;
+		}
+		
+		element = (const size_t *)(inspection->base + offset);
+		
+		count += isBundleStack ? *(element + 1) : 1;
+		
+		offset = *element;
+	}
+	
+	return count;
+}
+
+
+void printFlags(uint8_t flags)
+{
+	printf("%c%c%c%c%c",
+		   (flags & ALLOW_PATH)        ? 'A' : '-',
+		   (flags & DENY_PATH)         ? 'D' : '-',
+		   (flags & SANDBOX_VIOLATION) ? 'V' : '-',
+		   (flags & SANDBOX_UNKNOWN)   ? 'U' : '-',
+		   (flags & IS_PREFIX)         ? 'P' : '-');
+}
@@ -0,0 +1,77 @@
+/**
+ *
+ *	Prints the latency percentiles of __dtsharedmemory_search() and
+ *	__dtsharedmemory_insert() sampled by all the processes using a shared memory file.
+ *	The library needs to be built with LATENCY_SAMPLING, e.g., by adding
+ *	-D LATENCY_SAMPLING=64 to CFLAGS in Makefile.
+ *
+ *	Usage: ./dtsm-latency <shared memory file>
+ *
+ **/
+
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "dtsharedmemory.h"
+
+
+int main(int argc, char *argv[])
+{
+	
+	const double percentiles[] = {50, 90, 99, 99.9, 99.99, 100};
+	const int numberOfPercentiles = sizeof(percentiles) / sizeof(percentiles[0]);
+	
+	const char *operations[NUMBER_OF_LATENCIES] = {"search", "insert"};
+	
+	int operation, i;
+	
+	if (argc != 2)
+	{
+		fprintf(stderr, "Usage: %s <shared memory file>\n", argv[0]);
+		return 1;
+	}
+	
+	//__dtsharedmemory_set_manager() would create it otherwise
+	if (access(argv[1], F_OK) == -1)
+	{
+		fprintf(stderr, "%s: shared memory file doesn't exist\n", argv[0]);
+		return 1;
+	}
+	
+	if (!__dtsharedmemory_set_manager(argv[1]))
+	{
+		fprintf(stderr, "%s: __dtsharedmemory_set_manager() failed\n", argv[0]);
+		return 1;
+	}
+	
+	if (__dtsharedmemory_get_latency_percentile(LATENCY_OF_SEARCH, 100) == 0 &&
+		__dtsharedmemory_get_latency_percentile(LATENCY_OF_INSERT, 100) == 0)
+	{
+		printf("Nothing sampled, is the library built with LATENCY_SAMPLING?\n");
+		return 0;
+	}
+	
+	printf("%-8s", "ns");
+	
+	for (i = 0 ; i < numberOfPercentiles ; ++i)
+	{
+		printf(" %10g%%", percentiles[i]);
+	}
+	
+	printf("\n");
+	
+	for (operation = 0 ; operation < NUMBER_OF_LATENCIES ; ++operation)
+	{
+		printf("%-8s", operations[operation]);
+	
+		for (i = 0 ; i < numberOfPercentiles ; ++i)
+		{
+			printf(" %11zu", __dtsharedmemory_get_latency_percentile(operation, percentiles[i]));
+		}
+	
+		printf("\n");
+	}
+	
+	return 0;
+}
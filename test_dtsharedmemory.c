@@ -80,6 +80,7 @@ struct PathData
 
 void* pathInserter(void* arg);
 void* pathSearcher(void* arg);
+void* pathRemover(void* arg);
 
 char *get_random_string(int minLength, int maxLength);
 void prepareThreadArguments(struct PathData *argsToThreads, int number_of_strings);
@@ -108,11 +109,9 @@ int main()
 	if ( errors_log_fd == -1 || dup2(errors_log_fd, STDERR_FILENO) == -1)
 		fprintf(stderr, "Couldn't redirect output to errors.log, errors will be printed on stderr\n");
 	
-	char mktemp_dtsm_template[MAXPATHLEN]        = "macports-dtsm-XXXXXX";
-	char mktemp_dtsm_status_template[MAXPATHLEN] = "macports-dtsm-status-XXXXXX";
+	char mktemp_dtsm_template[MAXPATHLEN] = "macports-dtsm-XXXXXX";
 	
-	char *dtsm_status_file = mktemp(mktemp_dtsm_status_template);
-	char *dtsm_file	       = mktemp(mktemp_dtsm_template);
+	char *dtsm_file = mktemp(mktemp_dtsm_template);
 	
 	
 //________________________________________________________________________________
@@ -206,14 +205,27 @@ int main()
 	
 	bool didSetManager;
 	
+	//Top levels are faulted in once mapped, which must not change anything else
+	__dtsharedmemory_set_mapping_advice(KB(256), true);
+	
+	//A small file grown in small steps, so the test goes through many expansions,
+	//and half the dump yard, so it gets full too
+	struct SharedMemoryOptions options = {
+		.initialFileSize = MB(2),
+		.expandingSize   = MB(1),
+		.growthPercent   = 25,
+		.dumpYardSize    = DUMP_YARD_SIZE / 2,
+		.compaction      = 1
+	};
+	
 	//Monitor time taken to __dtsharedmemory_set_manager()
 	t = clock();
 	
-	didSetManager = __dtsharedmemory_set_manager(dtsm_status_file, dtsm_file);
+	didSetManager = __dtsharedmemory_set_manager_ex(dtsm_file, &options);
 	
 	if(!didSetManager)
 	{
-		fprintf(test_messages, "__dtsharedmemory_set_manager() failed. Test failed\n");
+		fprintf(test_messages, "__dtsharedmemory_set_manager_ex() failed. Test failed\n");
 		flag = true;
 	}
 	
@@ -227,7 +239,7 @@ int main()
 	//This should be way less because Global(manager) is already set
 	t = clock();
 	
-	didSetManager = __dtsharedmemory_set_manager(dtsm_status_file, dtsm_file);
+	didSetManager = __dtsharedmemory_set_manager(dtsm_file);
 	
 	if(!didSetManager)
 	{
@@ -358,6 +370,287 @@ int main()
 			printf(" (%s)\n", str_realFileSizeUsed);
 		}
 		
+		struct SharedMemoryStats stats;
+		
+		if (!__dtsharedmemory_get_stats(&stats) || stats.inserts == 0 || stats.searches == 0)
+		{
+			fprintf(test_messages, "[%s] : \n\nStatistics not counted\n", __FILE__);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+		
+		printf("Searches = %zu (hits = %zu, misses = %zu), inserts = %zu (retries = %zu)\n", stats.searches, stats.hits, stats.misses, stats.inserts, stats.insertRetries);
+		printf("CNodes recycled = %zu, reserved = %zu, expansions = %zu\n", stats.recycleHits, stats.recycleMisses, stats.expansions);
+		
+//________________________________________________________________________________
+//REMOVAL
+//ALL OTHER PROCESSES HAVE ENDED, SO PATHS OF THIS PROCESS CAN BE REMOVED
+//________________________________________________________________________________
+		
+		printf("\nREMOVING PATHS...\n\n");
+		
+		t = clock();
+		
+		// Launch threads for removal
+		for (i = 0; i < NUMBER_OF_THREADS_PER_PROCESS; ++i)
+		{
+			pthread_attr_t attr;
+			pthread_attr_init(&attr);
+			pthread_create(&tids[i], &attr, pathRemover, &argsToThreads[i]);
+		}
+		
+		// Wait until removals are done
+		for (i = 0; i < NUMBER_OF_THREADS_PER_PROCESS; ++i) {
+			
+			pthread_join(tids[i], NULL);
+		}
+		
+		t = clock() - t;
+		time_taken = ((long double)t)/CLOCKS_PER_SEC;
+		
+		printf("In process %d Time taken to remove %d strings by %d threads = %Lf\n", getpid(), insertion_count_per_process, NUMBER_OF_THREADS_PER_PROCESS, time_taken);
+//________________________________________________________________________________
+		
+		
+//________________________________________________________________________________
+//PREFIX REMOVAL
+//________________________________________________________________________________
+		
+		uint8_t fetchedFlags;
+		
+		//Only "/opt/prefix" and the paths inside it go, not the ones merely sharing its characters
+		if (!__dtsharedmemory_insert("/opt/prefix", ALLOW_PATH)
+			|| !__dtsharedmemory_insert("/opt/prefix/bin", ALLOW_PATH)
+			|| !__dtsharedmemory_insert("/opt/prefix/bin/ls", ALLOW_PATH)
+			|| !__dtsharedmemory_insert("/opt/prefixabc", DENY_PATH)
+			|| !__dtsharedmemory_insert("/opt/prefix.d/bin", DENY_PATH)
+			|| !__dtsharedmemory_remove_prefix("/opt/prefix/")
+			|| __dtsharedmemory_search("/opt/prefix", &fetchedFlags)
+			|| __dtsharedmemory_search("/opt/prefix/bin", &fetchedFlags)
+			|| __dtsharedmemory_search("/opt/prefix/bin/ls", &fetchedFlags)
+			|| !__dtsharedmemory_search("/opt/prefixabc", &fetchedFlags)
+			|| fetchedFlags != DENY_PATH
+			|| !__dtsharedmemory_search("/opt/prefix.d/bin", &fetchedFlags)
+			|| fetchedFlags != DENY_PATH
+			|| __dtsharedmemory_remove_prefix("/opt/prefix"))
+		{
+			fprintf(test_messages, "[%s] : \n\n__dtsharedmemory_remove_prefix() removed wrong paths\n", __FILE__);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+		
+		//Inserting again under a removed prefix only brings back what is inserted
+		if (!__dtsharedmemory_insert("/opt/prefix/bin/ls", DENY_PATH)
+			|| !__dtsharedmemory_search("/opt/prefix/bin/ls", &fetchedFlags)
+			|| fetchedFlags != DENY_PATH
+			|| __dtsharedmemory_search("/opt/prefix/bin", &fetchedFlags)
+			|| __dtsharedmemory_search("/opt/prefix", &fetchedFlags)
+			|| !__dtsharedmemory_search("/opt/prefixabc", &fetchedFlags))
+		{
+			fprintf(test_messages, "[%s] : \n\nInsertion after __dtsharedmemory_remove_prefix() failed\n", __FILE__);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+//________________________________________________________________________________
+		
+		
+//________________________________________________________________________________
+//NAMESPACE AND RESET
+//________________________________________________________________________________
+		
+		size_t generation = __dtsharedmemory_get_generation();
+		
+		if (!__dtsharedmemory_set_namespace("test-namespace")
+			|| !__dtsharedmemory_insert("/usr/bin/ls", ALLOW_PATH)
+			|| !__dtsharedmemory_search("/usr/bin/ls", &fetchedFlags)
+			|| __dtsharedmemory_insert("usr/bin/ls", ALLOW_PATH)
+			|| !__dtsharedmemory_set_namespace(NULL)
+			|| __dtsharedmemory_search("/usr/bin/ls", &fetchedFlags)
+			|| __dtsharedmemory_search("test-namespace/usr/bin/ls", &fetchedFlags)
+			|| !__dtsharedmemory_insert("test-namespace/usr/bin/cc", ALLOW_PATH)
+			|| !__dtsharedmemory_set_namespace("test-namespace")
+			|| __dtsharedmemory_search("/usr/bin/cc", &fetchedFlags)
+			|| !__dtsharedmemory_set_namespace("test")
+			|| __dtsharedmemory_search("-namespace/usr/bin/ls", &fetchedFlags))
+		{
+			fprintf(test_messages, "[%s] : \n\nPath not confined to its namespace\n", __FILE__);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+		
+		if (!__dtsharedmemory_set_namespace("test-namespace")
+			|| !__dtsharedmemory_reset()
+			|| __dtsharedmemory_search("/usr/bin/ls", &fetchedFlags)
+			|| __dtsharedmemory_get_generation() != generation + 1)
+		{
+			fprintf(test_messages, "[%s] : \n\nReset of namespace failed\n", __FILE__);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+		
+		//The old paths are reclaimed by the insertions made after the reset
+		if (!__dtsharedmemory_insert("/usr/bin/ls", DENY_PATH)
+			|| !__dtsharedmemory_insert("/usr/bin/cc", ALLOW_PATH)
+			|| !__dtsharedmemory_search("/usr/bin/ls", &fetchedFlags)
+			|| fetchedFlags != DENY_PATH
+			|| !__dtsharedmemory_reset()
+			|| !__dtsharedmemory_insert("/usr/bin/ls", ALLOW_PATH)
+			|| !__dtsharedmemory_search("/usr/bin/ls", &fetchedFlags)
+			|| fetchedFlags != ALLOW_PATH
+			|| __dtsharedmemory_search("/usr/bin/cc", &fetchedFlags))
+		{
+			fprintf(test_messages, "[%s] : \n\nInsertion after __dtsharedmemory_reset() failed\n", __FILE__);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+		
+		//Everything but the other namespaces, whatever the paths start with
+		if (!__dtsharedmemory_insert("/usr/bin/ls", ALLOW_PATH)
+			|| !__dtsharedmemory_set_namespace(NULL)
+			|| !__dtsharedmemory_insert("usr/bin/ls", ALLOW_PATH)
+			|| !__dtsharedmemory_reset()
+			|| __dtsharedmemory_search("usr/bin/ls", &fetchedFlags)
+			|| __dtsharedmemory_search("test-namespace/usr/bin/cc", &fetchedFlags)
+			|| !__dtsharedmemory_insert("usr/bin/ls", DENY_PATH)
+			|| !__dtsharedmemory_set_namespace("test-namespace")
+			|| !__dtsharedmemory_search("/usr/bin/ls", &fetchedFlags)
+			|| fetchedFlags != ALLOW_PATH)
+		{
+			fprintf(test_messages, "[%s] : \n\nReset of default namespace failed\n", __FILE__);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+		
+		__dtsharedmemory_set_namespace(NULL);
+//________________________________________________________________________________
+		
+		
+//________________________________________________________________________________
+//COMPACTION
+//________________________________________________________________________________
+		
+#if !(SHARED_MEMORY_CAP) && !(DISABLE_DUMPING_AND_RECYCLING) && defined(__LP64__)
+		
+		printf("\nCOMPACTING...\n\n");
+		
+		//Copied, then the old region is reused as nothing reads it anymore, then copied again
+		if (!__dtsharedmemory_insert("/opt/local/compacted", DENY_PATH)
+			|| !__dtsharedmemory_insert("/opt/local/removed", ALLOW_PATH)
+			|| !__dtsharedmemory_remove("/opt/local/removed")
+			|| !__dtsharedmemory_compact()
+			|| !__dtsharedmemory_search("/opt/local/compacted", &fetchedFlags)
+			|| fetchedFlags != DENY_PATH
+			|| __dtsharedmemory_search("/opt/local/removed", &fetchedFlags)
+			|| !__dtsharedmemory_insert("/opt/local/after/compaction", ALLOW_PATH)
+			|| !__dtsharedmemory_compact()
+			|| !__dtsharedmemory_insert("/opt/local/after/reuse", ALLOW_PATH)
+			|| !__dtsharedmemory_compact()
+			|| !__dtsharedmemory_search("/opt/local/compacted", &fetchedFlags)
+			|| !__dtsharedmemory_search("/opt/local/after/compaction", &fetchedFlags)
+			|| !__dtsharedmemory_search("/opt/local/after/reuse", &fetchedFlags))
+		{
+			fprintf(test_messages, "[%s] : \n\n__dtsharedmemory_compact() lost paths\n", __FILE__);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+		
+#endif
+//________________________________________________________________________________
+		
+		
+//________________________________________________________________________________
+//VALUES
+//________________________________________________________________________________
+		
+#if VALUE_SIZE
+		
+		uint8_t value[VALUE_SIZE], fetchedValue[VALUE_SIZE];
+		
+		memset(value, 0x5A, VALUE_SIZE);
+		
+		//Kept when only the flags change, gone with the path once it is removed
+		if (!__dtsharedmemory_insert_value("/opt/local/valued", ALLOW_PATH, value)
+			|| !__dtsharedmemory_insert("/opt/local/valued", DENY_PATH)
+			|| !__dtsharedmemory_search_value("/opt/local/valued", &fetchedFlags, fetchedValue)
+			|| fetchedFlags != DENY_PATH
+			|| memcmp(fetchedValue, value, VALUE_SIZE) != 0
+			|| !__dtsharedmemory_remove("/opt/local/valued")
+			|| !__dtsharedmemory_insert("/opt/local/valued", ALLOW_PATH)
+			|| !__dtsharedmemory_search_value("/opt/local/valued", &fetchedFlags, fetchedValue)
+			|| fetchedValue[0] != 0)
+		{
+			fprintf(test_messages, "[%s] : \n\n__dtsharedmemory_search_value() found a wrong value\n", __FILE__);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+		
+#endif
+//________________________________________________________________________________
+		
+		
+//________________________________________________________________________________
+//ERRORS
+//________________________________________________________________________________
+		
+		struct SharedMemoryError errors[ERROR_RING_SIZE];
+		
+		__dtsharedmemory_clear_errors();
+		
+		if (__dtsharedmemory_search("\x01/usr/bin/ls", &fetchedFlags)
+			|| __dtsharedmemory_get_last_error() != ERROR_INVALID_CHARACTER
+			|| __dtsharedmemory_get_errors(errors, ERROR_RING_SIZE) != 1
+			|| errors[0].error != ERROR_INVALID_CHARACTER)
+		{
+			fprintf(test_messages, "[%s] : \n\nRejected character not recorded as %s\n", __FILE__,
+					__dtsharedmemory_get_error_name(ERROR_INVALID_CHARACTER));
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+		
+		__dtsharedmemory_clear_errors();
+//________________________________________________________________________________
+		
+		
+//________________________________________________________________________________
+//INHERITED FD
+//________________________________________________________________________________
+		
+		const char *exportedFd;
+		int exportedSharedMemoryFileFd = -1;
+		
+		exportedFd = __dtsharedmemory_export_fd() ? getenv(INHERITED_FD_VARIABLE) : NULL;
+		
+		if (exportedFd == NULL
+			|| sscanf(exportedFd, "%d:", &exportedSharedMemoryFileFd) != 1
+			|| exportedSharedMemoryFileFd != __dtsharedmemory_getSharedMemoryFileFd())
+		{
+			fprintf(test_messages, "[%s] : \n\nExporting fd failed\n", __FILE__);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+		
+		unsetenv(INHERITED_FD_VARIABLE);
+//________________________________________________________________________________
+		
+		
+//________________________________________________________________________________
+//LAZY ATTACH
+//________________________________________________________________________________
+		
+		//Already attached, so only an invalid name can make it fail
+		if (!__dtsharedmemory_set_manager_lazily(dtsm_file)
+			|| __dtsharedmemory_set_manager_lazily("")
+			|| !__dtsharedmemory_insert("/opt/local/lazy", ALLOW_PATH)
+			|| !__dtsharedmemory_search("/opt/local/lazy", &fetchedFlags))
+		{
+			fprintf(test_messages, "[%s] : \n\n__dtsharedmemory_set_manager_lazily() failed\n", __FILE__);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+		
+		__dtsharedmemory_clear_errors();
+//________________________________________________________________________________
+		
 		if (flag)
 		{
 			printf("\nTEST FAILED, check errors.log and test_messages.log\n\n");
@@ -419,7 +712,7 @@ char *get_random_string(int minLength, int maxLength)
 	for (i = 0 ; i < strSize ; ++i)
 	{
 		
-		random_char = (rand() % POSSIBLE_CHARACTERS) + LOWER_LIMIT;
+		random_char = (rand() % (UPPER_LIMIT - LOWER_LIMIT + 1)) + LOWER_LIMIT;
 		random_char = !random_char ? 1 : random_char; //shifting coz don't want 0, which is '\0'
 		random_string[i] = random_char;
 	}
@@ -441,6 +734,10 @@ void* pathInserter(void* arg)
 	int size = pathToBeInserted->number_of_strings;
 	
 	
+#if SHARED_MEMORY_CAP
+	uint8_t fetchedFlags;
+#endif
+	
 	for (i = 0 ; i < size; ++i) {
 		
 		result = __dtsharedmemory_insert(pathToBeInserted->path[i], pathToBeInserted->flags[i]);
@@ -451,6 +748,17 @@ void* pathInserter(void* arg)
 			fprintf(test_messages, "\n------------------------------------------------------\n");
 			flag = true;
 		}
+		
+#if SHARED_MEMORY_CAP
+		//Older paths get evicted to make room, but not the one just inserted
+		else if (!__dtsharedmemory_search(pathToBeInserted->path[i], &fetchedFlags)
+			|| fetchedFlags != pathToBeInserted->flags[i])
+		{
+			fprintf(test_messages, "[%s] : \n\nPath not found right after insertion - %s\n", __FILE__, pathToBeInserted->path[i]);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+#endif
 	}
 	
 	pthread_exit(0);
@@ -472,6 +780,11 @@ void* pathSearcher(void* arg)
 		
 		exists = __dtsharedmemory_search(pathToBeSearched->path[i], &(fetchedFlags) );
 		
+#if SHARED_MEMORY_CAP
+		//It may have been evicted, see pathInserter()
+		if (!exists)
+			continue;
+#endif
 		
 		if(!exists)
 		{
@@ -495,6 +808,45 @@ void* pathSearcher(void* arg)
 }
 
 
+void* pathRemover(void* arg)
+{
+	struct PathData *pathToBeRemoved = (struct PathData*)arg;
+	
+	bool result;
+	
+	int i;
+	
+	uint8_t fetchedFlags;
+	int size = pathToBeRemoved->number_of_strings;
+	
+	for (i = 0 ; i < size ; ++i) {
+		
+		result = __dtsharedmemory_remove(pathToBeRemoved->path[i]);
+		
+#if SHARED_MEMORY_CAP
+		//Already evicted
+		if (!result && !__dtsharedmemory_search(pathToBeRemoved->path[i], &(fetchedFlags) ))
+			continue;
+#endif
+		
+		if (!result)
+		{
+			fprintf(test_messages, "[%s] : \n\nRemoval failed for - %s\n", __FILE__, pathToBeRemoved->path[i]);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+		else if (__dtsharedmemory_search(pathToBeRemoved->path[i], &(fetchedFlags) ))
+		{
+			fprintf(test_messages, "[%s] : \n\nPath found after removal - %s\n", __FILE__, pathToBeRemoved->path[i]);
+			fprintf(test_messages, "\n------------------------------------------------------\n");
+			flag = true;
+		}
+	}
+	
+	pthread_exit(0);
+}
+
+
 char *get_comma_seperated_number(uint64_t number)
 {
 	int digit, count = 0, index = 0;